@@ -0,0 +1,704 @@
+/*
+ * mksfile.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Writes a synthetic history file directly, without running delta
+ * once for each delta.  The shape of the history (the number of
+ * deltas, branches, lines changed by each delta and so on) is given
+ * by the options, and the file depends only on those and the seed.
+ *
+ * The program keeps the body as a "weave" of lines, each knowing the
+ * delta which inserted it and those which deleted it, together with
+ * the set of deltas applied to the version being edited.  Each new
+ * delta deletes and inserts lines among those visible in its
+ * predecessor, and branches and include and exclude lists change the
+ * applied set; only the lines touched by the deltas concerned need to
+ * be looked at again, so the cost does not grow with the length of
+ * the history.
+ *
+ */
+
+#include <config.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "cssc.h"
+#include "bodyio.h"
+#include "delta.h"
+#include "my-getopt.h"
+#include "relvbr.h"
+#include "version.h"
+
+void usage(void);
+
+namespace
+{
+  struct shape
+  {
+    unsigned long deltas = 100;	   // -n: total number of deltas.
+    unsigned long fanout = 0;	   // -b: branches from each branch point.
+    unsigned long branch_len = 2;  // -B: deltas on each branch.
+    unsigned long period = 10;	   // -p: trunk deltas between branch points.
+    unsigned long lines = 5;	   // -l: lines inserted by each delta.
+    unsigned long initial = 1000;  // -L: lines in the first version.
+    unsigned long locality = 75;   // -c: % of edits near the last one.
+    unsigned long density = 0;	   // -x: % of trunk deltas with a list.
+    unsigned long width = 60;	   // -w: length of text lines.
+    unsigned long seed = 1;	   // -S
+    bool binary = false;	   // -z
+  };
+
+  struct chunk;
+
+  struct line
+  {
+    unsigned long id;
+    seq_no ins;
+    std::vector<seq_no> dels;
+    bool live;
+    chunk *owner;
+  };
+
+  // The weave is kept in chunks so that lines can be inserted in
+  // the middle, and the n-th visible line found, without touching
+  // all of it.
+  struct chunk
+  {
+    std::vector<line*> lines;
+    unsigned long live = 0;
+  };
+
+  const std::size_t max_chunk = 2048;
+
+  struct delta_entry
+  {
+    char sid[48];
+    seq_no seq;
+    seq_no prev;
+    unsigned long inserted = 0, deleted = 0, unchanged = 0;
+    std::vector<seq_no> included, excluded;
+  };
+
+  class generator
+  {
+  public:
+    explicit generator(const shape& s);
+    void generate();
+    cssc::Failure write(FILE *fp) const;
+
+  private:
+    const shape& shape_;
+    std::mt19937_64 rng_;
+    std::deque<line> store_;
+    std::vector<std::unique_ptr<chunk>> chunks_;
+    unsigned long live_ = 0;	// visible lines in the current version.
+    unsigned long cursor_ = 0;	// where the last edit was.
+    std::vector<char> applied_;
+    std::vector<std::vector<line*>> inserted_, deleted_;
+    std::vector<delta_entry> deltas_;
+    std::vector<seq_no> branch_seqs_;
+    std::vector<char> listed_;
+
+    unsigned long random(unsigned long n) { return n ? rng_() % n : 0; }
+    bool chance(unsigned long percent) { return random(100) < percent; }
+    unsigned long editable() const { return live_ - (shape_.binary ? 1 : 0); }
+
+    bool visible(const line *l) const;
+    void refresh(line *l);
+    void set_applied(seq_no s, bool on);
+    std::pair<std::size_t, std::size_t> locate(unsigned long n) const;
+    line *new_line(seq_no s);
+    void split(std::size_t ci);
+    void edit(delta_entry& d);
+    seq_no add_delta(const char *sid, seq_no prev);
+    void add_lists(delta_entry& d);
+  };
+
+  generator::generator(const shape& s)
+    : shape_(s), rng_(s.seed)
+  {
+    chunks_.emplace_back(new chunk);
+  }
+
+  bool
+  generator::visible(const line *l) const
+  {
+    if (!applied_[l->ins])
+      return false;
+    for (seq_no d : l->dels)
+      if (applied_[d])
+	return false;
+    return true;
+  }
+
+  void
+  generator::refresh(line *l)
+  {
+    const bool now = visible(l);
+    if (now != l->live)
+      {
+	l->live = now;
+	if (now)
+	  {
+	    ++l->owner->live;
+	    ++live_;
+	  }
+	else
+	  {
+	    --l->owner->live;
+	    --live_;
+	  }
+      }
+  }
+
+  // Adds S to (or removes it from) the deltas applied to the current
+  // version; only the lines it inserted or deleted can change.
+  void
+  generator::set_applied(seq_no s, bool on)
+  {
+    applied_[s] = on;
+    for (line *l : inserted_[s])
+      refresh(l);
+    for (line *l : deleted_[s])
+      refresh(l);
+  }
+
+  // Returns the chunk and the position in it of the N-th visible
+  // line, or the end of the weave if there are only N.
+  std::pair<std::size_t, std::size_t>
+  generator::locate(unsigned long n) const
+  {
+    for (std::size_t ci = 0; ci < chunks_.size(); ++ci)
+      {
+	const chunk& c = *chunks_[ci];
+	if (n >= c.live)
+	  {
+	    n -= c.live;
+	    continue;
+	  }
+	for (std::size_t pos = 0; ; ++pos)
+	  {
+	    if (c.lines[pos]->live && 0 == n--)
+	      return std::make_pair(ci, pos);
+	  }
+      }
+    return std::make_pair(chunks_.size() - 1, chunks_.back()->lines.size());
+  }
+
+  line *
+  generator::new_line(seq_no s)
+  {
+    store_.push_back(line { store_.size(), s, {}, true, nullptr });
+    line *l = &store_.back();
+    inserted_[s].push_back(l);
+    return l;
+  }
+
+  void
+  generator::split(std::size_t ci)
+  {
+    chunk& old = *chunks_[ci];
+    std::unique_ptr<chunk> rest(new chunk);
+    const std::size_t half = old.lines.size() / 2;
+    rest->lines.assign(old.lines.begin() + half, old.lines.end());
+    old.lines.resize(half);
+    for (line *l : rest->lines)
+      {
+	l->owner = rest.get();
+	if (l->live)
+	  {
+	    ++rest->live;
+	    --old.live;
+	  }
+      }
+    chunks_.insert(chunks_.begin() + ci + 1, std::move(rest));
+  }
+
+  // Makes the changes of delta D to the current version: some
+  // visible lines are deleted, and new ones inserted in their place.
+  void
+  generator::edit(delta_entry& d)
+  {
+    const unsigned long avail = editable();
+    unsigned long at;
+    if (cursor_ <= avail && chance(shape_.locality))
+      {
+	const unsigned long reach = 4 * shape_.lines + 8;
+	const unsigned long lo = cursor_ > reach ? cursor_ - reach : 0;
+	at = std::min(avail, lo + random(cursor_ + reach - lo + 1));
+      }
+    else
+      {
+	at = random(avail + 1);
+      }
+    const unsigned long before = live_;
+    unsigned long ndel = std::min(random(shape_.lines + 1), avail - at);
+    d.deleted = ndel;
+
+    std::pair<std::size_t, std::size_t> where = locate(at);
+    std::size_t ci = where.first, pos = where.second;
+    while (ndel)
+      {
+	line *l = chunks_[ci]->lines[pos];
+	if (l->live)
+	  {
+	    l->dels.push_back(d.seq);
+	    deleted_[d.seq].push_back(l);
+	    l->live = false;
+	    --l->owner->live;
+	    --live_;
+	    --ndel;
+	  }
+	if (++pos == chunks_[ci]->lines.size())
+	  {
+	    ++ci;
+	    pos = 0;
+	  }
+      }
+    if (ci == chunks_.size())
+      {
+	--ci;
+	pos = chunks_[ci]->lines.size();
+      }
+
+    chunk& c = *chunks_[ci];
+    std::vector<line*> added;
+    for (unsigned long i = 0; i < shape_.lines; ++i)
+      {
+	line *l = new_line(d.seq);
+	l->owner = &c;
+	added.push_back(l);
+      }
+    c.lines.insert(c.lines.begin() + pos, added.begin(), added.end());
+    c.live += added.size();
+    live_ += added.size();
+    if (c.lines.size() > max_chunk)
+      split(ci);
+
+    d.inserted = added.size();
+    d.unchanged = before - d.deleted;
+    cursor_ = at + added.size();
+  }
+
+  seq_no
+  generator::add_delta(const char *sid, seq_no prev)
+  {
+    const seq_no s = static_cast<seq_no>(deltas_.size() + 1);
+    deltas_.emplace_back();
+    delta_entry& d = deltas_.back();
+    snprintf(d.sid, sizeof d.sid, "%s", sid);
+    d.seq = s;
+    d.prev = prev;
+    applied_.push_back(1);
+    listed_.push_back(0);
+    inserted_.emplace_back();
+    deleted_.emplace_back();
+    return s;
+  }
+
+  // Gives trunk delta D an include list (naming a branch delta) or
+  // an exclude list (naming an earlier trunk delta), and applies it.
+  void
+  generator::add_lists(delta_entry& d)
+  {
+    if (!branch_seqs_.empty() && chance(50))
+      {
+	const seq_no s = branch_seqs_[random(branch_seqs_.size())];
+	if (!applied_[s])
+	  {
+	    d.included.push_back(s);
+	    set_applied(s, true);
+	  }
+	return;
+      }
+    if (d.seq > 3)
+      {
+	const seq_no s = static_cast<seq_no>(2 + random(d.seq - 2));
+	if (applied_[s] && !listed_[s])
+	  {
+	    d.excluded.push_back(s);
+	    listed_[s] = 1;
+	    set_applied(s, false);
+	  }
+      }
+  }
+
+  void
+  generator::generate()
+  {
+    // Sequence number 0 stands for "no delta".
+    applied_.push_back(0);
+    listed_.push_back(0);
+    inserted_.emplace_back();
+    deleted_.emplace_back();
+
+    unsigned long release = 1, level = 1, trunk_count = 1;
+    char sid[48];
+    snprintf(sid, sizeof sid, "%lu.%lu", release, level);
+    seq_no tip = add_delta(sid, 0);
+    for (unsigned long i = 0; i < shape_.initial + (shape_.binary ? 1 : 0); ++i)
+      {
+	if (chunks_.back()->lines.size() == max_chunk / 2)
+	  chunks_.emplace_back(new chunk);
+	chunk& c = *chunks_.back();
+	line *l = new_line(tip);
+	l->owner = &c;
+	c.lines.push_back(l);
+	++c.live;
+	++live_;
+      }
+    deltas_.back().inserted = live_;
+
+    while (deltas_.size() < shape_.deltas)
+      {
+	if (++level > relvbr::LARGEST)
+	  {
+	    ++release;
+	    level = 1;
+	  }
+	snprintf(sid, sizeof sid, "%lu.%lu", release, level);
+	const seq_no s = add_delta(sid, tip);
+	if (shape_.density && chance(shape_.density))
+	  add_lists(deltas_.back());
+	edit(deltas_.back());
+	tip = s;
+	++trunk_count;
+
+	if (!shape_.fanout || trunk_count % shape_.period)
+	  continue;
+
+	// Each branch starts from the trunk version just made; once
+	// it is done, its deltas are taken away again.
+	for (unsigned long b = 1;
+	     b <= std::min<unsigned long>(shape_.fanout, relvbr::LARGEST); ++b)
+	  {
+	    const unsigned long saved_cursor = cursor_;
+	    std::vector<seq_no> made;
+	    seq_no prev = tip;
+	    for (unsigned long r = 1;
+		 r <= std::min<unsigned long>(shape_.branch_len, relvbr::LARGEST)
+		   && deltas_.size() < shape_.deltas;
+		 ++r)
+	      {
+		snprintf(sid, sizeof sid, "%lu.%lu.%lu.%lu",
+			 release, level, b, r);
+		prev = add_delta(sid, prev);
+		edit(deltas_.back());
+		made.push_back(prev);
+	      }
+	    for (auto it = made.rbegin(); it != made.rend(); ++it)
+	      set_applied(*it, false);
+	    branch_seqs_.insert(branch_seqs_.end(), made.begin(), made.end());
+	    cursor_ = saved_cursor;
+	  }
+      }
+  }
+
+  // Collects the output and its checksum, which is the sum of the
+  // bytes (as plain char) after the first line.
+  class checksummed_output
+  {
+  public:
+    explicit checksummed_output(FILE *fp) : fp_(fp), sum_(0) {}
+    bool put(const char *s, std::size_t len)
+    {
+      for (std::size_t i = 0; i < len; ++i)
+	sum_ += s[i];
+      return fwrite(s, 1, len, fp_) == len;
+    }
+    bool format(const char *fmt, ...);
+    unsigned int sum() const { return sum_ & 0xFFFFu; }
+
+  private:
+    FILE *fp_;
+    int sum_;
+  };
+
+  bool
+  checksummed_output::format(const char *fmt, ...)
+  {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = vsnprintf(buf, sizeof buf, fmt, ap);
+    va_end(ap);
+    return n >= 0 && static_cast<std::size_t>(n) < sizeof buf
+      && put(buf, n);
+  }
+
+  const char *const words[] =
+    {
+      "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf",
+      "hotel", "india", "juliet", "kilo", "lima", "mike", "november",
+      "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform",
+      "victor", "whiskey", "xray", "yankee", "zulu",
+    };
+
+  // The text of a line depends only on its number and the seed.
+  std::string
+  line_text(const shape& s, unsigned long id)
+  {
+    std::mt19937_64 r(s.seed * 1000003u + id);
+    if (s.binary)
+      {
+	char raw[45], encoded[80];
+	for (char& c : raw)
+	  c = static_cast<char>(r() & 0xFF);
+	const std::size_t len = encode_line(raw, encoded, sizeof raw);
+	return std::string(encoded, len);
+      }
+    std::string text(0 == id ? "/* %W% %E% */ " : "");
+    while (text.size() < s.width)
+      {
+	text += words[r() % (sizeof words / sizeof words[0])];
+	text += ' ';
+      }
+    text.back() = '\n';
+    return text;
+  }
+
+  cssc::Failure
+  generator::write(FILE *fp) const
+  {
+    checksummed_output out(fp);
+    bool ok = (fputs("\001h00000\n", fp) >= 0);
+
+    // Dates go forward ten minutes at each delta from 2001-01-01.
+    const time_t start = 978307200;
+    for (auto it = deltas_.rbegin(); ok && it != deltas_.rend(); ++it)
+      {
+	const delta_entry& d = *it;
+	const time_t when = start + 600 * static_cast<time_t>(d.seq);
+	struct tm tm;
+	char date[32];
+	gmtime_r(&when, &tm);
+	strftime(date, sizeof date, "%y/%m/%d %H:%M:%S", &tm);
+	ok = out.format("\001s %05lu/%05lu/%05lu\n",
+			cap5(d.inserted), cap5(d.deleted), cap5(d.unchanged))
+	  && out.format("\001d D %s %s bench %u %u\n",
+			d.sid, date, unsigned(d.seq), unsigned(d.prev));
+	for (char type : { 'i', 'x' })
+	  {
+	    const std::vector<seq_no>& seqs =
+	      ('i' == type) ? d.included : d.excluded;
+	    if (ok && !seqs.empty())
+	      {
+		ok = out.format("\001%c", type);
+		for (seq_no s : seqs)
+		  ok = ok && out.format(" %u", unsigned(s));
+		ok = ok && out.put("\n", 1);
+	      }
+	  }
+	ok = ok && out.format("\001c delta %u\n\001e\n", unsigned(d.seq));
+      }
+    ok = ok && out.format("\001u\n\001U\n\001f e %c\n\001t\n\001T\n",
+			  shape_.binary ? '1' : '0');
+
+    // Each line is preceded by the control lines needed to bring it
+    // inside the insertion of its delta and the deletions of those
+    // which deleted it.  The blocks are kept strictly nested.
+    std::vector<std::pair<char, seq_no>> open;
+    for (std::size_t ci = 0; ok && ci < chunks_.size(); ++ci)
+      {
+	for (const line *l : chunks_[ci]->lines)
+	  {
+	    std::vector<std::pair<char, seq_no>> want;
+	    want.emplace_back('I', l->ins);
+	    for (seq_no d : l->dels)
+	      want.emplace_back('D', d);
+	    std::size_t keep = 0;
+	    while (keep < open.size()
+		   && std::find(want.begin(), want.end(), open[keep]) != want.end())
+	      ++keep;
+	    while (ok && open.size() > keep)
+	      {
+		ok = out.format("\001E %u\n", unsigned(open.back().second));
+		open.pop_back();
+	      }
+	    for (const auto& w : want)
+	      {
+		if (ok && std::find(open.begin(), open.end(), w) == open.end())
+		  {
+		    ok = out.format("\001%c %u\n", w.first, unsigned(w.second));
+		    open.push_back(w);
+		  }
+	      }
+	    const bool terminator = shape_.binary && l->id == shape_.initial;
+	    const std::string text(terminator ? " \n" : line_text(shape_, l->id));
+	    ok = ok && out.put(text.data(), text.size());
+	  }
+      }
+    while (ok && !open.empty())
+      {
+	ok = out.format("\001E %u\n", unsigned(open.back().second));
+	open.pop_back();
+      }
+
+    if (ok)
+      ok = (0 == fseek(fp, 0L, SEEK_SET))
+	&& fprintf(fp, "\001h%05u", out.sum()) >= 0;
+    if (!ok || ferror(fp))
+      return cssc::make_failure_from_errno(errno);
+    return cssc::Failure::Ok();
+  }
+
+  bool
+  number_arg(const char *arg, unsigned long *result, const char *what)
+  {
+    char *end;
+    errno = 0;
+    *result = strtoul(arg, &end, 10);
+    if (errno || *end || !isdigit(static_cast<unsigned char>(*arg)))
+      {
+	errormsg("Invalid %s: '%s'", what, arg);
+	return false;
+      }
+    return true;
+  }
+}
+
+void
+usage(void)
+{
+  fprintf(stderr,
+	  "usage: %s [-V] [-n deltas] [-b fan-out] [-B branch-length]"
+	  " [-p period] [-l lines] [-L initial-lines] [-c locality]"
+	  " [-x density] [-w width] [-S seed] [-z] file ...\n",
+	  prg_name);
+}
+
+int
+main(int argc, char **argv)
+{
+  set_prg_name(argv[0]);
+
+  shape s;
+  bool ok = true;
+  class CSSC_Options opts(argc, argv, "n!b!B!p!l!L!c!x!w!S!zV");
+  for (int c = opts.next(); c != CSSC_Options::END_OF_ARGUMENTS; c = opts.next())
+    {
+      switch (c)
+	{
+	default:
+	  errormsg("Unsupported option: '%c'", c);
+	  return 2;
+
+	case 'n':
+	  ok = number_arg(opts.getarg(), &s.deltas, "number of deltas") && ok;
+	  break;
+	case 'b':
+	  ok = number_arg(opts.getarg(), &s.fanout, "branch fan-out") && ok;
+	  break;
+	case 'B':
+	  ok = number_arg(opts.getarg(), &s.branch_len, "branch length") && ok;
+	  break;
+	case 'p':
+	  ok = number_arg(opts.getarg(), &s.period, "branch period") && ok;
+	  break;
+	case 'l':
+	  ok = number_arg(opts.getarg(), &s.lines, "lines per delta") && ok;
+	  break;
+	case 'L':
+	  ok = number_arg(opts.getarg(), &s.initial, "initial lines") && ok;
+	  break;
+	case 'c':
+	  ok = number_arg(opts.getarg(), &s.locality, "locality") && ok;
+	  break;
+	case 'x':
+	  ok = number_arg(opts.getarg(), &s.density, "density") && ok;
+	  break;
+	case 'w':
+	  ok = number_arg(opts.getarg(), &s.width, "width") && ok;
+	  break;
+	case 'S':
+	  ok = number_arg(opts.getarg(), &s.seed, "seed") && ok;
+	  break;
+	case 'z':
+	  s.binary = true;
+	  break;
+	case 'V':
+	  version();
+	  if (2 == argc)
+	    return 0;
+	  break;
+	}
+    }
+  if (ok && (s.deltas < 1 || s.period < 1 || s.locality > 100
+	     || s.density > 100))
+    {
+      errormsg("The number of deltas and the branch period must be at least 1,"
+	       " and the locality and density at most 100.");
+      ok = false;
+    }
+  if (!ok)
+    return 2;
+  if (opts.get_index() >= argc)
+    {
+      usage();
+      return 2;
+    }
+
+  int rv = 0;
+  for (int i = opts.get_index(); i < argc; ++i)
+    {
+      const char *name = argv[i];
+      const int fd = open(name, O_WRONLY|O_CREAT|O_EXCL, 0444);
+      FILE *fp = (fd >= 0) ? fdopen(fd, "w") : nullptr;
+      if (nullptr == fp)
+	{
+	  errormsg("%s: %s", name, strerror(errno));
+	  if (fd >= 0)
+	    close(fd);
+	  rv = 1;
+	  continue;
+	}
+      generator gen(s);
+      gen.generate();
+      cssc::Failure written = gen.write(fp);
+      if (EOF == fclose(fp) && written.ok())
+	written = cssc::make_failure_from_errno(errno);
+      if (!written.ok())
+	{
+	  errormsg("%s: %s", name, written.to_string().c_str());
+	  unlink(name);
+	  rv = 1;
+	}
+    }
+  return rv;
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
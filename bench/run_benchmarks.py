@@ -0,0 +1,406 @@
+"""Times the CSSC programs on generated history files.
+
+The corpora are made with the programs under test (admin, get -e and
+delta), from a fixed random seed, so that the same scale gives the
+same files every time; with --mksfile, a much longer history is also
+written directly by that program.  The results are written as JSON, and a
+previous result file can be given with --compare to show how the
+times have changed.
+"""
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import random
+import resource
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+import zlib
+
+FORMAT_VERSION = 1
+
+
+class Tools:
+    """Runs the programs from one directory."""
+
+    def __init__(self, bindir):
+        self.bindir = os.path.abspath(bindir)
+
+    def path(self, prog):
+        return os.path.join(self.bindir, prog)
+
+    def run(self, prog, *args, **kwargs):
+        """Runs PROG, failing if it fails, and returns its output."""
+        argv = [self.path(prog)] + list(args)
+        p = subprocess.run(argv, stdout=kwargs.get("stdout", subprocess.PIPE),
+                           stderr=subprocess.PIPE, cwd=kwargs.get("cwd"))
+        if p.returncode != 0:
+            raise RuntimeError("%s failed (exit status %d): %s"
+                               % (" ".join(argv), p.returncode,
+                                  p.stderr.decode(errors="replace")))
+        return p.stdout
+
+    def version(self):
+        out = subprocess.run([self.path("get"), "-V"], stdout=subprocess.PIPE,
+                             stderr=subprocess.STDOUT).stdout
+        return out.decode(errors="replace").splitlines()[0].strip()
+
+
+def write_lines(name, lines):
+    with open(name, "w") as f:
+        f.write("".join(line + "\n" for line in lines))
+
+
+def edit(rng, lines, locality, width):
+    """Changes a few lines of LINES near a random place, in place.
+
+    LOCALITY is how far from that place (in lines) the changes may be.
+    """
+    if not lines:
+        lines.append(text_line(rng, width))
+        return
+    centre = rng.randrange(len(lines))
+    for _ in range(rng.randint(1, 4)):
+        pos = max(0, min(len(lines) - 1,
+                         centre + rng.randint(-locality, locality)))
+        action = rng.random()
+        if action < 0.4:
+            lines[pos] = text_line(rng, width)
+        elif action < 0.75:
+            lines.insert(pos, text_line(rng, width))
+        elif len(lines) > 1:
+            del lines[pos]
+
+
+WORDS = ("alpha bravo charlie delta echo foxtrot golf hotel india juliet "
+         "kilo lima mike november oscar papa quebec romeo sierra tango "
+         "uniform victor whiskey xray yankee zulu").split()
+
+
+def text_line(rng, width):
+    words = []
+    length = 0
+    while length < width:
+        w = rng.choice(WORDS)
+        words.append(w)
+        length += len(w) + 1
+    return " ".join(words)
+
+
+class Corpus:
+    """Builds the history files to be timed, in a work directory."""
+
+    def __init__(self, tools, workdir, scale, seed, mksfile=None):
+        self.tools = tools
+        self.workdir = workdir
+        self.scale = scale
+        self.seed = seed
+        self.mksfile = mksfile
+        self.files = {}
+
+    def count(self, n):
+        return max(1, int(n * self.scale))
+
+    def make_history(self, name, deltas, lines, width, locality,
+                     binary=False):
+        """Makes s.NAME with DELTAS deltas on the trunk.
+
+        The first version has LINES lines of about WIDTH characters (or
+        if BINARY is set, LINES random bytes).
+        """
+        rng = random.Random("%s/%s" % (self.seed, name))
+        gfile = os.path.join(self.workdir, name)
+        sfile = os.path.join(self.workdir, "s." + name)
+        if binary:
+            with open(gfile, "wb") as f:
+                f.write(bytes(rng.getrandbits(8) for _ in range(lines)))
+            self.tools.run("admin", "-b", "-i" + name, "s." + name,
+                           cwd=self.workdir)
+        else:
+            body = [text_line(rng, width) for _ in range(lines)]
+            write_lines(gfile, body)
+            self.tools.run("admin", "-i" + name, "s." + name,
+                           cwd=self.workdir)
+        os.remove(gfile)
+        for n in range(1, deltas):
+            self.tools.run("get", "-e", "-s", "s." + name, cwd=self.workdir)
+            if binary:
+                with open(gfile, "r+b") as f:
+                    f.seek(rng.randrange(lines))
+                    f.write(bytes(rng.getrandbits(8) for _ in range(64)))
+            else:
+                edit(rng, body, locality, width)
+                write_lines(gfile, body)
+            self.tools.run("delta", "-s", "-ydelta %d" % (n + 1),
+                           "s." + name, cwd=self.workdir)
+        self.files[name] = sfile
+
+    def make_branches(self, name, branches, width):
+        """Adds BRANCHES branch deltas to s.NAME, some of them with
+        include and exclude lists, and returns their SIDs."""
+        rng = random.Random("%s/%s/branches" % (self.seed, name))
+        sname = "s." + name
+        gfile = os.path.join(self.workdir, name)
+        self.tools.run("admin", "-fb", sname, cwd=self.workdir)
+        top = int(self.tools.run("prs", "-d:R:.:L:", sname,
+                                 cwd=self.workdir).decode().split(".")[1])
+        made = []
+        for n in range(branches):
+            base = rng.randint(max(1, top // 2), top)
+            args = ["-e", "-s", "-b", "-r1.%d" % base]
+            if made and n % 3 == 1:
+                args.append("-i" + rng.choice(made))
+            if base > 2 and n % 3 == 2:
+                args.append("-x1.%d" % rng.randint(2, base - 1))
+            self.tools.run("get", *(args + [sname]), cwd=self.workdir)
+            lines = open(gfile).read().splitlines()
+            edit(rng, lines, 20, width)
+            write_lines(gfile, lines)
+            out = self.tools.run("delta", "-ybranch %d" % n, sname,
+                                 cwd=self.workdir)
+            made.append(out.decode().splitlines()[0].strip())
+        return made
+
+    def make_tree(self, name, depth, fanout, per_dir):
+        """Makes a directory tree with history files in SCCS/ at
+        every level, and returns their names."""
+        rng = random.Random("%s/%s" % (self.seed, name))
+        root = os.path.join(self.workdir, name)
+        sfiles = []
+
+        def fill(directory, level):
+            sccs = os.path.join(directory, "SCCS")
+            os.makedirs(sccs)
+            for i in range(per_dir):
+                g = "file%d.c" % i
+                write_lines(os.path.join(sccs, g),
+                            [text_line(rng, 60) for _ in range(50)])
+                self.tools.run("admin", "-i" + g, "s." + g, cwd=sccs)
+                os.remove(os.path.join(sccs, g))
+                sfiles.append(os.path.join(sccs, "s." + g))
+            if level < depth:
+                for i in range(fanout):
+                    fill(os.path.join(directory, "dir%d" % i), level + 1)
+
+        fill(root, 1)
+        # Leave a few files locked, for sact.
+        for sfile in sfiles[::7]:
+            self.tools.run("get", "-e", "-s", "-g", sfile)
+        return root, sfiles
+
+    def build(self):
+        c = self.count
+        self.make_history("many.c", deltas=c(1000), lines=c(5000),
+                          width=60, locality=50)
+        self.make_history("branched.c", deltas=c(300), lines=c(3000),
+                          width=60, locality=200)
+        self.branch_sids = self.make_branches("branched.c", c(60), 60)
+        self.make_history("long.txt", deltas=c(50), lines=c(1000),
+                          width=4000, locality=20)
+        self.make_history("data.bin", deltas=c(20), lines=c(1024 * 1024),
+                          width=0, locality=0, binary=True)
+        self.tree, self.tree_files = self.make_tree("tree", depth=4,
+                                                    fanout=c(3), per_dir=2)
+        big = os.path.join(self.workdir, "big.txt")
+        rng = random.Random("%s/big" % self.seed)
+        write_lines(big, [text_line(rng, 70) for _ in range(c(200000))])
+        self.big_input = big
+        if self.mksfile:
+            self.make_synthetic("synthetic.c", c(20000))
+
+    def make_synthetic(self, name, deltas):
+        """Writes s.NAME directly with mksfile, which is much quicker
+        than running delta for each delta."""
+        argv = [self.mksfile, "-n%d" % deltas, "-b3", "-B2", "-p10", "-x5",
+                "-S%d" % zlib.crc32(str(self.seed).encode()), "s." + name]
+        p = subprocess.run(argv, stderr=subprocess.PIPE, cwd=self.workdir)
+        if p.returncode != 0:
+            raise RuntimeError("%s failed (exit status %d): %s"
+                               % (" ".join(argv), p.returncode,
+                                  p.stderr.decode(errors="replace")))
+        self.files[name] = os.path.join(self.workdir, "s." + name)
+
+
+class Runner:
+    """Times commands, repeating each several times."""
+
+    def __init__(self, tools, repeat):
+        self.tools = tools
+        self.repeat = repeat
+        self.results = []
+
+    def time(self, name, corpus, argv, cwd, prepare=None):
+        walls, users, systems = [], [], []
+        for _ in range(self.repeat):
+            if prepare:
+                prepare()
+            before = resource.getrusage(resource.RUSAGE_CHILDREN)
+            start = time.perf_counter()
+            p = subprocess.run([self.tools.path(argv[0])] + argv[1:],
+                               stdout=subprocess.DEVNULL,
+                               stderr=subprocess.PIPE, cwd=cwd)
+            wall = time.perf_counter() - start
+            after = resource.getrusage(resource.RUSAGE_CHILDREN)
+            if p.returncode != 0:
+                raise RuntimeError("%s failed (exit status %d): %s"
+                                   % (" ".join(argv), p.returncode,
+                                      p.stderr.decode(errors="replace")))
+            walls.append(wall)
+            users.append(after.ru_utime - before.ru_utime)
+            systems.append(after.ru_stime - before.ru_stime)
+        walls.sort()
+        result = {
+            "name": name,
+            "corpus": corpus,
+            "command": " ".join(argv),
+            "runs": self.repeat,
+            "wall_min": round(walls[0], 6),
+            "wall_median": round(walls[len(walls) // 2], 6),
+            "user_mean": round(sum(users) / len(users), 6),
+            "sys_mean": round(sum(systems) / len(systems), 6),
+        }
+        self.results.append(result)
+        print("%-22s %-12s %9.4fs" % (name, corpus, result["wall_median"]),
+              file=sys.stderr)
+
+
+def run_benchmarks(tools, corpus, runner):
+    w = corpus.workdir
+    many, branched = "s.many.c", "s.branched.c"
+    runner.time("get-latest", "many.c", ["get", "-p", "-s", many], w)
+    runner.time("get-latest-k", "many.c", ["get", "-p", "-s", "-k", many], w)
+    runner.time("get-old", "many.c", ["get", "-p", "-s", "-r1.2", many], w)
+    runner.time("get-old-k", "many.c",
+                ["get", "-p", "-s", "-k", "-r1.2", many], w)
+    runner.time("get-branch", "branched.c",
+                ["get", "-p", "-s", "-r" + corpus.branch_sids[-1], branched],
+                w)
+    runner.time("get-long-lines", "long.txt",
+                ["get", "-p", "-s", "s.long.txt"], w)
+    runner.time("get-binary", "data.bin", ["get", "-p", "-s", "s.data.bin"],
+                w)
+    runner.time("prs-e", "many.c", ["prs", "-e", many], w)
+    runner.time("prs-e", "branched.c", ["prs", "-e", branched], w)
+    runner.time("val", "many.c", ["val", many], w)
+    runner.time("val", "branched.c", ["val", branched], w)
+    runner.time("val", "tree", ["val"] + corpus.tree_files, w)
+    runner.time("prs-L", "tree", ["prs", "-L"] + corpus.tree_files, w)
+    runner.time("sact-R", "tree", ["sact", "-R", "tree"], w)
+    if "synthetic.c" in corpus.files:
+        synthetic = "s.synthetic.c"
+        runner.time("get-latest", "synthetic.c",
+                    ["get", "-p", "-s", synthetic], w)
+        runner.time("get-old", "synthetic.c",
+                    ["get", "-p", "-s", "-r1.2", synthetic], w)
+        runner.time("prs-e", "synthetic.c", ["prs", "-e", synthetic], w)
+        runner.time("val", "synthetic.c", ["val", synthetic], w)
+
+    # admin -i and delta change their files, so each run starts afresh.
+    big_s = os.path.join(w, "s.big.txt")
+
+    def no_big():
+        if os.path.exists(big_s):
+            os.remove(big_s)
+    runner.time("admin-i", "big.txt", ["admin", "-ibig.txt", "s.big.txt"], w,
+                prepare=no_big)
+
+    pristine = os.path.join(w, "pristine.many.c")
+    shutil.copyfile(os.path.join(w, many), pristine)
+    rng = random.Random("%s/delta" % corpus.seed)
+
+    def checked_out():
+        for name in (many, "p.many.c", "many.c"):
+            path = os.path.join(w, name)
+            if os.path.exists(path):
+                os.remove(path)
+        shutil.copyfile(pristine, os.path.join(w, many))
+        os.chmod(os.path.join(w, many), 0o444)
+        tools.run("get", "-e", "-s", many, cwd=w)
+        lines = open(os.path.join(w, "many.c")).read().splitlines()
+        edit(rng, lines, 50, 60)
+        write_lines(os.path.join(w, "many.c"), lines)
+    runner.time("delta", "many.c", ["delta", "-s", "-ytimed", many], w,
+                prepare=checked_out)
+
+
+def compare(results, old_file):
+    """Prints the change in median time from OLD_FILE for each result."""
+    with open(old_file) as f:
+        old = json.load(f)
+    before = {(r["name"], r["corpus"]): r for r in old["results"]}
+    print("%-22s %-12s %10s %10s %8s" % ("benchmark", "corpus", "old", "new",
+                                         "change"))
+    for r in results:
+        key = (r["name"], r["corpus"])
+        if key not in before:
+            continue
+        o, n = before[key]["wall_median"], r["wall_median"]
+        change = "%+7.1f%%" % (100.0 * (n - o) / o) if o > 0 else "n/a"
+        print("%-22s %-12s %9.4fs %9.4fs %8s" % (key + (o, n, change)))
+
+
+def main(args):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--bindir", default="../src",
+                        help="directory containing the programs to time")
+    parser.add_argument("--scale", type=float, default=1.0,
+                        help="multiplies the size of each corpus")
+    parser.add_argument("--repeat", type=int, default=5,
+                        help="number of times to run each command")
+    parser.add_argument("--seed", default="cssc",
+                        help="seed for generating the corpora")
+    parser.add_argument("--output", "-o", default="-",
+                        help="file for the JSON results (default stdout)")
+    parser.add_argument("--compare",
+                        help="earlier JSON results to compare against")
+    parser.add_argument("--mksfile",
+                        help="the mksfile program, to make a much longer"
+                        " history than delta could in the time")
+    parser.add_argument("--keep", action="store_true",
+                        help="keep the work directory")
+    opts = parser.parse_args(args[1:])
+    if opts.repeat < 1 or opts.scale <= 0:
+        parser.error("--repeat and --scale must be positive")
+
+    tools = Tools(opts.bindir)
+    workdir = tempfile.mkdtemp(prefix="cssc-bench.")
+    try:
+        mksfile = os.path.abspath(opts.mksfile) if opts.mksfile else None
+        corpus = Corpus(tools, workdir, opts.scale, opts.seed, mksfile)
+        start = time.perf_counter()
+        corpus.build()
+        print("corpora built in %.1fs in %s"
+              % (time.perf_counter() - start, workdir), file=sys.stderr)
+        runner = Runner(tools, opts.repeat)
+        run_benchmarks(tools, corpus, runner)
+    finally:
+        if opts.keep:
+            print("work directory kept: %s" % workdir, file=sys.stderr)
+        else:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+    report = {
+        "format": FORMAT_VERSION,
+        "version": tools.version(),
+        "scale": opts.scale,
+        "repeat": opts.repeat,
+        "seed": opts.seed,
+        "results": runner.results,
+    }
+    text = json.dumps(report, indent=1, sort_keys=True) + "\n"
+    if opts.output == "-":
+        sys.stdout.write(text)
+    else:
+        with open(opts.output, "w") as f:
+            f.write(text)
+    if opts.compare:
+        compare(runner.results, opts.compare)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -37,7 +37,8 @@ sub decode( $ );
 sub quote( $ );
 sub directory( $ );
 sub regfile( $ );
-sub dirent( $$ );
+sub dirent( $$$ );
+sub listing( $ );
 sub tempfile();
 sub filter( $$$ );
 sub save( $ );
@@ -87,6 +88,13 @@ sub directory( $ ) {
     || error("opening $path: $!");
   my @files = readdir D;
   closedir D;
+  # one prs for the history files here and one for those in SCCS/,
+  # rather than one for each file
+  my %info = listing("$root/$path");
+  my %sccs = listing("$root/$path/SCCS");
+  for(keys %sccs) {
+    $info{$1} = $sccs{$_} if /^s\.(.*)$/s && !exists $info{$1};
+  }
   my @bgcolors = ("#ffffff", "#c0ffc0");
   my $n = 0;
   html("SCCS: $path",
@@ -101,21 +109,37 @@ sub directory( $ ) {
        " </tr>\n",
        ($path ne "/"
 	? (" <tr bgcolor=" . $bgcolors[$n++%2] .">\n",
-	   dirent($path, ".."),
+	   dirent($path, "..", {}),
 	   " </tr>\n",
 	  )
 	: ()),
        map((
 	    " <tr bgcolor=" . $bgcolors[$n++%2] .">\n",
-	    dirent($path, $_),
+	    dirent($path, $_, \%info),
 	    " </tr>\n",
 	   ), grep { $_ ne "." && $_ ne ".." } sort @files),
        "</table>\n");
 }
 
-sub dirent( $$ ) {
+# Runs prs once for all the history files in a directory, and returns
+# a hash from their names to the user, SID, date and comment of the
+# latest delta of each.
+sub listing( $ ) {
+  my $dir = shift;
+  my %info = ();
+  return %info if ! -d $dir;
+  for(`sccs prs -L -d\Q:F:\\t:P:\\t:I:\\t:D:\\t:C:\E \Q$dir\E`) {
+    chomp;
+    my ($file, @fields) = split(/\t/, $_, 5);
+    $info{$file} = \@fields if @fields == 4;
+  }
+  return %info;
+}
+
+sub dirent( $$$ ) {
   my $path = shift;
   my $file = shift;
+  my $info = shift;
 
   my $link;
   if($file eq "..") {
@@ -136,11 +160,8 @@ sub dirent( $$ ) {
   my $id = "&nbsp;";
   my $date = "&nbsp;";
   my $comment = "&nbsp;";
-  if($type eq "file") {
-    my $prs = `sccs prs -d\Q:P: :I: :D: :C:\E \Q$root/$path/$file\E`;
-    ($who, $id, $date, $comment) = map(quote($_),
-				       ($prs =~ /^(\S+) (\S+) (\S+) (.*)/))
-      if !$?;
+  if($type eq "file" && exists $info->{$file}) {
+    ($who, $id, $date, $comment) = map(quote($_), @{$info->{$file}});
   }
   return ("  <td>\n",
 	  "   <a href=\"",
@@ -38,6 +38,7 @@
 #include "version.h"
 #include "delta.h"
 #include "except.h"
+#include "stats.h"
 
 
 static bool
@@ -59,7 +60,7 @@ well_formed_sccsname(const sccs_name& n)
 void
 usage() {
 	fprintf(stderr,
-"usage: %s [-nrzV] [-a users] [-d flags] [-e users] [-f flags]\n"
+"usage: %s [-nrzCV] [-a users] [-d flags] [-e users] [-f flags]\n"
 "\t[-i file] [-m MRs] [-t file] [-y comments] file ...\n",
 	prg_name);
 }
@@ -82,6 +83,7 @@ main(int argc, char **argv)
   int check_checksum = 0;	                /* -h */
   int validate       = 0;	                /* also -h */
   int reset_checksum = 0;			/* -z */
+  bool compact_body = false;			/* -C */
   int suppress_mrs = 0;				/* -m " " (i.e. no actual MRs) */
   int suppress_comments = 0;			/* -y (no arg) */
   int empty_t_option = 0;	                /* -t (no arg) */
@@ -109,10 +111,11 @@ main(int argc, char **argv)
   } else {
     set_prg_name("admin");
   }
+  start_stats();
 
   retval = 0;
 
-  class CSSC_Options opts(argc, argv, "bni!r!t!f!d!a!e!m!y!hzV");
+  class CSSC_Options opts(argc, argv, "bni!r!t!f!d!a!e!m!y!hzCV");
   for (c = opts.next();
        c != CSSC_Options::END_OF_ARGUMENTS;
        c = opts.next()) {
@@ -214,6 +217,10 @@ main(int argc, char **argv)
       reset_checksum = 1;
       break;
 
+    case 'C':
+      compact_body = true;
+      break;
+
     case 'V':
       version();
       if (2 == argc)
@@ -383,7 +390,7 @@ main(int argc, char **argv)
 	    }
 	  else
 	    {
-	      if (!file.update())
+	      if (!file.update(compact_body))
 		retval = 1;
 	    }
 	}
@@ -0,0 +1,110 @@
+/*
+ * ancestry.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Members of the class ancestry_index.
+ *
+ */
+
+#include <config.h>
+
+#include "cssc.h"
+#include "ancestry.h"
+#include "delta-table.h"
+
+
+ancestry_index::ancestry_index(const cssc_delta_table& table)
+  : highest_(table.highest_seqno()),
+    has_seq_lists_(false),
+    prev_(highest_ + 1u, 0),
+    depth_(highest_ + 1u, 0uL),
+    chain_ok_(highest_ + 1u, false),
+    saved_()
+{
+  // A predecessor always has a lower sequence number than its
+  // successor, so working upward we have always seen it already.
+  for (seq_no s = 1; s <= highest_; ++s)
+    {
+      if (!table.delta_at_seq_exists(s))
+	continue;
+      const delta& d = table.delta_at_seq(s);
+      if (!d.get_included_seqnos().empty()
+	  || !d.get_excluded_seqnos().empty()
+	  || !d.get_ignored_seqnos().empty())
+	{
+	  has_seq_lists_ = true;
+	}
+
+      const seq_no p = d.prev_seq();
+      prev_[s] = p;
+      if (0 == p)
+	{
+	  chain_ok_[s] = true;
+	}
+      else if (p < s && chain_ok_[p])
+	{
+	  chain_ok_[s] = true;
+	  depth_[s] = depth_[p] + 1u;
+	}
+    }
+}
+
+
+bool
+ancestry_index::chain_ok(seq_no seq) const
+{
+  return seq > 0 && seq <= highest_ && chain_ok_[seq];
+}
+
+
+seq_set
+ancestry_index::ancestors(seq_no seq)
+{
+  ASSERT(chain_ok(seq));
+
+  // Walk back to the nearest saved bitset (or past the first delta).
+  std::vector<seq_no> path;
+  seq_no s = seq;
+  std::unordered_map<seq_no, seq_set>::const_iterator found;
+  while (s != 0 && (found = saved_.find(s)) == saved_.end())
+    {
+      path.push_back(s);
+      s = prev_[s];
+    }
+
+  seq_set result;
+  if (s != 0)
+    result = found->second;
+  result.resize(seq / 64u + 1u, 0u);
+
+  // Walk forward again, saving the bitsets we will want next time.
+  for (auto i = path.rbegin(); i != path.rend(); ++i)
+    {
+      result[*i / 64u] |= std::uint64_t(1u) << (*i % 64u);
+      if (depth_[*i] % Interval == 0)
+	{
+	  saved_[*i] = seq_set(result.begin(),
+			       result.begin() + (*i / 64u + 1u));
+	}
+    }
+  return result;
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,93 @@
+/*
+ * ancestry.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Defines the class ancestry_index, which finds the predecessor chain
+ * of any delta of a history file as a bitset.
+ *
+ */
+
+#ifndef CSSC__ANCESTRY_H__
+#define CSSC__ANCESTRY_H__
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "delta.h"		/* for seq_no */
+
+class cssc_delta_table;
+
+// A set of sequence numbers; bit (s % 64) of word (s / 64) is set if
+// s is a member.
+typedef std::vector<std::uint64_t> seq_set;
+
+// An ancestry_index is built from a delta table (in one pass over it)
+// and answers the question "which deltas are on the predecessor chain
+// of this one?".  Finding the chain of one delta means walking the
+// chain, so we keep the bitsets for every 64th generation, and the
+// chain of any delta is found by copying the nearest of those and
+// walking at most 63 more steps.  That costs about N*N/512 bytes for
+// a delta table with N deltas, in the worst case, so a single get
+// walks the chain instead (see sccs_file::use_ancestry()).
+//
+// Deltas can be added to the table but the predecessors of existing
+// deltas never change, so the index is still correct for any delta
+// it knew about; highest_seqno() tells the owner when to rebuild it.
+class ancestry_index
+{
+public:
+  explicit ancestry_index(const cssc_delta_table&);
+
+  seq_no highest_seqno() const { return highest_; }
+
+  // True if the chain from seq back to the first delta is sound:
+  // every delta on it exists and has an earlier predecessor.  If not,
+  // ancestors() must not be called for seq.
+  bool chain_ok(seq_no seq) const;
+
+  // True if any delta has a list of included, excluded or ignored
+  // deltas (so that more than the chain decides what get retrieves).
+  bool has_seq_lists() const { return has_seq_lists_; }
+
+  // The set of deltas on the chain from seq to the first delta,
+  // including seq itself.
+  seq_set ancestors(seq_no seq);
+
+  static bool member(const seq_set& set, seq_no s)
+  {
+    const size_t word = s / 64u;
+    return word < set.size() && (set[word] >> (s % 64u)) & 1u;
+  }
+
+private:
+  enum { Interval = 64 };
+
+  seq_no highest_;
+  bool has_seq_lists_;
+  std::vector<seq_no> prev_;
+  std::vector<unsigned long> depth_;
+  std::vector<bool> chain_ok_;
+  std::unordered_map<seq_no, seq_set> saved_;
+};
+
+#endif /* CSSC__ANCESTRY_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -23,14 +23,18 @@
 #include "config.h"
 
 #include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 #include "cssc.h"
 #include "base-reader.h"
 #include "quit.h"
 
-unsigned short strict_atous(const sccs_file_location& loc, const char *s)
+seq_no strict_atoseq(const sccs_file_location& loc, const char *s)
 {
-  long n = 0;
+  unsigned long long n = 0;
   bool empty = true;
   char c;
   while ( 0 != (c=*s++) )
@@ -41,7 +45,7 @@ unsigned short strict_atous(const sccs_file_location& loc, const char *s)
 	}
       empty = false;
       n = n * 10 + (c - '0');
-      if (n > 65535L)
+      if (n > max_seq_no)
 	{
 	  corrupt(loc, "Number too big");
 	}
@@ -50,12 +54,53 @@ unsigned short strict_atous(const sccs_file_location& loc, const char *s)
     {
       corrupt(loc, "Missing number");
     }
-  return static_cast<unsigned short>(n);
+  return static_cast<seq_no>(n);
 }
 
+#ifdef HAVE_COPY_FILE_RANGE
+/* Copy as much as we can of the rest of IN to OUT inside the kernel,
+ * so that the data does not pass through our buffers (and on file
+ * systems which support it, is shared with the original rather than
+ * copied at all).  Both streams are left positioned after the data
+ * which was copied, so the caller can use stdio for anything which
+ * remains, for example when the files are on different file systems.
+ */
+static cssc::Failure
+copy_in_kernel(FILE *in, FILE *out)
+{
+  if (fflush(out) == EOF)
+    return cssc::make_failure_builder_from_errno(errno) << "short write";
+
+  off_t in_pos = ftello(in);
+  off_t out_pos = ftello(out);
+  if (in_pos == -1 || out_pos == -1)
+    return cssc::Failure::Ok();	// We'll use stdio instead.
+  const off_t start = in_pos;
+
+  enum { ChunkSize = 1 << 30 };
+  while (copy_file_range(fileno(in), &in_pos, fileno(out), &out_pos,
+			 ChunkSize, 0) > 0)
+    continue;
+
+  if (in_pos != start)
+    {
+      if (fseeko(in, in_pos, SEEK_SET) != 0)
+	return cssc::make_failure_builder_from_errno(errno) << "seek failure";
+      if (fseeko(out, out_pos, SEEK_SET) != 0)
+	return cssc::make_failure_builder_from_errno(errno) << "seek failure";
+    }
+  return cssc::Failure::Ok();
+}
+#endif
+
 cssc::Failure
 sccs_file_reader_base::copy_to(FILE* out)
 {
+#ifdef HAVE_COPY_FILE_RANGE
+  cssc::Failure copied = copy_in_kernel(f_, out);
+  if (!copied.ok())
+    return copied;
+#endif
   enum { BufSize = 8192 };
    std::unique_ptr<char[]> buf{new char[BufSize]};
    size_t nread;
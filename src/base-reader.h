@@ -26,11 +26,13 @@
 #include <string.h>
 #include <memory>
 
+#include "delta.h"		/* for seq_no */
 #include "failure.h"
 #include "failure_or.h"
 #include "linebuf.h"
 #include "location.h"
 #include "quit.h"
+#include "stats.h"
 
 class sccs_file_reader_base
 {
@@ -114,7 +116,9 @@ class sccs_file_reader_base
     here_.advance_line();
     // chomp the newline from the end of the line.
     // TODO: make me 8-bit clean!
-    (*plinebuf)[strlen(plinebuf->c_str()) - 1] = '\0';
+    const size_t len = strlen(plinebuf->c_str());
+    stats_count_line(len, bufchar(0) == '\001');
+    (*plinebuf)[len - 1] = '\0';
     return 0;
   }
 
@@ -138,7 +142,7 @@ class sccs_file_reader_base
   FILE *f_;
 };
 
-unsigned short strict_atous(const sccs_file_location&, const char *s);
+seq_no strict_atoseq(const sccs_file_location&, const char *s);
 
 
 #endif /* CSSC__BASE_READER_H__ */
@@ -23,12 +23,16 @@
 #include "config.h"
 #include "cssc.h"
 
+#include <ctype.h>
 #include <string.h>
+#include <algorithm>
 #include <cstdio>
 #include <memory>
 #include <system_error>
+#include <vector>
 
 #include "body-scanner.h"
+#include "comb-plan.h"
 #include "delta.h"
 #include "delta-table.h"
 #include "diff-state.h"
@@ -40,6 +44,7 @@
 #include "ioerr.h"
 #include "linebuf.h"
 #include "seqstate.h"
+#include "stats.h"
 #include "subst-parms.h"
 #include "quit.h"
 
@@ -49,11 +54,13 @@ using cssc::FailureOr;
 using cssc::make_failure_builder_from_errno;
 
 sccs_file_body_scanner::sccs_file_body_scanner(const std::string& filename,
-					       FILE*f, off_t body_pos, long line_number)
+					       FILE*f, off_t body_pos, long line_number,
+					       int body_sum)
   : sccs_file_reader_base(filename, f, sccs_file_location(filename, line_number)),
     f_(f),
     body_start_(body_pos),
-    start_(filename, line_number)
+    start_(filename, line_number),
+    body_sum_(body_sum)
 {
 }
 
@@ -90,6 +97,7 @@ sccs_file_body_scanner::get(const std::string& gname,
 			    struct subst_parms &parms,
 			    bool do_kw_subst, bool /*debug*/, bool show_module, bool show_sid)
 {
+  stats_timer timer(stats_phase::body);
   const seq_no highest_delta_seqno = delta_table.highest_seqno();
 
   cssc::Failure seek = seek_to_body();
@@ -121,7 +129,7 @@ sccs_file_body_scanner::get(const std::string& gname,
    * example, SunOS 4.1.1's SCCS implementation doesn't always
    * start with ^AI 1.
    */
-  unsigned short first_delta = strict_atous(here(), plinebuf->c_str() + 3);
+  seq_no first_delta = strict_atoseq(here(), plinebuf->c_str() + 3);
   state.start(first_delta, 'I'); /* 'I' means "insert". */
 
   FILE *out = parms.out;
@@ -144,6 +152,7 @@ sccs_file_body_scanner::get(const std::string& gname,
 	}
 
       parms.out_lineno++;
+      stats_count(stats_counter::lines_emitted);
 
       if (show_module)
         fprintf(out, "%s\t", parms.get_module_name().c_str());
@@ -157,6 +166,7 @@ sccs_file_body_scanner::get(const std::string& gname,
         }
       if (do_kw_subst && !encoded)
 	{
+	  stats_timer kw_timer(stats_phase::keywords);
 	  cssc::Failure wrote = write_subst(plinebuf->c_str(), parms.delta, false);
 	  if (!wrote.ok())
 	    {
@@ -178,7 +188,11 @@ sccs_file_body_scanner::get(const std::string& gname,
 	      if (!parms.found_id && plinebuf->check_id_keywords())
 		  parms.found_id = 1;
 	    }
-	  cssc::Failure wrote = outputfn(out, plinebuf.get());
+	  cssc::Failure wrote = Failure::Ok();
+	  {
+	    stats_timer output_timer(stats_phase::output);
+	    wrote = outputfn(out, plinebuf.get());
+	  }
 	  if (!wrote.ok())
 	    {
 	      return cssc::make_failure_builder(wrote)
@@ -191,7 +205,7 @@ sccs_file_body_scanner::get(const std::string& gname,
     /* A control line */
 
     check_arg();
-    seq_no seq = strict_atous(here(), plinebuf->c_str() + 3);
+    seq_no seq = strict_atoseq(here(), plinebuf->c_str() + 3);
     if (seq < 1 || seq > highest_delta_seqno) {
       corrupt(here(), "Invalid serial number %u converted from '%s'", unsigned(seq), plinebuf->c_str());
       /*NOTREACHED*/
@@ -234,6 +248,7 @@ sccs_file_body_scanner::get(const std::string& gname,
     }
   }
 
+  stats_timer output_timer(stats_phase::output);
   if (fflush_failed(fflush(out)))
     {
       return cssc::make_failure_builder_from_errno(errno)
@@ -277,6 +292,7 @@ sccs_file_body_scanner::delta(const std::string& dname,
 			      seq_state *sstate, FILE *out,
 			      bool display_diff_output)
 {
+  stats_timer timer(stats_phase::body);
   delta_result result;
   if (!seek_to_body().ok())  // prepare to read the body for predecessor.
     {
@@ -321,7 +337,7 @@ sccs_file_body_scanner::delta(const std::string& dname,
 	  if (got_line && c != 0)
 	    {
 	      // it's a control line.
-	      seq_no seq = strict_atous(here(), plinebuf->c_str() + 3);
+	      seq_no seq = strict_atoseq(here(), plinebuf->c_str() + 3);
 
 #ifdef JAY_DEBUG
 	      fprintf(stderr, "control line: %c %lu\n", c, (unsigned)seq);
@@ -575,6 +591,7 @@ sccs_file_body_scanner::emit_raw_body(FILE* out, const char *outname)
 cssc::Failure
 sccs_file_body_scanner::print_body(FILE *out, const std::string& outname)
 {
+  stats_timer timer(stats_phase::body);
   bool ret = true;
 
   // When pos_saver goes out of scope the file position on "f_" is restored.
@@ -693,78 +710,716 @@ namespace
 }  // namespace
 
 
-cssc::Failure
+/* Copy the body to OUT, leaving out the insertions of delta SEQ and
+ * all its control lines.  Most of the body is copied unchanged, so
+ * rather than reading it line by line we look only for the starts of
+ * control lines, and write (or skip) the text between them in bulk.
+ * Returns the contribution of the new body to the checksum, which we
+ * can work out from that of the old one and what we left out.
+ */
+cssc::FailureOr<int>
 sccs_file_body_scanner::remove(FILE *out, seq_no seq)
 {
+  stats_timer timer(stats_phase::body);
+  Failure seek = seek_to_body();
+  if (!seek.ok())
+    return cssc::make_failure_builder(seek).diagnose();
+
+  auto corrupt_here = [this](long line, const char *what) -> Failure
+    {
+      here_.set_line_number(line);
+      return cssc::make_failure_builder(cssc::errorcode::HistoryFileCorrupt)
+	.diagnose() << what << " at " << here();
+    };
+  auto write_span = [out](const char *start, const char *end) -> Failure
+    {
+      const size_t len = end - start;
+      Failure wrote = fwrite_failed(fwrite(start, 1, len, out), len);
+      if (!wrote.ok())
+	{
+	  return cssc::make_failure_builder(wrote)
+	    .diagnose() << "write error on output file";
+	}
+      return Failure::Ok();
+    };
+  auto checksum = [](const char *start, const char *end)
+    {
+      int sum = 0;
+      while (start < end)
+	sum += *start++;	// plain char, as for the whole file.
+      return sum;
+    };
+
   update_state state = COPY;
+  long line = start_.line_number();
+  int dropped = 0;		// checksum of what we left out.
+  std::vector<char> buf(1 << 20);
+  size_t pos = 0, have = 0;	// unprocessed data is buf[pos, have).
+  bool eof = false;
+  bool at_line_start = true;
+
   for (;;)
     {
-      FailureOr<char> got = read_line();
-      if (!got.ok())
+      if (!eof)
 	{
-	  if (isEOF(got.fail()))
-	    break;
-	  else
-	    return got.fail();
+	  // Keep the unprocessed data (part of a control line) and refill.
+	  std::copy(buf.begin() + pos, buf.begin() + have, buf.begin());
+	  have -= pos;
+	  pos = 0;
+	  if (have == buf.size())
+	    buf.resize(buf.size() * 2);
+	  const size_t got = fread(&buf[have], 1, buf.size() - have, f_);
+	  if (0 == got)
+	    {
+	      if (ferror(f_))
+		{
+		  return cssc::make_failure_builder_from_errno(errno)
+		    .diagnose() << "read error on " << name();
+		}
+	      eof = true;
+	    }
+	  have += got;
 	}
+      if (pos == have)
+	break;
 
-      const char c = *got;
-      if (0 != c)
+      const char *const end = &buf[0] + have;
+      while (pos < have)
 	{
-	  check_arg();
-	  if (strict_atous(here(), plinebuf->c_str() + 3) == seq)
+	  const char *p = &buf[pos];
+	  if (at_line_start && '\001' == *p)
+	    {
+	      const char *nl = static_cast<const char*>(memchr(p, '\n', end - p));
+	      if (nullptr == nl && !eof)
+		break;		// we need the rest of the line.
+	      const char *line_end = nl ? nl + 1 : end;
+	      const char *const last = nl ? nl : end;
+	      ++line;
+
+	      if (last - p < 4 || p[2] != ' ')
+		return corrupt_here(line, "missing serial number");
+	      unsigned long long s = 0;
+	      for (const char *d = p + 3; d < last; ++d)
+		{
+		  if (!isdigit(static_cast<unsigned char>(*d)))
+		    return corrupt_here(line, "invalid serial number");
+		  s = s * 10 + (*d - '0');
+		  if (s > max_seq_no)
+		    return corrupt_here(line, "invalid serial number");
+		}
+
+	      if (s == seq)
+		{
+		  if (!next_state(state, p[1]))
+		    return corrupt_here(line, "unexpected control line");
+		  dropped += checksum(p, line_end);
+		}
+	      else if (state == INSERT)
+		{
+		  return corrupt_here(line, "non-terminal delta");
+		}
+	      else
+		{
+		  TRY_OPERATION(write_span(p, line_end));
+		}
+	      pos = line_end - &buf[0];
+	      continue;
+	    }
+
+	  // Text, up to the next line which starts with ^A.
+	  const char *stop = end;
+	  const char *q = p;
+	  while (nullptr != (q = static_cast<const char*>(memchr(q, '\001', end - q))))
 	    {
-	      if (!next_state(state, c))
+	      if (q != p && '\n' == q[-1])
 		{
-		  return cssc::make_failure_builder(cssc::errorcode::HistoryFileCorrupt)
-		    << "unexpected control line at " << here();
+		  stop = q;
+		  break;
 		}
+	      ++q;
 	    }
-	  else if (state == INSERT)
+	  line += std::count(p, stop, '\n');
+	  if (state == INSERT)
+	    dropped += checksum(p, stop);
+	  else
+	    TRY_OPERATION(write_span(p, stop));
+	  at_line_start = ('\n' == stop[-1]);
+	  pos = stop - &buf[0];
+	}
+    }
+
+  // We should end the file after an 'E', that is,
+  // in the 'COPY' state.
+  if (state != COPY)
+    {
+      return corrupt_here(line, "unexpected EOF");
+    }
+  return (body_sum_ - dropped) & 0xFFFF;
+}
+
+namespace
+{
+  /* Writes a body one text line at a time, given the blocks each
+   * line belongs in, using as few control lines as possible.
+   *
+   * Whether a line is visible depends only on the latest delta with
+   * an open ^AI block (the one which inserted it) and the open ^AD
+   * blocks of later deltas (see seq_state::decide_disposition()).
+   * Between lines we close only the blocks which would change that,
+   * so an ^AI block stays open around the blocks of later deltas
+   * nested inside it (as in any body), and an ^AD block stays open
+   * over lines inserted after it, where it makes no difference.  Each
+   * block then covers the longest run of lines it can, so there are
+   * as few of them as there can be.
+   */
+  class weave_writer
+  {
+  public:
+    weave_writer(FILE *out, seq_no highest)
+      : out_(out), sum_(0), wrote_text_(false), line_ins_(0), line_dels_(),
+	ins_(), del_(), del_open_(highest + 1u, false)
+    {
+    }
+
+    // Write |text| (and a newline) as a line inserted by |ins| and
+    // deleted by |dels|, which is sorted and has only later deltas.
+    Failure line(const char *text, seq_no ins, const std::vector<seq_no>& dels)
+    {
+      if (ins != line_ins_ || dels != line_dels_)
+	{
+	  TRY_OPERATION(move_to(ins, dels));
+	  line_ins_ = ins;
+	  line_dels_ = dels;
+	}
+      TRY_OPERATION(emit(text, strlen(text)));
+      wrote_text_ = true;
+      return emit("\n", 1);
+    }
+
+    // Close every open block.
+    Failure finish()
+    {
+      for (seq_no d : del_)
+	TRY_OPERATION(control('E', d));
+      del_.clear();
+      while (!ins_.empty())
+	{
+	  TRY_OPERATION(control('E', ins_.back()));
+	  ins_.pop_back();
+	}
+      if (!wrote_text_)
+	{
+	  // Every body has at least the block of the first delta.
+	  TRY_OPERATION(control('I', 1));
+	  TRY_OPERATION(control('E', 1));
+	}
+      return Failure::Ok();
+    }
+
+    // The contribution of what we wrote to the checksum of the file.
+    int checksum() const { return sum_; }
+
+  private:
+    Failure move_to(seq_no ins, const std::vector<seq_no>& dels)
+    {
+      // Deletions which make a difference to this line, and any for
+      // the inserting delta itself (which cannot have both open).
+      std::vector<seq_no> kept;
+      for (seq_no d : del_)
+	{
+	  if (d < ins || (d > ins && std::binary_search(dels.begin(), dels.end(), d)))
 	    {
-	      return cssc::make_failure_builder(cssc::errorcode::HistoryFileCorrupt)
-		<< "non-terminal delta at " << here();
+	      kept.push_back(d);
 	    }
 	  else
 	    {
-	      if (fputs_failed(fputs(plinebuf->c_str(), out))
-		  || putc_failed(putc('\n', out)))
+	      TRY_OPERATION(control('E', d));
+	      del_open_[d] = false;
+	    }
+	}
+      while (!ins_.empty() && ins_.back() > ins)
+	{
+	  TRY_OPERATION(control('E', ins_.back()));
+	  ins_.pop_back();
+	}
+      if (ins_.empty() || ins_.back() != ins)
+	{
+	  TRY_OPERATION(control('I', ins));
+	  ins_.push_back(ins);
+	}
+      for (seq_no d : dels)
+	{
+	  if (!del_open_[d])
+	    {
+	      TRY_OPERATION(control('D', d));
+	      del_open_[d] = true;
+	      kept.push_back(d);
+	    }
+	}
+      std::sort(kept.begin(), kept.end());
+      del_.swap(kept);
+      return Failure::Ok();
+    }
+
+    Failure control(char c, seq_no seq)
+    {
+      char buf[24];
+      const int len = sprintf(buf, "\001%c %u\n", c, static_cast<unsigned>(seq));
+      return emit(buf, len);
+    }
+
+    Failure emit(const char *start, size_t len)
+    {
+      Failure wrote = fwrite_failed(fwrite(start, 1, len, out_), len);
+      if (!wrote.ok())
+	{
+	  return cssc::make_failure_builder(wrote)
+	    .diagnose() << "write error on output file";
+	}
+      for (size_t i = 0; i < len; ++i)
+	sum_ += start[i];	// plain char, as for the whole file.
+      return Failure::Ok();
+    }
+
+    FILE *out_;
+    int sum_;
+    bool wrote_text_;
+    // The blocks the last line was in.
+    seq_no line_ins_;
+    std::vector<seq_no> line_dels_;
+    std::vector<seq_no> ins_;	// open ^AI blocks, innermost last.
+    std::vector<seq_no> del_;	// open ^AD blocks, in order.
+    std::vector<bool> del_open_;
+  };
+
+  // The blocks open at some point in a body we are reading.
+  class open_blocks
+  {
+  public:
+    explicit open_blocks(seq_no highest)
+      : open_(highest + 1u, 0), ins_(), del_()
+    {
+    }
+
+    // Apply control line |c| for |seq|, or return a description of
+    // what is wrong with it.
+    const char *control(char c, seq_no seq)
+    {
+      switch (c)
+	{
+	case 'I':
+	case 'D':
+	  if (open_[seq])
+	    return "serial number already open";
+	  open_[seq] = c;
+	  ('I' == c ? ins_ : del_).push_back(seq);
+	  return nullptr;
+
+	case 'E':
+	  {
+	    if (!open_[seq])
+	      return "unmatched ^AE";
+	    std::vector<seq_no>& blocks = ('I' == open_[seq]) ? ins_ : del_;
+	    blocks.erase(std::find(blocks.begin(), blocks.end(), seq));
+	    open_[seq] = 0;
+	  }
+	  return nullptr;
+
+	default:
+	  return "unexpected control line";
+	}
+    }
+
+    bool empty() const { return ins_.empty() && del_.empty(); }
+    const std::vector<seq_no>& insertions() const { return ins_; }
+    const std::vector<seq_no>& deletions() const { return del_; }
+
+    // The delta which inserted a line in these blocks.
+    seq_no inserter() const
+    {
+      return *std::max_element(ins_.begin(), ins_.end());
+    }
+
+  private:
+    std::vector<char> open_;	// 0, 'I' or 'D' for each seqno.
+    std::vector<seq_no> ins_, del_;
+  };
+}
+
+
+/* Used by comb.  Each text line of the old body is visible in the
+ * deltas descended from the one which inserted it, except those
+ * descended from a later delta which deleted it.  The plan tells us
+ * which kept delta stands for each of those (if any), so we can work
+ * out which blocks the line belongs in, in the new body, as we go.
+ */
+cssc::FailureOr<comb_result>
+sccs_file_body_scanner::comb(FILE *out, const comb_plan& plan)
+{
+  stats_timer timer(stats_phase::body);
+  Failure seek = seek_to_body();
+  if (!seek.ok())
+    return cssc::make_failure_builder(seek).diagnose();
+
+  const seq_no highest = plan.old_highest();
+  comb_result result;
+  result.inserted.assign(plan.kept() + 1u, 0uL);
+  result.deleted.assign(plan.kept() + 1u, 0uL);
+
+  open_blocks old_blocks(highest);
+  weave_writer writer(out, plan.kept());
+  // The blocks the current line belongs in, in new serial numbers;
+  // want_ins is 0 if the line should be left out.
+  seq_no want_ins = 0;
+  std::vector<seq_no> want_del;
+  bool changed = true;
+
+  auto corrupt = [this](const char *what) -> Failure
+    {
+      return cssc::make_failure_builder(cssc::errorcode::HistoryFileCorrupt)
+	.diagnose() << what << " at " << here();
+    };
+
+  // Work out which blocks of the new body a line belongs in from the
+  // blocks of the old body it is in.
+  auto decide = [&]()
+    {
+      const seq_no inserter = old_blocks.inserter();
+      want_ins = plan.top(inserter);
+      want_del.clear();
+      if (!want_ins)
+	return;
+      for (seq_no d : old_blocks.deletions())
+	{
+	  if (d < inserter || !plan.descends(d, inserter))
+	    continue;		// this deletion does not apply.
+	  const seq_no top = plan.top(d);
+	  if (top == want_ins)
+	    {
+	      // No kept delta sees the line.
+	      want_ins = 0;
+	      return;
+	    }
+	  if (top)
+	    want_del.push_back(top);
+	}
+      // A deletion by a delta descended from another which deleted
+      // the line already makes no difference.
+      std::sort(want_del.begin(), want_del.end());
+      want_del.erase(std::unique(want_del.begin(), want_del.end()),
+		     want_del.end());
+      std::vector<seq_no> needed;
+      for (seq_no d : want_del)
+	{
+	  bool redundant = false;
+	  for (seq_no e : needed)
+	    {
+	      if (plan.new_descends(d, e))
 		{
-		  return cssc::make_failure_builder_from_errno(errno)
-		    << "write error on output file";
+		  redundant = true;
+		  break;
 		}
 	    }
+	  if (!redundant)
+	    needed.push_back(d);
 	}
-      else if (state != INSERT)
+      want_del.swap(needed);
+    };
+
+  for (;;)
+    {
+      FailureOr<char> got = read_line();
+      if (!got.ok())
 	{
-	  if (fputs_failed(fputs(plinebuf->c_str(), out))
-	      || putc_failed(putc('\n', out)))
+	  if (ferror(f_))
 	    {
+	      // read_line() has already reported the error.
 	      return cssc::make_failure_builder_from_errno(errno)
-		    << "write error on output file";
+		<< "read error on " << name();
 	    }
+	  break;
+	}
+
+      const char c = *got;
+      if (c)
+	{
+	  const seq_no seq = strict_atoseq(here(), plinebuf->c_str() + 3);
+	  if (seq < 1 || seq > highest)
+	    return corrupt("invalid serial number");
+	  const char *bad = old_blocks.control(c, seq);
+	  if (bad)
+	    return corrupt(bad);
+	  changed = true;
+	  continue;
 	}
+
+      if (old_blocks.insertions().empty())
+	return corrupt("text line outside any ^AI block");
+      if (changed)
+	{
+	  decide();
+	  changed = false;
+	}
+      if (!want_ins)
+	continue;
+
+      TRY_OPERATION(writer.line(plinebuf->c_str(), want_ins, want_del));
+      ++result.inserted[want_ins];
+      for (seq_no d : want_del)
+	++result.deleted[d];
     }
 
-  // We should end the file after an 'E', that is,
-  // in the 'COPY' state.
-  if (state != COPY)
+  if (!old_blocks.empty())
+    return corrupt("unexpected EOF");
+  TRY_OPERATION(writer.finish());
+  result.body_sum = writer.checksum();
+  return result;
+}
+
+
+/* Used by admin -C.  Copy the body, writing each text line in the
+ * same blocks as far as seq_state can tell (that is, with the same
+ * inserting delta and the same later deltas deleting it), but with
+ * as few control lines as possible; see weave_writer.  Every version
+ * of the file, whatever deltas are included, excluded or ignored,
+ * stays the same.  Returns the contribution of the new body to the
+ * checksum.
+ */
+cssc::FailureOr<int>
+sccs_file_body_scanner::compact(FILE *out, seq_no highest)
+{
+  stats_timer timer(stats_phase::body);
+  Failure seek = seek_to_body();
+  if (!seek.ok())
+    return cssc::make_failure_builder(seek).diagnose();
+
+  open_blocks blocks(highest);
+  weave_writer writer(out, highest);
+  seq_no ins = 0;
+  std::vector<seq_no> dels;
+  bool changed = true;
+
+  auto corrupt = [this](const char *what) -> Failure
     {
-      return cssc::make_failure_builder_from_errno(errno)
-	<< "unexpected EOF at " << here();
+      return cssc::make_failure_builder(cssc::errorcode::HistoryFileCorrupt)
+	.diagnose() << what << " at " << here();
+    };
+
+  for (;;)
+    {
+      FailureOr<char> got = read_line();
+      if (!got.ok())
+	{
+	  if (ferror(f_))
+	    {
+	      // read_line() has already reported the error.
+	      return cssc::make_failure_builder_from_errno(errno)
+		<< "read error on " << name();
+	    }
+	  break;
+	}
+
+      const char c = *got;
+      if (c)
+	{
+	  const seq_no seq = strict_atoseq(here(), plinebuf->c_str() + 3);
+	  if (seq < 1 || seq > highest)
+	    return corrupt("invalid serial number");
+	  const char *bad = blocks.control(c, seq);
+	  if (bad)
+	    return corrupt(bad);
+	  changed = true;
+	  continue;
+	}
+
+      if (blocks.insertions().empty())
+	return corrupt("text line outside any ^AI block");
+      if (changed)
+	{
+	  ins = blocks.inserter();
+	  dels.clear();
+	  for (seq_no d : blocks.deletions())
+	    {
+	      if (d > ins)
+		dels.push_back(d);
+	    }
+	  std::sort(dels.begin(), dels.end());
+	  changed = false;
+	}
+      TRY_OPERATION(writer.line(plinebuf->c_str(), ins, dels));
     }
-  return cssc::Failure::Ok();
+
+  if (!blocks.empty())
+    return corrupt("unexpected EOF");
+  TRY_OPERATION(writer.finish());
+  return writer.checksum() & 0xFFFF;
+}
+
+/* Used by val.  The body is a weave: every text line lies inside an
+ * ^AI block belonging to the delta which inserted it, and inside an
+ * ^AD block for each delta which deleted it.  We check that
+ *
+ *  - every control line is ^AI, ^AD or ^AE followed by the serial
+ *    number of a delta in the delta table;
+ *  - every ^AE closes a block which is open, no serial number has two
+ *    blocks open at once, and nothing is left open at the end;
+ *  - insertion blocks nest properly, each one inside blocks for
+ *    earlier deltas only (a delta can only insert lines among the
+ *    lines which already exist);
+ *  - every text line belongs to some insertion block;
+ *  - the number of lines inserted by each delta agrees with the
+ *    delta table.
+ *
+ * We read the body only once and keep just a few bytes of state for
+ * each delta, so this runs at the speed at which we can read the
+ * file.
+ */
+bool
+sccs_file_body_scanner::validate(const cssc_delta_table& table)
+{
+  stats_timer timer(stats_phase::body);
+  Failure sought = seek_to_body();
+  if (!sought.ok())
+    {
+      errormsg("%s", sought.to_string().c_str());
+      return false;
+    }
+
+  const seq_no highest = table.highest_seqno();
+  std::vector<char> open(highest + 1, 0); // 0, 'I' or 'D' for each seqno.
+  std::vector<seq_no> insertions;	  // open ^AI blocks, innermost last.
+  std::vector<unsigned long> lines(highest + 1, 0uL);
+
+  auto bad = [this](const char *what, unsigned long seq) -> bool
+    {
+      errormsg("%s: %s %lu", here().as_string().c_str(), what, seq);
+      return false;
+    };
+
+  for (;;)
+    {
+      FailureOr<char> got = read_line();
+      if (!got.ok())
+	{
+	  if (ferror(f_))
+	    return false;	// read_line() already reported the error.
+	  break;
+	}
+
+      const char c = *got;
+      if (0 == c)
+	{
+	  if (insertions.empty())
+	    {
+	      errormsg("%s: text line outside any ^AI block",
+		       here().as_string().c_str());
+	      return false;
+	    }
+	  ++lines[insertions.back()];
+	  continue;
+	}
+
+      if (c != 'I' && c != 'D' && c != 'E')
+	{
+	  errormsg("%s: unexpected control line in body",
+		   here().as_string().c_str());
+	  return false;
+	}
+
+      // Parse the serial number ourselves, since strict_atoseq() treats
+      // a bad one as fatal rather than as something to report.
+      const char *p = plinebuf->c_str() + 3;
+      unsigned long seq = 0;
+      if (bufchar(2) != ' ' || !isdigit(static_cast<unsigned char>(*p)))
+	{
+	  errormsg("%s: control line has no serial number",
+		   here().as_string().c_str());
+	  return false;
+	}
+      while (isdigit(static_cast<unsigned char>(*p)) && seq <= highest)
+	seq = seq * 10 + (*p++ - '0');
+      if (seq < 1 || seq > highest || !table.delta_at_seq_exists(seq))
+	return bad("no delta has serial number", seq);
+      if (*p)
+	{
+	  errormsg("%s: unexpected text after serial number",
+		   here().as_string().c_str());
+	  return false;
+	}
+
+      switch (c)
+	{
+	case 'I':
+	  if (open[seq])
+	    return bad("^AI for a serial number which is already open:", seq);
+	  if (!insertions.empty() && insertions.back() >= seq)
+	    return bad("^AI inside the insertion block of a later delta:", seq);
+	  insertions.push_back(seq);
+	  open[seq] = c;
+	  break;
+
+	case 'D':
+	  if (open[seq])
+	    return bad("^AD for a serial number which is already open:", seq);
+	  open[seq] = c;
+	  break;
+
+	case 'E':
+	  if (!open[seq])
+	    return bad("unmatched ^AE", seq);
+	  if (open[seq] == 'I')
+	    {
+	      if (insertions.back() != seq)
+		return bad("^AE does not close the innermost ^AI block:", seq);
+	      insertions.pop_back();
+	    }
+	  open[seq] = 0;
+	  break;
+	}
+    }
+
+  for (seq_no s = 1; s <= highest; ++s)
+    {
+      if (open[s])
+	{
+	  errormsg("%s: end of file inside the ^A%c block for serial number %u",
+		   name().c_str(), open[s], static_cast<unsigned>(s));
+	  return false;
+	}
+    }
+
+  bool ok = true;
+  for (seq_no s = 1; s <= highest; ++s)
+    {
+      if (!table.delta_at_seq_exists(s))
+	continue;
+      const struct delta& d = table.delta_at_seq(s);
+      // Line counts are written with five digits, so larger ones are
+      // clipped.  The body of a removed delta has gone.
+      if (d.removed() || (d.inserted() >= 99999uL && lines[s] >= 99999uL))
+	continue;
+      if (lines[s] != d.inserted())
+	{
+	  errormsg("%s: SID %s: delta table says %lu lines were inserted, "
+		   "but the body has %lu",
+		   name().c_str(), d.id().as_string().c_str(),
+		   d.inserted(), lines[s]);
+	  ok = false;
+	}
+    }
+  return ok;
 }
 
 std::unique_ptr<sccs_file_body_scanner>
 make_unique_sccs_file_body_scanner(const std::string& filename,
 				   FILE*f,
 				   off_t body_pos,
-				   long body_pos_line_number)
+				   long body_pos_line_number,
+				   int body_sum)
 {
 #if __cplusplus >= 201402L
-  return std::make_unique<sccs_file_body_scanner>(filename, f, body_pos, body_pos_line_number);
+  return std::make_unique<sccs_file_body_scanner>(filename, f, body_pos, body_pos_line_number, body_sum);
 #else
-  return std::unique_ptr<sccs_file_body_scanner>(new sccs_file_body_scanner(filename, f, body_pos, body_pos_line_number));
+  return std::unique_ptr<sccs_file_body_scanner>(new sccs_file_body_scanner(filename, f, body_pos, body_pos_line_number, body_sum));
 #endif
 }
@@ -27,6 +27,7 @@
 #include <string>
 #include <functional>
 #include <system_error>
+#include <vector>
 
 #include "base-reader.h"
 #include "delta.h"		/* for seq_no */
@@ -35,6 +36,7 @@
 
 class cssc_linebuf;
 class cssc_delta_table;
+class comb_plan;
 class seq_state;
 
 struct delta_result
@@ -47,11 +49,25 @@ struct delta_result
   unsigned long unchanged;
 };
 
+// What comb() wrote: the number of lines each kept delta inserted
+// and deleted (indexed by new serial number), and the contribution of
+// the new body to the checksum.
+struct comb_result
+{
+  comb_result() : inserted(), deleted(), body_sum(0) {}
+
+  std::vector<unsigned long> inserted;
+  std::vector<unsigned long> deleted;
+  int body_sum;
+};
+
 class sccs_file_body_scanner : public sccs_file_reader_base
 {
 public:
-  // sccs_file_body_scanner takes ownership of f.
-  sccs_file_body_scanner(const std::string& filename, FILE*f, off_t body_pos, long body_pos_line_number);
+  // sccs_file_body_scanner takes ownership of f.  body_sum is the
+  // contribution of the body to the checksum of the file.
+  sccs_file_body_scanner(const std::string& filename, FILE*f, off_t body_pos,
+			 long body_pos_line_number, int body_sum);
   ~sccs_file_body_scanner();
 
   // If we allowed copying, two instances might share the same FILE
@@ -74,8 +90,23 @@ public:
 	bool display_diff_output);
 
   cssc::Failure seek_to_body();
+  int body_checksum() const { return body_sum_; }
   cssc::Failure emit_raw_body(FILE*, const char*);
-  cssc::Failure remove(FILE*, seq_no id);
+  // Copy the body without the delta with sequence number |id|,
+  // returning the contribution of the result to the checksum.
+  cssc::FailureOr<int> remove(FILE*, seq_no id);
+  // Write to |out| the body of a history file which has only the
+  // deltas which |plan| keeps, numbered as it says.
+  cssc::FailureOr<comb_result> comb(FILE* out, const comb_plan& plan);
+  // Copy the body with as few control lines as will give the same
+  // result for every version, returning the contribution of the
+  // result to the checksum.  |highest| is the highest serial number.
+  cssc::FailureOr<int> compact(FILE* out, seq_no highest);
+
+  // Check the structure of the body against the delta table in a
+  // single pass, reporting any problems with errormsg().  Returns
+  // true if no problem was found.
+  bool validate(const cssc_delta_table&);
 
   // Print the body of an SCCS file to |out|, transforming all "^A"s
   // into "*** "s.  The name of the output file is |name|.
@@ -86,12 +117,13 @@ private:
   // TODO: rationalise the body_start_ / start_ overcomplexity
   off_t body_start_;
   sccs_file_location start_;
+  int body_sum_;
 };
 
 std::unique_ptr<sccs_file_body_scanner>
 make_unique_sccs_file_body_scanner(const std::string& filename,
 				   FILE*f, off_t body_pos,
-				   long body_pos_line_number);
+				   long body_pos_line_number, int body_sum);
 
 #endif /* CSSC__BODY_SCANNER_H__ */
 
@@ -25,8 +25,12 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <vector>
+
+#include <sys/types.h>
 
 #include "cssc.h"
 #include "bodyio.h"
@@ -39,309 +43,505 @@
 #include "ioerr.h"
 #include "file.h"
 
-/* Check if we have exceeded the maximum line length.
- */
-static bool check_line_len(const char *iname,
-			   long int len_max,
-			   int column,
-			   int ch,
-			   FILE *in)
+namespace
 {
-  if (0 == len_max || column < len_max)
+  // body_insert() reads this much of its input before writing any of
+  // it, so that for most files it knows whether they are text before
+  // it starts.
+  const size_t lookahead = 1024u * 1024u;
+
+  // The size of the blocks in which we read the input.
+  const size_t block_size = 64u * 1024u;
+
+  /* Check if we have exceeded the maximum line length.
+   */
+  bool check_line_len(const char *iname, long int len_max, long int column)
+  {
+    if (0 == len_max || column < len_max)
+      {
+	return true;
+      }
+    else
+      {
+	if (binary_file_creation_allowed())
+	  {
+	    errormsg("%s: line length exceeds %ld characters, "
+		     "treating as binary.\n",
+		     iname, len_max );
+	  }
+	else
+	  {
+	    errormsg("%s: line length exceeds %ld characters, "
+		     "and binary file support is disabled.\n",
+		     iname, len_max );
+	  }
+	return false;
+      }
+  }
+
+  /* Looks through the input, a block at a time, for anything which
+   * means it cannot be stored as text:-
+   *
+   *  1) a ^A immediately following a newline, since otherwise the
+   *   control-character will be taken for an SCCS control line;
+   *   SCCS utils only look for them at the beginning of a line
+   *
+   *  2) a line longer than max_sfile_line_len() allows
+   *
+   *  3) no newline at the end of the input, since many diff(1)
+   *   programs only cope with text files that end with a newline.
+   *
+   * On the way it counts the lines and looks for ID keywords.
+   */
+  class text_scanner
+  {
+  public:
+    explicit text_scanner(const char *iname)
+      : iname_(iname), len_max_(max_sfile_line_len()),
+	last_('\n'), before_last_('\n'), column_(0),
+	lines_(0uL), found_id_(false)
     {
-      return true;
     }
-  else
-    {
-      ungetc(ch, in);	// push back the character.
 
-      if (binary_file_creation_allowed())
-	{
-	  errormsg("%s: line length exceeds %ld characters, "
-		   "treating as binary.\n",
-		   iname, len_max );
-	}
-      else
-	{
-	  errormsg("%s: line length exceeds %d characters, "
-		   "and binary file support is disabled.\n",
-		   iname, len_max );
-	}
-      return false;
+    cssc::Failure scan(const char *p, size_t len);
+    cssc::Failure finish() const;
+
+    unsigned long int lines() const { return lines_; }
+    bool found_id() const { return found_id_; }
+
+  private:
+    const char *iname_;
+    const long int len_max_;
+    char last_, before_last_;
+    long int column_;		// current column in output file.
+    unsigned long int lines_;
+    bool found_id_;
+  };
+
+  cssc::Failure
+  text_scanner::scan(const char *p, size_t len)
+  {
+    for (const char *const end = p + len; p < end; ++p)
+      {
+	const char ch = *p;
+
+	// check for ^A at start of line.
+	if ('\n' == last_)
+	  {
+	    column_ = 0;
+
+	    if ('\001' == ch)
+	      {
+		return cssc::FailureBuilder(cssc::errorcode::ControlCharacterAtStartOfLine)
+		  << iname_ << ": control character at start of line, "
+		  << "treating as binary.\n";
+	      }
+	  }
+	else
+	  {
+	    // TODO: this counts each character twice, as we always
+	    // have, so lines can only be half as long as len_max_.
+	    column_ += 2;
+	    if (!check_line_len(iname_, len_max_, column_))
+	      {
+		return cssc::FailureBuilder(cssc::errorcode::BodyLineTooLong)
+		  << iname_ << ": line is too long, treating as binary";
+	      }
+	  }
+
+	if ('\n' == ch)
+	  ++lines_;
+
+	// Check for ID keywords (we see the closing '%').
+	if (!found_id_ && '%' == ch && '%' == before_last_
+	    && is_id_keyword_letter(last_))
+	  {
+	    found_id_ = true;
+	  }
+
+	before_last_ = last_;
+	last_ = ch;
+      }
+    return cssc::Failure::Ok();
+  }
+
+  cssc::Failure
+  text_scanner::finish() const
+  {
+    // Make sure the file ended with a newline.
+    if ('\n' != last_)
+      {
+	return cssc::FailureBuilder(cssc::errorcode::FileDoesNotEndWithNewline)
+	  << iname_ << ": no newline at end of file, treating as binary";
+      }
+    return cssc::Failure::Ok();
+  }
+
+  // Keywords: a file containing the octal characters
+  // 0026 0021 0141 (hex 0x16 0x11 0x61) will produce
+  // begin 0644 x
+  // #%A%A
+  // `
+  // end
+  //
+  //
+  // Stupidly imho, SCCS checks the ENCODED form of the file
+  // in order to support the "no ID keywords" warning.  Still,
+  // at least it doesn't expand those on output!
+
+  /* Encodes its input, which can arrive in blocks of any size, into
+   * lines of the body of an encoded SCCS file.
+   */
+  class binary_encoder
+  {
+  public:
+    binary_encoder(const char *oname, FILE *out)
+      : oname_(oname), out_(out), have_(0u), lines_(0uL), found_id_(false)
+    {
     }
+
+    cssc::Failure add(const char *p, size_t len);
+    cssc::Failure finish();
+
+    unsigned long int lines() const { return lines_; }
+    bool found_id() const { return found_id_; }
+
+  private:
+    static const size_t max_chunk = 45;
+
+    cssc::Failure put_line(const char *chunk, size_t len);
+
+    const char *oname_;
+    FILE *out_;
+    char chunk_[max_chunk];
+    size_t have_;
+    unsigned long int lines_;
+    bool found_id_;
+  };
+
+  cssc::Failure
+  binary_encoder::put_line(const char *chunk, size_t len)
+  {
+    char outbuf[80];
+    encode_line(chunk, outbuf, len); // see encoding.cc.
+
+    if (!found_id_)
+      {
+	// For some odd reason, SCCS seems to check
+	// the encoded form for ID keywords!  We know
+	// that strlen() on the UUENCODEd data is safe.
+	if (::check_id_keywords(outbuf, strlen(outbuf)))	// XXX used to check inbuf
+	  found_id_ = true;
+      }
+
+    if (fputs_failed(fputs(outbuf, out_)))
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "write error on " << oname_;
+      }
+    ++lines_;
+    return cssc::Failure::Ok();
+  }
+
+  cssc::Failure
+  binary_encoder::add(const char *p, size_t len)
+  {
+    while (len > 0u)
+      {
+	if (0u == have_ && len >= max_chunk)
+	  {
+	    // Encode straight from the caller's buffer.
+	    cssc::Failure put = put_line(p, max_chunk);
+	    if (!put.ok())
+	      return put;
+	    p += max_chunk;
+	    len -= max_chunk;
+	    continue;
+	  }
+	const size_t n = std::min(len, max_chunk - have_);
+	memcpy(chunk_ + have_, p, n);
+	have_ += n;
+	p += n;
+	len -= n;
+	if (max_chunk == have_)
+	  {
+	    have_ = 0u;
+	    cssc::Failure put = put_line(chunk_, max_chunk);
+	    if (!put.ok())
+	      return put;
+	  }
+      }
+    return cssc::Failure::Ok();
+  }
+
+  cssc::Failure
+  binary_encoder::finish()
+  {
+    if (have_ > 0u)
+      {
+	cssc::Failure put = put_line(chunk_, have_);
+	if (!put.ok())
+	  return put;
+	have_ = 0u;
+      }
+    // A space character indicates a count of zero bytes and hence
+    // the end of the encoded file.
+    if (fputs_failed(fputs(" \n", out_)))
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "write error on " << oname_;
+      }
+    ++lines_;
+    return cssc::Failure::Ok();
+  }
+
+  /* Pass the rest of IN through ENC, and finish the encoding.
+   */
+  cssc::Failure
+  encode_rest(const char iname[], FILE *in, binary_encoder& enc,
+	      unsigned long int *lines, bool *idkw)
+  {
+    std::vector<char> buf(block_size);
+    size_t len;
+    while (0u < (len = fread(buf.data(), 1, buf.size(), in)))
+      {
+	cssc::Failure added = enc.add(buf.data(), len);
+	if (!added.ok())
+	  return added;
+      }
+    if (ferror(in))
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "read error on " << iname;
+      }
+    cssc::Failure done = enc.finish();
+    if (!done.ok())
+      return done;
+    *lines = enc.lines();
+    *idkw = enc.found_id();
+    return cssc::Failure::Ok();
+  }
+
+  cssc::Failure
+  write_text(const char oname[], const char *p, size_t len, FILE *out)
+  {
+    if (fwrite(p, 1, len, out) < len)
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "write error on " << oname;
+      }
+    return cssc::Failure::Ok();
+  }
+
+  cssc::Failure
+  copy_data(FILE *in, FILE *out)
+  {
+    char buf[BUFSIZ];
+    size_t n, nout;
+
+    while ( 0u < (n=fread(buf, 1, BUFSIZ, in)))
+      {
+	nout = fwrite(buf, 1, n, out);
+	if (nout < n)
+	  {
+	    return cssc::make_failure_builder_from_errno(errno)
+	      .diagnose() << "write error in copy_data";
+	  }
+      }
+    if (ferror(in))
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "read error in copy_data";
+      }
+    else
+      {
+	return cssc::Failure::Ok();
+      }
+  }
+
+  /* We have written the input up to (but not including) PENDING to
+   * OUT as text, starting at OUT_START, and then found that it is
+   * binary after all.  Replace what we wrote with the encoded form of
+   * the whole input.
+   */
+  cssc::Failure
+  restart_as_binary(const char iname[], const char oname[],
+		    FILE *in, off_t in_start, FILE *out, off_t out_start,
+		    const char *pending, size_t pending_len,
+		    unsigned long int *lines, bool *idkw)
+  {
+    // If we can, simply read the input again.
+    if (in_start >= 0 && 0 == fseeko(in, in_start, SEEK_SET))
+      {
+	if (0 != fseeko(out, out_start, SEEK_SET))
+	  {
+	    return cssc::make_failure_builder_from_errno(errno)
+	      .diagnose() << "cannot seek on " << oname;
+	  }
+	return body_insert_binary(iname, oname, in, out, lines, idkw);
+      }
+
+    // We may be reading from a pipe, so we can't seek on it.  But we
+    // have the first segment of the file written to the x-file
+    // already, and the remainder is still waiting to be read, so we
+    // can recover all the data.
+    FILE *tmp = tmpfile();
+    if (!tmp)
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "Could not create temporary file";
+      }
+    ResourceCleanup clean([tmp](){ fclose(tmp); });
+    if (0 != fseeko(out, out_start, SEEK_SET))
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "cannot seek on " << oname;
+      }
+    cssc::Failure copy_done = copy_data(out, tmp);
+    if (copy_done.ok())
+      copy_done = write_text("temporary file", pending, pending_len, tmp);
+    if (copy_done.ok())
+      copy_done = copy_data(in, tmp);
+    if (!copy_done.ok())
+      return copy_done;
+    if (0 != fseeko(out, out_start, SEEK_SET))
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "cannot seek on " << oname;
+      }
+    rewind(tmp);
+    return body_insert_binary("temporary file",
+			      oname, tmp, out, lines, idkw);
+  }
 }
 
 
+cssc::Failure
+body_insert_binary(const char iname[], const char oname[],
+		   FILE *in, FILE *out,
+		   unsigned long int *lines,
+		   bool *idkw)
+{
+  binary_encoder enc(oname, out);
+  return encode_rest(iname, in, enc, lines, idkw);
+}
 
 
-/* body_insert_text()
+/* body_insert()
  *
- * Insert a file into an SCCS file (e.g. for admin).
+ * Insert a file into an SCCS file (e.g. for admin), as text if we
+ * can, or encoded if it is binary (or *binary is already set).
  *
- * We fail if the input contains a ^A immediately following
- * a newline (which is special to SCCS), or if the input
- * does not end with a newline.
- *
- *  1) otherwise the control-character (^A) immediately
- *   following will not be recognised; SCCS utils
- *   only look for them at the beginning of a line
- *
- *  2) many diff(1) programs only cope with text files
- *   that end with a newline.
+ * We look at the first part of the input before writing anything, so
+ * for files smaller than that each byte is read and written once
+ * whichever way the file is stored.  If a larger file turns out to
+ * be binary after we have started writing it as text, we read it
+ * again if we can seek on it, and go through a temporary file if not.
  */
 cssc::Failure
-body_insert_text(const char iname[], const char oname[],
-		 FILE *in, FILE *out,
-		 unsigned long int *lines,
-		 bool *idkw)
+body_insert(bool *binary,
+	    const char iname[], const char oname[],
+	    FILE *in, FILE *out,
+	    unsigned long int *lines,
+	    bool *idkw)
 {
-  int ch, last;
-  unsigned long int nl;		// number of lines.
-  const long int len_max = max_sfile_line_len();
-  bool found_id;
-  int column;			// current column in ouutput file.
-
-  // If we fail, rewind these files to try binary encoding.
-  FilePosSaver o_saver(out);
-
-  *idkw = found_id = false;
-  nl = 0uL;
-  last = '\n';
-
-  column = 0;
-  while ( EOF != (ch=getc(in)) )
+  // If binary mode has not been forced, try text mode.
+  if (*binary)
     {
-      if ('\n' == ch)
-	++nl;
-
-      // check for ^A at start of line.
-      if ('\n' == last)
-	{
-	  column = 0;
-
-	  if ('\001' == ch)
-	    {
-	      ungetc(ch, in);	// push back the control character.
-	      // output file pointer implicitly rewound
-	      return cssc::FailureBuilder(cssc::errorcode::ControlCharacterAtStartOfLine)
-		<< iname << ": control character at start of line, "
-		<< "treating as binary.\n";
-	    }
-	}
-      else
-	{
-	  // TODO: are there too many increment operations here?
-	  ++column;
-	  if (!check_line_len(iname, len_max, ++column, ch, in))
-	    {
-	      // output file pointer implicitly rewound
-	      return cssc::FailureBuilder(cssc::errorcode::BodyLineTooLong)
-		<< iname << ": line is too long, treating as binary";
-	    }
-	}
-
-      if (putc_failed(putc(ch, out)))
-	{
-	  return cssc::make_failure_builder_from_errno(errno)
-	    .diagnose() << "write error on " << oname;
-	}
-
-      if (!found_id)		// Check for ID keywords.
-	{
-	  if ('%' == last && is_id_keyword_letter(static_cast<char>(ch)))
-	    {
-	      const int peek = getc(in);
-	      if ('%' == peek)
-		*idkw = found_id = true;
-	      if (EOF != peek)	// Can't put the genie back in the bottle!
-		ungetc(peek, in);
-	    }
-	}
-
-      last = ch;
+      return body_insert_binary(iname, oname, in, out, lines, idkw);
     }
 
-  if (ferror(in))
+  const off_t in_start = ftello(in); // -1 if we cannot seek on it.
+  const off_t out_start = ftello(out);
+  if (out_start < 0)
     {
       return cssc::make_failure_builder_from_errno(errno)
-	.diagnose() << "read error on " << iname;
-    }
-
-
-  // Make sure the file ended with a newline.
-  if ('\n' != last)
-    {
-      // output file pointer implicitly rewound
-      return cssc::FailureBuilder(cssc::errorcode::FileDoesNotEndWithNewline)
-	<< iname << ": no newline at end of file, treating as binary";
+	.diagnose() << "cannot find the position in " << oname;
     }
 
-  // Success; do not rewind the output file.
-  o_saver.disarm();
-  *lines = nl;
-  return cssc::Failure::Ok();
-}
-
-// Keywords: a file containing the octal characters
-// 0026 0021 0141 (hex 0x16 0x11 0x61) will produce
-// begin 0644 x
-// #%A%A
-// `
-// end
-//
-//
-// Stupidly imho, SCCS checks the ENCODED form of the file
-// in order to support the "no ID keywords" warning.  Still,
-// at least it doesn't expand those on output!
-
-
-cssc::Failure
-body_insert_binary(const char iname[], const char oname[],
-		   FILE *in, FILE *out,
-		   unsigned long int *lines,
-		   bool *idkw)
-{
-  const int max_chunk = 45;
-  char inbuf[max_chunk], outbuf[80];
-  unsigned long int nl;
-  size_t len;
-  bool kw;
-  *idkw = kw = false;
-
-  nl = 0;
-  while ( 0 < (len = fread(inbuf, sizeof(char), max_chunk, in)) )
-    {
-      encode_line(inbuf, outbuf, len); // see encoding.cc.
-
-      if (!kw)
-	{
-	  // For some odd reason, SCCS seems to check
-	  // the encoded form for ID keywords!  We know
-	  // that strlen() on the UUENCODEd data is safe.
-	  if (::check_id_keywords(outbuf, strlen(outbuf)))	// XXX used to check inbuf
-	    *idkw = kw = true;
-	}
-
-      if (fputs_failed(fputs(outbuf, out)))
-	{
-	  return cssc::make_failure_builder_from_errno(errno)
-	    .diagnose() << "write error on " << oname;
-	}
-
-      ++nl;
-    }
-  // A space character indicates a count of zero bytes and hence
-  // the end of the encoded file.
-  if (fputs_failed(fputs(" \n", out)))
+  std::vector<char> buf(lookahead);
+  size_t have = 0u, len;
+  while (have < buf.size()
+	 && 0u < (len = fread(buf.data() + have, 1, buf.size() - have, in)))
     {
-      return cssc::make_failure_builder_from_errno(errno)
-	.diagnose() << "write error on " << oname;
+      have += len;
     }
-
-  ++nl;
-
   if (ferror(in))
     {
       return cssc::make_failure_builder_from_errno(errno)
 	.diagnose() << "read error on " << iname;
     }
+  const bool whole_input = have < buf.size();
 
-  *lines = nl;
-  return cssc::Failure::Ok();
-}
-
+  text_scanner scanner(iname);
+  cssc::Failure text = scanner.scan(buf.data(), have);
+  if (text.ok() && whole_input)
+    text = scanner.finish();
 
-static cssc::Failure
-copy_data(FILE *in, FILE *out)
-{
-  char buf[BUFSIZ];
-  size_t n, nout;
-
-  while ( 0u < (n=fread(buf, 1, BUFSIZ, in)))
+  if (text.ok())
     {
-      nout = fwrite(buf, 1, n, out);
-      if (nout < n)
+      text = write_text(oname, buf.data(), have, out);
+      if (!text.ok())
+	return text;
+
+      if (!whole_input)
 	{
-	  return cssc::make_failure_builder_from_errno(errno)
-	    .diagnose() << "write error in copy_data";
+	  buf.resize(block_size);
+	  while (0u < (len = fread(buf.data(), 1, buf.size(), in)))
+	    {
+	      text = scanner.scan(buf.data(), len);
+	      if (!text.ok())
+		break;
+	      text = write_text(oname, buf.data(), len, out);
+	      if (!text.ok())
+		return text;
+	    }
+	  if (text.ok())
+	    {
+	      if (ferror(in))
+		{
+		  return cssc::make_failure_builder_from_errno(errno)
+		    .diagnose() << "read error on " << iname;
+		}
+	      text = scanner.finish();
+	      len = 0u;
+	    }
 	}
+      if (text.ok())
+	{
+	  *lines = scanner.lines();
+	  *idkw = scanner.found_id();
+	  return cssc::Failure::Ok();
+	}
+      have = len;		// the block we had not yet written.
     }
-  if (ferror(in))
-    {
-      return cssc::make_failure_builder_from_errno(errno)
-	.diagnose() << "read error in copy_data";
-    }
-  else
-    {
-      return cssc::Failure::Ok();
-    }
-}
 
+  if (text.code() != cssc::make_error_condition(cssc::condition::BodyIsBinary))
+    return text;
 
-cssc::Failure
-body_insert(bool *binary,
-	    const char iname[], const char oname[],
-	    FILE *in, FILE *out,
-	    unsigned long int *lines,
-	    bool *idkw)
-{
-  // If binary mode has not been forced, try text mode.
-  if (*binary)
+  *binary = true;
+  if (!binary_file_creation_allowed())
     {
-      return body_insert_binary(iname, oname, in, out, lines, idkw);
+      // We can't try again with a binary file, because that
+      // feature is disabled.
+      return cssc::FailureBuilder(text)
+	<< "body is binary and encoding is not allowed";
     }
-  else
-    {
-      // body_insert_text() takes care of rewinding the output
-      // file; we may not even be able to rewind the input file.
-      ASSERT(*binary == false);
-      auto result = body_insert_text(iname, oname, in, out, lines, idkw);
-      if (result.ok())
-	return cssc::Failure::Ok();
-
-      if (result.code() != cssc::make_error_condition(cssc::condition::BodyIsBinary))
-	return result;
-
-      *binary = true;
-      if (!binary_file_creation_allowed())
-	{
-	  // We can't try again with a binary file, because that
-	  // feature is disabled.
-	  return cssc::FailureBuilder(result)
-	    << "body is binary and encoding is not allowed";
-	}
 
-      // It wasn't text after all.  We may be reading from
-      // stdin, so we can't seek on it.  But we have
-      // the first segment of the file written to the x-file
-      // already, and the remainder is still waiting to be
-      // read, so we can recover all the data.
-      FILE *tmp = tmpfile();
-      if (!tmp)
-	{
-	  return cssc::make_failure_builder_from_errno(errno)
-	    .diagnose() << "Could not create temporary file";
-	}
-      ResourceCleanup clean([tmp](){ fclose(tmp); });
-      // Recover the data already written to the output
-      // file and then rewind it, so that we can overwrite
-      // it with the encoded version.
-      FilePosSaver *fp_out = new FilePosSaver(out);
-      cssc::Failure copy_done = copy_data(out, tmp);
-      if (!copy_done.ok())
-	{
-	  return copy_done;
-	}
-      copy_done = copy_data(in,  tmp);
-      if (!copy_done.ok())
-	{
-	  return copy_done;
-	}
-      delete fp_out;	// rewind the file OUT.
-      rewind(tmp);
-      return body_insert_binary("temporary file",
-				oname, tmp, out, lines, idkw);
+  if (ftello(out) != out_start)
+    {
+      // It wasn't text after all, but we have written some of it.
+      return restart_as_binary(iname, oname, in, in_start, out, out_start,
+			       buf.data(), have, lines, idkw);
     }
+
+  // We found out before writing anything, so we can encode what we
+  // have read and carry on.
+  binary_encoder enc(oname, out);
+  cssc::Failure added = enc.add(buf.data(), have);
+  if (!added.ok())
+    return added;
+  return encode_rest(iname, in, enc, lines, idkw);
 }
 
 cssc::Failure output_body_line_text(FILE *fp, const cssc_linebuf* plb)
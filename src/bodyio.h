@@ -27,11 +27,6 @@
 #include <cstdio>
 #include "failure.h"
 
-cssc::Failure body_insert_text(const char iname[], const char oname[],
-			       FILE *in, FILE *out,
-			       unsigned long int *lines,
-			       bool *idkw);
-
 cssc::Failure body_insert_binary(const char iname[], const char oname[],
 				 FILE *in, FILE *out,
 				 unsigned long int *lines,
@@ -0,0 +1,31 @@
+/*
+ * builtin-cdc.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The "cdc" tool, compiled for linking into a multicall "sccs" (see
+ * multicall.cc).
+ *
+ */
+
+#define main cssc_cdc_main
+#define usage cssc_cdc_usage
+#include "cdc.cc"
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
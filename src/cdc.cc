@@ -36,6 +36,7 @@
 #include "failure.h"
 #include "file.h"
 #include "privs.h"
+#include "stats.h"
 
 
 void
@@ -70,6 +71,7 @@ main(int argc, char *argv[])
     set_prg_name(argv[0]);
   else
     set_prg_name("cdc");
+  start_stats();
 
   ASSERT(!rid.valid());
 
@@ -25,7 +25,9 @@
 #ifndef CSSC__CLEANUP_H__
 #define CSSC__CLEANUP_H__
 
+#include <atomic>
 #include <functional>
+#include <thread>
 
 // TODO: consider switching to using a template cleanup object with a
 // lambda for custom cleanup actions.
@@ -44,16 +46,27 @@ public:
  * The class "cleanup" is one which you can inherit from in order to
  * ensure that resources are cleaned up when a function is exited.
  * This is most notably used by the "file_lock" class.
+ *
+ * Instances are kept on a single list (so that a fatal signal can
+ * release every lock held by the process) but each one remembers
+ * which thread registered it.  A fatal error in one thread therefore
+ * only runs that thread's cleanups and leaves other operations in
+ * progress alone.  The list is protected by a mutex.
  */
 class cleanup {
         static class cleanup *head;
-        static int running;
-        static int all_disabled;
+        static std::atomic<int> running;
+        static std::atomic<int> all_disabled;
 #if HAVE_FORK
-        static int in_child_flag;
+        static std::atomic<int> in_child_flag;
 #endif
 
         class cleanup *next;
+        std::thread::id owner;
+        bool linked;
+
+        void unlink_locked();
+        static void run_matching(bool only_this_thread);
 
 	// This class has pointer members so we should override the
 	// copy constructor and assignment operator if we want
@@ -70,7 +83,11 @@ protected:
 
 public:
 
+        // Run every registered cleanup, in all threads.  This is used
+        // at exit and on receipt of a fatal signal.
         static void run_cleanups();
+        // Run only the cleanups registered by the calling thread.
+        static void run_thread_cleanups();
         static int active() { return running; }
         static void disable_all() { all_disabled++; }
 #ifdef HAVE_FORK
@@ -0,0 +1,133 @@
+/*
+ * comb-plan.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Members of the class comb_plan.
+ *
+ */
+
+#include <config.h>
+
+#include <utility>
+
+#include "cssc.h"
+#include "comb-plan.h"
+#include "delta-table.h"
+
+
+comb_plan::comb_plan(const cssc_delta_table& table,
+		     const std::vector<bool>& wanted)
+  : old_highest_(table.highest_seqno()),
+    new_seq_(old_highest_ + 1u, 0),
+    new_to_old_(1u, 0),
+    new_prev_(1u, 0),
+    top_(old_highest_ + 1u, 0),
+    enter_(old_highest_ + 1u, 0uL),
+    leave_(old_highest_ + 1u, 0uL)
+{
+  const seq_no n = old_highest_;
+  std::vector<seq_no> prev(n + 1u, 0);
+  std::vector<bool> kept(n + 1u, false);
+  std::vector<std::vector<seq_no>> children(n + 1u);
+
+  for (seq_no s = 1; s <= n; ++s)
+    {
+      if (!table.delta_at_seq_exists(s))
+	continue;
+      const delta& d = table.delta_at_seq(s);
+      prev[s] = d.prev_seq();
+      ASSERT(prev[s] < s);
+      children[prev[s]].push_back(s);
+      kept[s] = !d.removed() && s < wanted.size() && wanted[s];
+    }
+
+  // Predecessors come before their successors, so working downward
+  // we have dealt with all of a delta's descendants before it.
+  // below[s] is the nearest kept delta at or below s, in the old
+  // numbering.
+  std::vector<seq_no> below(n + 1u, 0);
+  for (seq_no s = n; s > 0; --s)
+    {
+      if (kept[s])
+	{
+	  below[s] = s;
+	  continue;
+	}
+      unsigned int branches = 0;
+      for (seq_no c : children[s])
+	{
+	  if (below[c])
+	    {
+	      ++branches;
+	      below[s] = below[c];
+	    }
+	}
+      if (branches > 1)
+	{
+	  kept[s] = true;	// a branch point.
+	  below[s] = s;
+	}
+    }
+
+  for (seq_no s = 1; s <= n; ++s)
+    {
+      if (kept[s])
+	{
+	  new_seq_[s] = seq_no(new_to_old_.size());
+	  new_to_old_.push_back(s);
+	}
+    }
+  for (seq_no s = 1; s <= n; ++s)
+    top_[s] = below[s] ? new_seq_[below[s]] : 0;
+
+  // The nearest kept ancestor of each delta, working upward.
+  std::vector<seq_no> above(n + 1u, 0);
+  for (seq_no s = 1; s <= n; ++s)
+    {
+      const seq_no p = prev[s];
+      above[s] = kept[p] ? p : above[p];
+    }
+  for (seq_no i = 1; i < new_to_old_.size(); ++i)
+    new_prev_.push_back(new_seq_[above[new_to_old_[i]]]);
+
+  // Number the deltas in a depth-first walk from the (notional)
+  // delta 0 which is the predecessor of the first.
+  unsigned long clock = 0;
+  std::vector<std::pair<seq_no, size_t>> stack;
+  stack.push_back(std::make_pair(seq_no(0), size_t(0)));
+  enter_[0] = clock++;
+  while (!stack.empty())
+    {
+      std::pair<seq_no, size_t>& top = stack.back();
+      if (top.second < children[top.first].size())
+	{
+	  const seq_no c = children[top.first][top.second++];
+	  enter_[c] = clock++;
+	  stack.push_back(std::make_pair(c, size_t(0)));
+	}
+      else
+	{
+	  leave_[top.first] = clock++;
+	  stack.pop_back();
+	}
+    }
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,96 @@
+/*
+ * comb-plan.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Defines the class comb_plan, which decides which deltas comb keeps
+ * and how it renumbers them.
+ *
+ */
+
+#ifndef CSSC__COMB_PLAN_H__
+#define CSSC__COMB_PLAN_H__
+
+#include <vector>
+
+#include "delta.h"		/* for seq_no */
+
+class cssc_delta_table;
+
+// A comb_plan is made from a delta table and the set of deltas the
+// user wants to keep.  To keep the shape of the tree, it also keeps
+// any delta from which two or more of those have descended by
+// different routes (the branch points), so that each delta it drops
+// has at most one nearest kept descendant, and the lines a dropped
+// delta inserted or deleted can be credited to that one.  Removed
+// deltas are never kept.
+//
+// The kept deltas are numbered again from 1 in their old order, so
+// each still has a higher serial number than its predecessor.
+//
+// Every delta's chain of predecessors must be sound (see
+// ancestry_index::chain_ok()).
+class comb_plan
+{
+public:
+  // wanted[s] is true if the user wants to keep delta s.
+  comb_plan(const cssc_delta_table&, const std::vector<bool>& wanted);
+
+  seq_no old_highest() const { return old_highest_; }
+  seq_no kept() const { return seq_no(new_to_old_.size() - 1u); }
+
+  // The new serial number of delta |old|, or 0 if it is dropped.
+  seq_no new_seq(seq_no old) const { return new_seq_[old]; }
+
+  // The old serial number of kept delta |s|.
+  seq_no old_seq(seq_no s) const { return new_to_old_[s]; }
+
+  // The new serial number of the predecessor of kept delta |s|,
+  // which is its nearest kept ancestor, or 0 if it has none.
+  seq_no new_prev(seq_no s) const { return new_prev_[s]; }
+
+  // The new serial number of the nearest kept delta at or below
+  // |old| (which is |old| itself if that is kept), or 0 if none of
+  // the deltas descended from it is kept.
+  seq_no top(seq_no old) const { return top_[old]; }
+
+  // True if delta |a| is delta |b| or is descended from it, in the
+  // old numbering.
+  bool descends(seq_no a, seq_no b) const
+  {
+    return enter_[b] <= enter_[a] && leave_[a] <= leave_[b];
+  }
+
+  // As descends(), but for kept deltas in the new numbering.
+  bool new_descends(seq_no a, seq_no b) const
+  {
+    return descends(new_to_old_[a], new_to_old_[b]);
+  }
+
+private:
+  seq_no old_highest_;
+  std::vector<seq_no> new_seq_, new_to_old_, new_prev_, top_;
+  // Each delta's position in a depth-first walk of the tree, when we
+  // first reach it and when we have finished with its descendants.
+  std::vector<unsigned long> enter_, leave_;
+};
+
+#endif /* CSSC__COMB_PLAN_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
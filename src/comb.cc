@@ -0,0 +1,212 @@
+/*
+ * comb.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Discards old deltas from an SCCS file.  Unlike the comb of SCCS,
+ * which writes a shell script that rebuilds the file, this rewrites
+ * the file itself.
+ *
+ */
+
+#include <config.h>
+
+#include <sys/stat.h>
+#include <vector>
+
+#include "cssc.h"
+#include "fileiter.h"
+#include "sccsfile.h"
+#include "pfile.h"
+#include "my-getopt.h"
+#include "version.h"
+#include "delta.h"
+#include "delta-iterator.h"
+#include "except.h"
+#include "stats.h"
+
+
+void
+usage() {
+	fprintf(stderr,
+"usage: %s [-sV] [-p SID] [-c list] file ...\n",
+		prg_name);
+}
+
+
+static bool
+is_locked(sccs_name& name)
+{
+  sccs_pfile pfile(name, sccs_pfile::pfile_mode::PFILE_READ);
+  return pfile.begin() != pfile.end();
+}
+
+
+// Decide which deltas to keep: those in |list| if it is not empty, or
+// else every delta at or after |oldest| if that is valid, or else the
+// latest delta on each branch.  Returns false if |oldest| does not
+// exist.
+static bool
+wanted_deltas(const sccs_file& file, const sid_list& list, sid oldest,
+	      std::vector<bool>& wanted)
+{
+  const cssc_delta_table& table = file.delta_table();
+  std::vector<bool> has_successor(table.highest_seqno() + 1u, false);
+  seq_no first = 0;
+  wanted.assign(table.highest_seqno() + 1u, false);
+
+  if (oldest.valid())
+    {
+      const delta *d = file.find_delta(oldest);
+      if (nullptr == d)
+	return false;
+      first = d->seq();
+    }
+
+  const_delta_iterator successors(&table, delta_selector::current);
+  while (successors.next())
+    has_successor[successors->prev_seq()] = true;
+
+  const_delta_iterator iter(&table, delta_selector::current);
+  while (iter.next())
+    {
+      const seq_no s = iter->seq();
+      if (!list.empty())
+	wanted[s] = list.member(iter->id());
+      else if (oldest.valid())
+	wanted[s] = s >= first;
+      else
+	wanted[s] = !has_successor[s];
+    }
+  return true;
+}
+
+
+int
+main(int argc, char **argv)
+{
+  Cleaner arbitrary_name;
+  int c;
+  sid oldest(sid::null_sid());
+  sid_list list;
+  bool report_only = false;
+
+  if (argc > 0)
+    set_prg_name(argv[0]);
+  else
+    set_prg_name("comb");
+  start_stats();
+
+  class CSSC_Options opts(argc, argv, "p!c!sV");
+  for (c = opts.next(); c != CSSC_Options::END_OF_ARGUMENTS;
+       c = opts.next())
+    {
+      switch (c)
+	{
+	case 'p':
+	  oldest = sid(opts.getarg());
+	  if (!oldest.valid())
+	    {
+	      errormsg("Invaild SID: '%s'", opts.getarg());
+	      return 2;
+	    }
+	  break;
+
+	case 'c':
+	  list = sid_list(opts.getarg());
+	  if (!list.valid() || list.empty())
+	    {
+	      errormsg("Invalid SID list: '%s'", opts.getarg());
+	      return 2;
+	    }
+	  break;
+
+	case 's':
+	  report_only = true;
+	  break;
+
+	case 'V':
+	  version();
+	  break;
+	}
+    }
+
+  sccs_file_iterator iter(opts);
+  if (iter.empty())
+    {
+      errormsg("No SCCS file specified.");
+      return 1;
+    }
+
+  int retval = 0;
+
+  while (iter.next())
+    {
+      try
+	{
+	  sccs_name &name = iter.get_name();
+	  sccs_file file(name, report_only ? READ : UPDATE);
+
+	  if (!report_only && is_locked(name))
+	    {
+	      errormsg("%s: The file is locked for editing.", name.c_str());
+	      retval = 1;
+	      continue;
+	    }
+
+	  struct stat st;
+	  if (0 != stat(name.c_str(), &st))
+	    {
+	      errormsg_with_errno("%s", name.c_str());
+	      retval = 1;
+	      continue;
+	    }
+
+	  std::vector<bool> wanted;
+	  if (!wanted_deltas(file, list, oldest, wanted))
+	    {
+	      errormsg("%s: SID %s does not exist", name.c_str(),
+		       oldest.as_string().c_str());
+	      retval = 1;
+	      continue;
+	    }
+	  cssc::FailureOr<long> size = file.comb(wanted, !report_only);
+	  if (!size.ok())
+	    {
+	      retval = 1;
+	      continue;
+	    }
+	  if (report_only)
+	    {
+	      const long before = static_cast<long>(st.st_size);
+	      const long saved = before > 0 ? (before - *size) * 100L / before : 0L;
+	      printf("%s: %ld bytes, %ld after combing (%ld%% smaller)\n",
+		     name.c_str(), before, *size, saved);
+	    }
+	}
+      catch (CsscExitvalException e)
+	{
+	  if (e.exitval > retval)
+	    retval = e.exitval;
+	}
+    }
+  return retval;
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -66,6 +66,16 @@
 #define CONFIG_CAN_HARD_LINK_AN_OPEN_FILE 1
 #endif
 
+/* POSIX rename(2) atomically replaces an existing file, so readers
+ * never find the s-file missing while it is being replaced.  On
+ * Windows the old file has to be removed first.
+ */
+#if defined __CYGWIN__ || defined _WIN32
+#define CONFIG_CAN_RENAME_OVER_EXISTING_FILE 0
+#else
+#define CONFIG_CAN_RENAME_OVER_EXISTING_FILE 1
+#endif
+
 //xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
 //           MS-DOS
 //xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
@@ -81,6 +91,11 @@ bool is_id_keyword_letter(char ch);
 /* functions from environment.cc. */
 bool binary_file_creation_allowed (void);
 long max_sfile_line_len(void);
+bool extended_seqno_allowed (void);
+long lock_wait_timeout(void);
+bool lock_stats_wanted (void);
+bool stats_wanted (void);
+const char *stats_file (void);
 void check_env_vars(void);
 
 #endif
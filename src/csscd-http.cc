@@ -0,0 +1,686 @@
+/*
+ * csscd-http.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The web interface of csscd.  Each connection carries one request
+ * (we always answer with "Connection: close"), and only GET and HEAD
+ * are supported.  The pages are those of sccs.cgi, without diffs.
+ *
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cssc.h"
+#include "csscd-http.h"
+#include "delta-iterator.h"
+#include "delta-table.h"
+#include "except.h"
+#include "failure.h"
+#include "quit.h"
+#include "sccsfile.h"
+#include "sfile-cache.h"
+
+using cssc::Failure;
+using cssc::FailureOr;
+
+namespace
+{
+  const size_t max_request_header = 16384u;
+  const int request_timeout_seconds = 30;
+
+  struct response
+  {
+    int status;
+    const char *reason;
+    std::string content_type;
+    std::string location;
+    std::string body;
+
+    response()
+      : status(200), reason("OK"), content_type("text/html"),
+	location(), body()
+    {
+    }
+  };
+
+  // Escapes S for use in HTML text or a quoted attribute.
+  std::string
+  quote(const std::string& s)
+  {
+    std::string result;
+    for (char c : s)
+      {
+	switch (c)
+	  {
+	  case '&': result += "&amp;"; break;
+	  case '<': result += "&lt;"; break;
+	  case '>': result += "&gt;"; break;
+	  case '"': result += "&quot;"; break;
+	  default: result += c; break;
+	  }
+      }
+    return result;
+  }
+
+  // Escapes S for use in a URL, leaving slashes alone.
+  std::string
+  url_encode(const std::string& s)
+  {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string result;
+    for (char c : s)
+      {
+	const unsigned char u = static_cast<unsigned char>(c);
+	if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z')
+	    || (u >= '0' && u <= '9') || strchr("-._~/", u))
+	  {
+	    result += c;
+	  }
+	else
+	  {
+	    result += '%';
+	    result += hex[u >> 4];
+	    result += hex[u & 15u];
+	  }
+      }
+    return result;
+  }
+
+  int
+  hex_value(char c)
+  {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  // Decodes %XX escapes (and, in a query, '+' for space).  Returns
+  // false for a malformed escape or a NUL.
+  bool
+  url_decode(const std::string& s, bool is_query, std::string *result)
+  {
+    result->clear();
+    for (std::string::size_type i = 0; i < s.size(); ++i)
+      {
+	char c = s[i];
+	if ('%' == c)
+	  {
+	    if (i + 2 >= s.size())
+	      return false;
+	    const int hi = hex_value(s[i + 1]), lo = hex_value(s[i + 2]);
+	    if (hi < 0 || lo < 0 || (0 == hi && 0 == lo))
+	      return false;
+	    c = static_cast<char>(hi * 16 + lo);
+	    i += 2;
+	  }
+	else if (is_query && '+' == c)
+	  {
+	    c = ' ';
+	  }
+	result->push_back(c);
+      }
+    return true;
+  }
+
+  void
+  begin_page(response& r, const std::string& title)
+  {
+    r.body = "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\">\n"
+      "<html>\n"
+      " <head>\n"
+      "  <title>" + quote(title) + "</title>\n"
+      " </head>\n"
+      " <body bgcolor=#ffffff text=#000000 link=#0000ff vlink=#ff0000 alink=#ff00ff>\n"
+      "  <h1>" + quote(title) + "</h1>\n";
+  }
+
+  void
+  end_page(response& r)
+  {
+    r.body += " </body>\n</html>\n";
+  }
+
+  void
+  error_page(response& r, int status, const char *reason,
+	     const std::string& message)
+  {
+    r.status = status;
+    r.reason = reason;
+    r.content_type = "text/html";
+    begin_page(r, reason);
+    r.body += "<p>" + quote(message) + "</p>\n";
+    end_page(r);
+  }
+
+  std::string
+  row_start(int n)
+  {
+    return (n % 2) ? " <tr bgcolor=#c0ffc0>\n" : " <tr bgcolor=#ffffff>\n";
+  }
+
+  // Returns the history file which describes the file NAME in the
+  // directory DIR: the file itself if it is an s-file, otherwise
+  // SCCS/s.NAME, as the sccs driver would choose.  Returns an empty
+  // string if there is none.
+  std::string
+  history_file_for(const std::string& dir, const std::string& name)
+  {
+    if (0 == name.compare(0, 2, "s.") && name.size() > 2)
+      return dir + "/" + name;
+    const std::string sfile = dir + "/SCCS/s." + name;
+    struct stat st;
+    if (0 == stat(sfile.c_str(), &st) && S_ISREG(st.st_mode))
+      return sfile;
+    return std::string();
+  }
+
+  // Runs FN on the cached history file SFILE with the entry locked.
+  // Returns false (leaving the diagnostics in *MESSAGES) if the file
+  // cannot be read.
+  template <class Fn>
+  bool
+  with_sfile(sfile_cache *cache, const std::string& sfile,
+	     std::string *messages, Fn fn)
+  {
+    error_context ctx("csscd", messages);
+    try
+      {
+	sfile_cache::handle h = cache->lookup(sfile);
+	std::lock_guard<std::mutex> guard(h->mutex);
+	fn(*h->file);
+	return true;
+      }
+    catch (const CsscExitvalException&)
+      {
+	return false;
+      }
+  }
+
+  std::string
+  joined_comments(const delta& d, const char *separator)
+  {
+    std::string result;
+    for (const auto& line : d.comments())
+      {
+	if (!result.empty())
+	  result += separator;
+	result += quote(line);
+      }
+    return result;
+  }
+
+  void
+  show_directory(response& r, const std::string& path, const std::string& dir,
+		 sfile_cache *cache)
+  {
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+      {
+	error_page(r, 403, "Forbidden", "cannot read " + path);
+	return;
+      }
+    std::vector<std::string> names;
+    while (const struct dirent *ent = readdir(d))
+      {
+	const std::string name(ent->d_name);
+	if (name != "." && name != "..")
+	  names.push_back(name);
+      }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    begin_page(r, "SCCS: " + path);
+    r.body += "<table cellspacing=0 cellpadding=2>\n"
+      " <tr bgcolor=#f0f0f0>\n"
+      "  <th align=left>Filename</th>\n"
+      "  <th align=left>Type</th>\n"
+      "  <th align=left>User</th>\n"
+      "  <th align=left>Rev</th>\n"
+      "  <th align=left>Date</th>\n"
+      "  <th align=left>Comment</th>\n"
+      " </tr>\n";
+    int n = 0;
+    if (path != "/")
+      {
+	r.body += row_start(n++)
+	  + "  <td>\n   <a href=\"../\">..</a>\n  </td>\n"
+	  + "  <td>dir</td>\n";
+	for (int i = 0; i < 4; ++i)
+	  r.body += "  <td>&nbsp;</td>\n";
+	r.body += " </tr>\n";
+      }
+    for (const auto& name : names)
+      {
+	const std::string full = dir + "/" + name;
+	struct stat st;
+	const char *type = "?";
+	if (0 == lstat(full.c_str(), &st))
+	  {
+	    if (S_ISLNK(st.st_mode))
+	      type = "link";
+	    else if (S_ISDIR(st.st_mode))
+	      type = "dir";
+	    else if (S_ISREG(st.st_mode))
+	      type = "file";
+	  }
+	const bool is_dir = (0 == stat(full.c_str(), &st)
+			     && S_ISDIR(st.st_mode));
+	std::string who = "&nbsp;", id = "&nbsp;", date = "&nbsp;";
+	std::string comment = "&nbsp;";
+	const std::string sfile =
+	  (0 == strcmp(type, "file")) ? history_file_for(dir, name) : "";
+	if (!sfile.empty())
+	  {
+	    std::string ignored;
+	    with_sfile(cache, sfile, &ignored, [&](sccs_file& f)
+	      {
+		const_delta_iterator it(&f.delta_table(),
+					delta_selector::current);
+		if (it.next())
+		  {
+		    who = quote(it->user());
+		    id = quote(it->id().as_string());
+		    date = quote(it->date().as_string().substr(0, 8));
+		    comment = joined_comments(*it, " ");
+		  }
+	      });
+	  }
+	const std::string link = url_encode(name) + (is_dir ? "/" : "");
+	r.body += row_start(n++)
+	  + "  <td>\n   <a href=\"" + quote(link) + "\">" + quote(name)
+	  + "</a>\n  </td>\n"
+	  + "  <td>" + type + "</td>\n"
+	  + "  <td>" + who + "</td>\n"
+	  + "  <td>" + id + "</td>\n"
+	  + "  <td>" + date + "</td>\n"
+	  + "  <td>" + comment + "</td>\n"
+	  + " </tr>\n";
+      }
+    r.body += "</table>\n";
+    end_page(r);
+  }
+
+  void
+  show_history(response& r, const std::string& path, const std::string& name,
+	       const std::string& sfile, sfile_cache *cache)
+  {
+    std::string messages;
+    std::string rows;
+    const bool ok = with_sfile(cache, sfile, &messages, [&](sccs_file& f)
+      {
+	int n = 0;
+	const_delta_iterator it(&f.delta_table(), delta_selector::current);
+	while (it.next())
+	  {
+	    const std::string rev = it->id().as_string();
+	    rows += row_start(n++)
+	      + "  <td valign=top><a href=\""
+	      + quote(url_encode(name) + "?r=" + url_encode(rev)) + "\">"
+	      + quote(rev) + "</a></td>\n"
+	      + "  <td valign=top>" + quote(it->user()) + "</td>\n"
+	      + "  <td valign=top>" + quote(it->date().as_string()) + "</td>\n"
+	      + "  <td valign=top>" + joined_comments(*it, "<br>") + "</td>\n"
+	      + " </tr>\n";
+	  }
+      });
+    if (!ok)
+      {
+	error_page(r, 404, "Not Found",
+		   "Cannot get any SCCS information for " + path + ": "
+		   + messages);
+	return;
+      }
+    begin_page(r, "SCCS: " + path);
+    r.body += "<table cellspacing=0 cellpadding=2>\n"
+      " <tr bgcolor=#f0f0f0>\n"
+      "  <th align=left>Rev</th>\n"
+      "  <th align=left>User</th>\n"
+      "  <th align=left>When</th>\n"
+      "  <th align=left>Comments</th>\n"
+      " </tr>\n"
+      + rows + "</table>\n";
+    end_page(r);
+  }
+
+  void
+  show_version(response& r, const std::string& path, const std::string& sfile,
+	       const std::string& rev, sfile_cache *cache)
+  {
+    const sid requested(rev.c_str());
+    if (!requested.valid())
+      {
+	error_page(r, 400, "Bad Request", "invalid SID " + rev);
+	return;
+      }
+    std::unique_ptr<FILE, int (*)(FILE*)> text(tmpfile(), fclose);
+    if (!text)
+      {
+	error_page(r, 500, "Internal Server Error",
+		   std::string("cannot create a temporary file: ")
+		   + strerror(errno));
+	return;
+      }
+    std::string messages;
+    bool found = false, gotten = false;
+    const bool ok = with_sfile(cache, sfile, &messages, [&](sccs_file& f)
+      {
+	sid retrieve;
+	if (!f.find_requested_sid(requested, retrieve))
+	  return;
+	found = true;
+	FailureOr<get_status> got =
+	  f.get(text.get(), "standard output", nullptr, retrieve, sccs_date(),
+		sid_list(), sid_list(), true, cssc::optional<std::string>(),
+		false, false, false, false);
+	gotten = got.ok();
+	if (!gotten)
+	  messages += got.fail().to_string();
+      });
+    if (!ok || !found)
+      {
+	error_page(r, 404, "Not Found",
+		   ok ? path + " has no delta " + rev
+		   : "Cannot get any SCCS information for " + path + ": "
+		   + messages);
+	return;
+      }
+    if (!gotten || fflush(text.get()) != 0)
+      {
+	error_page(r, 500, "Internal Server Error",
+		   "cannot get " + rev + " of " + path + ": " + messages);
+	return;
+      }
+    rewind(text.get());
+    char buf[8192];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), text.get())) > 0)
+      r.body.append(buf, n);
+    if (ferror(text.get()))
+      {
+	error_page(r, 500, "Internal Server Error",
+		   std::string("cannot read the temporary file: ")
+		   + strerror(errno));
+	return;
+      }
+    r.content_type = "text/plain";
+  }
+
+  // Fills in R for a GET of TARGET.
+  void
+  answer(response& r, const std::string& target, const std::string& root,
+	 sfile_cache *cache)
+  {
+    const std::string::size_type qmark = target.find('?');
+    const std::string raw_path = target.substr(0, qmark);
+    std::string path;
+    if (raw_path.empty() || raw_path[0] != '/'
+	|| !url_decode(raw_path, false, &path))
+      {
+	error_page(r, 400, "Bad Request", "invalid path");
+	return;
+      }
+    // Don't let anyone out of the tree.
+    if (path.find("/../") != std::string::npos
+	|| (path.size() >= 3 && 0 == path.compare(path.size() - 3, 3, "/..")))
+      {
+	error_page(r, 403, "Forbidden", "invalid path " + path);
+	return;
+      }
+
+    std::string rev;
+    bool want_version = false;
+    if (qmark != std::string::npos)
+      {
+	std::string::size_type pos = qmark + 1;
+	while (pos <= target.size())
+	  {
+	    std::string::size_type amp = target.find('&', pos);
+	    if (amp == std::string::npos)
+	      amp = target.size();
+	    const std::string param = target.substr(pos, amp - pos);
+	    if (0 == param.compare(0, 2, "r="))
+	      {
+		if (!url_decode(param.substr(2), true, &rev))
+		  {
+		    error_page(r, 400, "Bad Request", "invalid query");
+		    return;
+		  }
+		want_version = true;
+	      }
+	    pos = amp + 1;
+	  }
+      }
+
+    const std::string full = root + path;
+    struct stat st;
+    // There need not be a working file for a history file in SCCS/.
+    const bool exists = (0 == stat(full.c_str(), &st));
+    if (exists && S_ISDIR(st.st_mode))
+      {
+	if (path[path.size() - 1] != '/')
+	  {
+	    // Make sure directory URLs always end in a slash, so that
+	    // the links in the page are relative to the directory.
+	    r.status = 301;
+	    r.reason = "Moved Permanently";
+	    r.location = raw_path + "/";
+	    begin_page(r, r.reason);
+	    r.body += "<p><a href=\"" + quote(r.location) + "\">"
+	      + quote(r.location) + "</a></p>\n";
+	    end_page(r);
+	    return;
+	  }
+	show_directory(r, path, full.substr(0, full.size() - 1), cache);
+	return;
+      }
+    const std::string::size_type slash = path.rfind('/');
+    const std::string name = path.substr(slash + 1);
+    const std::string dir = root + path.substr(0, slash);
+    const std::string sfile =
+      (name.empty() || (exists && !S_ISREG(st.st_mode)))
+      ? std::string() : history_file_for(dir, name);
+    if (sfile.empty())
+      {
+	if (exists)
+	  error_page(r, 404, "Not Found",
+		     "Cannot get any SCCS information for " + path);
+	else
+	  error_page(r, 404, "Not Found",
+		     "\"" + path + "\" is not a valid path");
+	return;
+      }
+    if (want_version)
+      show_version(r, path, sfile, rev, cache);
+    else
+      show_history(r, path, name, sfile, cache);
+  }
+
+  bool
+  send_all(int fd, const char *buf, size_t len)
+  {
+    while (len)
+      {
+	ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+	if (n < 0 && errno == EINTR)
+	  continue;
+	if (n <= 0)
+	  return false;
+	buf += n;
+	len -= static_cast<size_t>(n);
+      }
+    return true;
+  }
+
+  // Reads the request line and headers; returns false if there is no
+  // complete request.
+  bool
+  read_request(int fd, std::string *head)
+  {
+    char buf[4096];
+    while (head->find("\r\n\r\n") == std::string::npos
+	   && head->find("\n\n") == std::string::npos)
+      {
+	if (head->size() >= max_request_header)
+	  return false;
+	ssize_t n = recv(fd, buf, sizeof(buf), 0);
+	if (n < 0 && errno == EINTR)
+	  continue;
+	if (n <= 0)
+	  return false;
+	head->append(buf, static_cast<size_t>(n));
+      }
+    return true;
+  }
+}
+
+
+FailureOr<int>
+http_listen(unsigned short port, unsigned short *bound)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return cssc::make_failure_builder_from_errno(errno)
+      << "failed to create a socket";
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (0 != bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)))
+    {
+      const int saved_errno = errno;
+      close(fd);
+      return cssc::make_failure_builder_from_errno(saved_errno)
+	<< "failed to bind to port " << port;
+    }
+  if (0 != listen(fd, SOMAXCONN))
+    {
+      const int saved_errno = errno;
+      close(fd);
+      return cssc::make_failure_builder_from_errno(saved_errno)
+	<< "failed to listen on port " << port;
+    }
+  socklen_t len = sizeof(addr);
+  if (0 != getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len))
+    {
+      const int saved_errno = errno;
+      close(fd);
+      return cssc::make_failure_builder_from_errno(saved_errno)
+	<< "getsockname failed";
+    }
+  *bound = ntohs(addr.sin_port);
+  return fd;
+}
+
+
+void
+http_serve(int fd, const std::string& root, sfile_cache *cache)
+{
+  // A client which sends nothing must not keep the thread forever.
+  struct timeval timeout;
+  timeout.tv_sec = request_timeout_seconds;
+  timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  std::string head;
+  if (!read_request(fd, &head))
+    {
+      close(fd);
+      return;
+    }
+
+  response r;
+  bool send_body = true;
+  const std::string::size_type eol = head.find('\n');
+  std::string line = head.substr(0, eol);
+  if (!line.empty() && line[line.size() - 1] == '\r')
+    line.resize(line.size() - 1);
+  const std::string::size_type sp1 = line.find(' ');
+  const std::string::size_type sp2 =
+    (sp1 == std::string::npos) ? sp1 : line.find(' ', sp1 + 1);
+  if (sp2 == std::string::npos
+      || 0 != line.compare(sp2 + 1, 5, "HTTP/"))
+    {
+      error_page(r, 400, "Bad Request", "malformed request");
+    }
+  else
+    {
+      const std::string method = line.substr(0, sp1);
+      const std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+      if (method == "GET" || method == "HEAD")
+	{
+	  send_body = (method == "GET");
+	  try
+	    {
+	      answer(r, target, root, cache);
+	    }
+	  catch (const std::exception& e)
+	    {
+	      error_page(r, 500, "Internal Server Error", e.what());
+	    }
+	}
+      else
+	{
+	  error_page(r, 405, "Method Not Allowed",
+		     "only GET and HEAD are supported");
+	}
+    }
+
+  char status[64];
+  snprintf(status, sizeof(status), "HTTP/1.1 %d ", r.status);
+  std::string header = std::string(status) + r.reason + "\r\n"
+    + "Content-Type: " + r.content_type + "\r\n"
+    + "Content-Length: " + std::to_string(r.body.size()) + "\r\n";
+  if (!r.location.empty())
+    header += "Location: " + r.location + "\r\n";
+  if (405 == r.status)
+    header += "Allow: GET, HEAD\r\n";
+  header += "Connection: close\r\n\r\n";
+  if (send_all(fd, header.data(), header.size()) && send_body)
+    send_all(fd, r.body.data(), r.body.size());
+  close(fd);
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
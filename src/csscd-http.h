@@ -0,0 +1,51 @@
+/*
+ * csscd-http.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The web interface of csscd: a small HTTP/1.1 server which shows a
+ * tree of history files, as sccs.cgi does, from parsed history files
+ * kept in an sfile_cache.
+ *
+ */
+
+#ifndef CSSC__CSSCD_HTTP_H__
+#define CSSC__CSSCD_HTTP_H__
+
+#include <string>
+
+#include "failure_or.h"
+
+class sfile_cache;
+
+// Listens for HTTP connections on PORT of the loopback interface (and
+// no other).  If PORT is 0 the system chooses the port; either way
+// *BOUND is set to the port in use.
+cssc::FailureOr<int> http_listen(unsigned short port, unsigned short *bound);
+
+// Answers one request on the connected socket FD, and closes it.
+// Paths in the request are taken relative to ROOT: a directory is
+// shown as a list of its files with the latest delta of each history
+// file, a history file as the list of its deltas, and with "?r=SID"
+// as the text of that version (as "get -p -r SID" gives it).
+void http_serve(int fd, const std::string& root, sfile_cache *cache);
+
+#endif /* CSSC__CSSCD_HTTP_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
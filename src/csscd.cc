@@ -0,0 +1,1065 @@
+/*
+ * csscd.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A server which keeps recently used history files parsed, and runs
+ * read-only requests ("get -p", prs and prt) for them.  The sccs
+ * driver passes such commands to the server when $CSSC_SERVER names
+ * its socket (see try_server() in sccs.c).
+ *
+ * The protocol is deliberately simple.  The client sends a 4-byte
+ * big-endian length followed by that many bytes: the string
+ * "CSSC1", the client's working directory and then the command's
+ * argument vector, each terminated by a NUL.  The client's stdout
+ * and stderr file descriptors accompany the request (SCM_RIGHTS),
+ * and the server writes the command's output directly to them.  The
+ * server then replies with a single line, either "exit N" (N being
+ * the command's exit status) or "fallback", meaning that the client
+ * should run the command itself.  The server falls back for anything
+ * it doesn't handle exactly as the real program would, for example
+ * options which modify files, or reading file names from stdin, and
+ * for clients it will not serve.  A client which gets no reply at all
+ * also runs the command itself.
+ *
+ * With -H, the server also shows a tree of history files to web
+ * browsers, from the same cache (see csscd-http.cc).
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cssc.h"
+#include "csscd-http.h"
+#include "delta.h"
+#include "except.h"
+#include "failure.h"
+#include "file.h"
+#include "ioerr.h"
+#include "my-getopt.h"
+#include "quit.h"
+#include "sccsfile.h"
+#include "sfile-cache.h"
+#include "version.h"
+#include "stats.h"
+
+using cssc::Failure;
+using cssc::FailureOr;
+using cssc::Update;
+
+// These must match the definitions in sccs.c.
+#define CSSCD_MAGIC "CSSC1"
+#define CSSCD_MAX_REQUEST (1024uL * 1024uL)
+
+void
+usage()
+{
+  fprintf(stderr,
+	  "usage: %s [-V] [-n max-files] [-s socket] [-H port [-D directory]]\n",
+	  prg_name);
+}
+
+namespace
+{
+  const int FALLBACK = -1;	// Let the client run the command.
+
+  sfile_cache *cache = nullptr;
+
+  struct request
+  {
+    std::string cwd;
+    std::vector<std::string> args;
+  };
+
+  // The name of a history file as the client gave it, and the name we
+  // use for it (which doesn't depend on our working directory).
+  struct file_arg
+  {
+    std::string display;
+    std::string path;
+  };
+
+  // The client's output streams, plus the diagnostics issued while
+  // running its command.
+  class client_streams
+  {
+  public:
+    client_streams(FILE *out, FILE *err)
+      : out_(out), err_(err), diagnostics_(), file_(nullptr)
+    {
+    }
+
+    FILE *out() const { return out_; }
+    std::string *diagnostics() { return &diagnostics_; }
+
+    // Returns the stream for the client's stderr, having first sent
+    // any diagnostics issued so far, so that the two are in order.
+    FILE *err()
+    {
+      if (!diagnostics_.empty())
+	{
+	  if (file_)
+	    rename_file(*file_);
+	  fwrite(diagnostics_.data(), 1, diagnostics_.size(), err_);
+	  diagnostics_.clear();
+	}
+      return err_;
+    }
+
+    // Sets the history file being worked on.  Messages from the
+    // sccs_file object use the name we gave it, but the client
+    // expects the name it gave us.
+    void set_file(const file_arg *f)
+    {
+      err();
+      file_ = f;
+    }
+
+  private:
+    void rename_file(const file_arg& f)
+    {
+      if (f.path == f.display)
+	return;
+      std::string::size_type pos = 0;
+      while ((pos = diagnostics_.find(f.path, pos)) != std::string::npos)
+	{
+	  diagnostics_.replace(pos, f.path.size(), f.display);
+	  pos += f.display.size();
+	}
+    }
+
+    FILE *out_;
+    FILE *err_;
+    std::string diagnostics_;
+    const file_arg *file_;
+  };
+
+  // Collects the file operands of REQ from OPTS, or returns false if
+  // the server should not handle them (for example because they are
+  // to be read from stdin or a directory).  This follows
+  // sccs_file_iterator.
+  bool
+  file_operands(const request& req, const CSSC_Options& opts,
+		std::vector<file_arg> *files)
+  {
+    char **argv = opts.get_argv() + opts.get_index();
+    int argc = opts.get_argc() - opts.get_index();
+    if (argc < 1)
+      return false;		// Let the program produce the message.
+    for (int i = 0; i < argc; ++i)
+      {
+	file_arg f;
+	f.display = argv[i];
+	if (f.display.empty() || f.display == "-")
+	  return false;
+	f.path = (f.display[0] == '/') ? f.display : req.cwd + "/" + f.display;
+	if (0 == i)
+	  {
+	    struct stat st;
+	    if (0 == stat(f.path.c_str(), &st) && S_ISDIR(st.st_mode))
+	      return false;
+	  }
+	files->push_back(f);
+      }
+    return true;
+  }
+
+  // Owns a mutable copy of an argument vector, for CSSC_Options.
+  class arg_vector
+  {
+  public:
+    explicit arg_vector(const std::vector<std::string>& args)
+      : storage_(args), argv_()
+    {
+      for (auto& s : storage_)
+	argv_.push_back(&s[0]);
+      argv_.push_back(nullptr);
+    }
+
+    int argc() const { return static_cast<int>(storage_.size()); }
+    char **argv() { return argv_.data(); }
+
+  private:
+    std::vector<std::string> storage_;
+    std::vector<char*> argv_;
+  };
+
+  // Runs FN on the cached history file named by ARG with the entry
+  // locked.  Exceptions are handled as the programs' main loops do.
+  template <class Fn>
+  void
+  with_sfile(const file_arg& arg, client_streams& io, int& retval, Fn fn)
+  {
+    io.set_file(&arg);
+    try
+      {
+	sfile_cache::handle h = cache->lookup(arg.path);
+	std::lock_guard<std::mutex> guard(h->mutex);
+	fn(*h);
+      }
+    catch (const CsscExitvalException& e)
+      {
+	if (e.exitval > retval)
+	  retval = e.exitval;
+      }
+    io.set_file(nullptr);
+  }
+
+  // Temporarily gives a cached history file the name the client used
+  // for it, for operations which print that name.
+  class display_name
+  {
+  public:
+    display_name(sfile_cache::entry& e, const std::string& name)
+      : entry_(e), saved_(e.name.sfile())
+    {
+      entry_.name = name;
+    }
+
+    ~display_name()
+    {
+      entry_.name = saved_;
+    }
+
+  private:
+    sfile_cache::entry& entry_;
+    std::string saved_;
+  };
+
+  // "get -p"; see get.cc.
+  int
+  serve_get(const request& req, client_streams& io)
+  {
+    arg_vector args(req.args);
+    CSSC_Options opts(args.argc(), args.argv(),
+		      "r!c!i!x!ebkl!psmngtw!a!DVG!L", 0);
+    sid org_rid(sid::null_sid());
+    bool suppress_keywords = false, send_body_to_stdout = false;
+    bool silent = false, show_sid = false, show_module = false;
+    bool get_top_delta = false;
+    cssc::optional<std::string> wstring;
+    sid_list include, exclude;
+    sccs_date cutoff_date;
+    seq_no seq = 0;
+
+    for (int c = opts.next(); c != CSSC_Options::END_OF_ARGUMENTS;
+	 c = opts.next())
+      {
+	switch (c)
+	  {
+	  default:
+	    // Options which create files or lock the history file,
+	    // -G, -D and -V, and all errors, are left to get itself.
+	    return FALLBACK;
+
+	  case 'r':
+	    org_rid = sid(opts.getarg());
+	    if (!org_rid.valid())
+	      return FALLBACK;
+	    break;
+
+	  case 'c':
+	    cutoff_date = sccs_date(opts.getarg());
+	    if (!cutoff_date.valid())
+	      return FALLBACK;
+	    break;
+
+	  case 'i':
+	    include = sid_list(opts.getarg());
+	    if (!include.valid())
+	      return FALLBACK;
+	    break;
+
+	  case 'x':
+	    exclude = sid_list(opts.getarg());
+	    if (!exclude.valid())
+	      return FALLBACK;
+	    break;
+
+	  case 'k':
+	    suppress_keywords = true;
+	    break;
+
+	  case 'p':
+	    send_body_to_stdout = true;
+	    break;
+
+	  case 's':
+	    silent = true;
+	    break;
+
+	  case 'm':
+	    show_sid = true;
+	    break;
+
+	  case 'n':
+	    show_module = true;
+	    break;
+
+	  case 't':
+	    get_top_delta = true;
+	    break;
+
+	  case 'w':
+	    if (opts.getarg())
+	      wstring = std::string(opts.getarg());
+	    break;
+
+	  case 'a':
+	    {
+	      const long long i = atoll(opts.getarg());
+	      if (i < 1 || i > max_seq_no)
+		return FALLBACK;
+	      seq = static_cast<seq_no>(i);
+	    }
+	    break;
+	  }
+      }
+    if (!send_body_to_stdout)
+      return FALLBACK;		// We don't create g-files.
+
+    std::vector<file_arg> files;
+    if (!file_operands(req, opts, &files))
+      return FALLBACK;
+
+    FILE *commentary = nullptr;
+    if (silent)
+      {
+	FailureOr<FILE*> opened = open_null();
+	if (!opened.ok())
+	  return FALLBACK;
+	commentary = *opened;
+      }
+    ResourceCleanup null_closer([silent, commentary]()
+      {
+	if (silent)
+	  fclose(commentary);
+      });
+
+    int retval = 0;
+    for (const auto& arg : files)
+      {
+	FILE *comm = silent ? commentary : io.err();
+	if (files.size() > 1)
+	  fprintf(comm, "\n%s:\n", arg.display.c_str());
+
+	with_sfile(arg, io, retval, [&](sfile_cache::entry& e)
+	  {
+	    sccs_file& file(*e.file);
+	    sid retrieve;
+
+	    if (seq)
+	      {
+		if (org_rid.valid())
+		  {
+		    warning("both the -r and the -a "
+			    "option have been specified; "
+			    "the -r option has been ignored.");
+		  }
+		if (!file.find_requested_seqno(seq, retrieve))
+		  {
+		    errormsg("%s: Requested sequence number %u not found.",
+			     arg.display.c_str(), static_cast<unsigned>(seq));
+		    retval = 1;
+		    return;
+		  }
+	      }
+	    else
+	      {
+		sid rid = org_rid;
+		if (!file.find_requested_sid(rid, retrieve, get_top_delta))
+		  {
+		    errormsg("%s: Requested SID not found.",
+			     arg.display.c_str());
+		    retval = 1;
+		    return;
+		  }
+	      }
+
+	    FailureOr<get_status> gotten =
+	      file.get(io.out(), "standard output", nullptr, retrieve,
+		       cutoff_date, include, exclude, !suppress_keywords,
+		       wstring, show_sid, show_module, false, false);
+	    if (!gotten.ok())
+	      return;
+
+	    FILE *comm = silent ? commentary : io.err();
+	    Failure f;
+	    f = Update(f, print_id_list(comm, "Included", (*gotten).included));
+	    f = Update(f, print_id_list(comm, "Excluded", (*gotten).excluded));
+	    f = Update(f, retrieve.print(comm));
+	    f = Update(f, fputc_failure('\n', comm));
+	    if (!f.ok())
+	      retval = 1;
+	    fprintf(comm, "%u lines\n", (*gotten).lines);
+	  });
+      }
+    return retval;
+  }
+
+  // prs; see prs.cc.
+  int
+  serve_prs(const request& req, client_streams& io)
+  {
+    arg_vector args(req.args);
+    CSSC_Options opts(args.argc(), args.argv(), "d!Dr!elc!aV", 0);
+    std::string format = ":Dt:\t:DL:\nMRs:\n:MR:COMMENTS:\n:C:";
+    sid rid(sid::null_sid());
+    sccs_file::when selected = sccs_file::when::SIDONLY;
+    delta_selector selector = delta_selector::current;
+    sccs_date cutoff_date;
+    bool default_processing = true;
+
+    for (int c = opts.next(); c != CSSC_Options::END_OF_ARGUMENTS;
+	 c = opts.next())
+      {
+	switch (c)
+	  {
+	  default:
+	    return FALLBACK;
+
+	  case 'd':
+	    format = opts.getarg();
+	    default_processing = false;
+	    break;
+
+	  case 'D':
+	    default_processing = false;
+	    break;
+
+	  case 'r':
+	    if (strlen(opts.getarg()))
+	      {
+		rid = sid(opts.getarg());
+		if (!rid.valid() || rid.partial_sid())
+		  return FALLBACK;
+	      }
+	    default_processing = false;
+	    break;
+
+	  case 'c':
+	    cutoff_date = sccs_date(opts.getarg());
+	    if (!cutoff_date.valid())
+	      return FALLBACK;
+	    break;
+
+	  case 'e':
+	    selected = sccs_file::when::EARLIER;
+	    default_processing = false;
+	    break;
+
+	  case 'l':
+	    selected = sccs_file::when::LATER;
+	    default_processing = false;
+	    break;
+
+	  case 'a':
+	    selector = delta_selector::all;
+	    break;
+	  }
+      }
+    if (selected == sccs_file::when::SIDONLY && cutoff_date.valid())
+      return FALLBACK;
+    if (default_processing)
+      selected = sccs_file::when::EARLIER;
+
+    std::vector<file_arg> files;
+    if (!file_operands(req, opts, &files))
+      return FALLBACK;
+
+    int retval = 0;
+    for (const auto& arg : files)
+      {
+	with_sfile(arg, io, retval, [&](sfile_cache::entry& e)
+	  {
+	    if (default_processing)
+	      fprintf(io.out(), "%s:\n\n", arg.display.c_str());
+	    FailureOr<bool> matched_or_fail =
+	      e.file->prs(io.out(), "standard output", format, rid,
+			  cutoff_date, selected, selector);
+	    if (!matched_or_fail.ok())
+	      {
+		errormsg("%s: %s", arg.display.c_str(),
+			 matched_or_fail.fail().to_string().c_str());
+		retval = 1;
+	      }
+	    else if (!*matched_or_fail && rid.valid())
+	      {
+		errormsg("%s: Requested SID doesn't exist.",
+			 arg.display.c_str());
+		retval = 1;
+	      }
+	  });
+      }
+    return retval;
+  }
+
+  // prt; see prt.cc.
+  int
+  serve_prt(const request& req, client_streams& io)
+  {
+    arg_vector args(req.args);
+    CSSC_Options opts(args.argc(), args.argv(), "abdefistuVc!r!y!", 0);
+    delta_selector selector = delta_selector::current;
+    int print_body = 0, print_delta_table = 0, print_flags = 0;
+    int incl_excl_ignore = 0, first_line_only = 0, print_desc = 0;
+    int print_users = 0;
+    sccs_file::cutoff exclude;
+    int last_cutoff_type = 0;
+    bool do_default = true;
+
+    for (int c = opts.next(); c != CSSC_Options::END_OF_ARGUMENTS;
+	 c = opts.next())
+      {
+	switch (c)
+	  {
+	  default:
+	    return FALLBACK;
+
+	  case 'a':
+	    selector = delta_selector::all;
+	    break;
+	  case 'b':
+	    print_body = 1;
+	    do_default = false;
+	    break;
+	  case 'd':
+	    print_delta_table = 1;
+	    break;
+	  case 'e':
+	    print_delta_table = incl_excl_ignore = 1;
+	    print_users = print_flags = print_desc = 1;
+	    break;
+	  case 'f':
+	    print_flags = 1;
+	    do_default = false;
+	    break;
+	  case 'i':
+	    incl_excl_ignore = 1;
+	    first_line_only = 0;
+	    break;
+	  case 's':
+	    first_line_only = 1;
+	    incl_excl_ignore = 0;
+	    break;
+	  case 't':
+	    print_desc = 1;
+	    do_default = false;
+	    break;
+	  case 'u':
+	    print_users = 1;
+	    do_default = false;
+	    break;
+
+	  case 'y':
+	    exclude.enabled = true;
+	    if (strlen(opts.getarg()))
+	      {
+		exclude.cutoff_sid = sid(opts.getarg());
+		exclude.most_recent_sid_only = false;
+		if (!exclude.cutoff_sid.valid()
+		    || exclude.cutoff_sid.partial_sid())
+		  return FALLBACK;
+	      }
+	    else
+	      {
+		exclude.most_recent_sid_only = true;
+	      }
+	    break;
+
+	  case 'c':
+	  case 'r':
+	    {
+	      exclude.enabled = true;
+	      if (0 != last_cutoff_type && c != last_cutoff_type)
+		return FALLBACK;
+	      last_cutoff_type = c;
+	      sccs_date date = sccs_date(opts.getarg());
+	      if (!date.valid())
+		return FALLBACK;
+	      if (c == 'r')
+		exclude.last_accepted = date;
+	      else
+		exclude.first_accepted = date;
+	    }
+	    break;
+	  }
+      }
+    if (do_default)
+      print_delta_table = 1;
+
+    std::vector<file_arg> files;
+    if (!file_operands(req, opts, &files))
+      return FALLBACK;
+
+    int retval = 0;
+    for (const auto& arg : files)
+      {
+	if (!exclude.enabled)
+	  fprintf(io.out(), "\n%s:", arg.display.c_str());
+	fprintf(io.out(), "\n");
+
+	with_sfile(arg, io, retval, [&](sfile_cache::entry& e)
+	  {
+	    // prt prints the name of the file with each delta when
+	    // there is a cutoff.
+	    display_name named(e, arg.display);
+	    Failure done =
+	      e.file->prt(io.out(), exclude, selector, print_body,
+			  print_delta_table, print_flags, incl_excl_ignore,
+			  first_line_only, print_desc, print_users);
+	    if (!done.ok())
+	      {
+		errormsg("%s: %s", arg.display.c_str(),
+			 done.to_string().c_str());
+		retval = 1;
+	      }
+	  });
+      }
+    return retval;
+  }
+
+  // Runs the command described by REQ, returning its exit status or
+  // FALLBACK.
+  int
+  serve(const request& req, client_streams& io)
+  {
+    const std::string& prog = req.args[0];
+    const std::string::size_type slash = prog.rfind('/');
+    const std::string base =
+      (slash == std::string::npos) ? prog : prog.substr(slash + 1);
+
+    // Diagnostics are prefixed with the name the client used, as they
+    // would be by the program itself.
+    error_context ctx(prog.c_str(), io.diagnostics());
+    int status = FALLBACK;
+    if (base == "get")
+      status = serve_get(req, io);
+    else if (base == "prs")
+      status = serve_prs(req, io);
+    else if (base == "prt")
+      status = serve_prt(req, io);
+    io.err();			// Flush the diagnostics.
+    return status;
+  }
+
+  bool
+  read_fully(int fd, char *buf, size_t len)
+  {
+    while (len)
+      {
+	ssize_t n = read(fd, buf, len);
+	if (n < 0 && errno == EINTR)
+	  continue;
+	if (n <= 0)
+	  return false;
+	buf += n;
+	len -= static_cast<size_t>(n);
+      }
+    return true;
+  }
+
+  bool
+  write_fully(int fd, const char *buf, size_t len)
+  {
+    while (len)
+      {
+	ssize_t n = write(fd, buf, len);
+	if (n < 0 && errno == EINTR)
+	  continue;
+	if (n <= 0)
+	  return false;
+	buf += n;
+	len -= static_cast<size_t>(n);
+      }
+    return true;
+  }
+
+  // Only the user running the server may use it, since it reads
+  // files with that user's privileges.
+  bool
+  peer_is_trusted(int fd)
+  {
+#if defined HAVE_GETPEEREID
+    uid_t uid;
+    gid_t gid;
+    if (0 != getpeereid(fd, &uid, &gid))
+      return false;
+    return uid == geteuid();
+#elif defined SO_PEERCRED
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (0 != getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len))
+      return false;
+    return cred.uid == geteuid();
+#else
+    // We rely on the permissions of the socket.
+    (void)fd;
+    return true;
+#endif
+  }
+
+  // Reads a request, and the client's stdout and stderr, from FD.
+  bool
+  receive_request(int fd, request *req, int client_fds[2])
+  {
+    unsigned char header[4];
+    union
+    {
+      struct cmsghdr align;
+      char buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct iovec iov;
+    iov.iov_base = header;
+    iov.iov_len = sizeof(header);
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n;
+    do
+      n = recvmsg(fd, &msg, 0);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+      return false;
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET
+	&& cmsg->cmsg_type == SCM_RIGHTS
+	&& cmsg->cmsg_len == CMSG_LEN(2 * sizeof(int)))
+      {
+	memcpy(client_fds, CMSG_DATA(cmsg), 2 * sizeof(int));
+      }
+    else
+      {
+	return false;
+      }
+    if (msg.msg_flags & MSG_CTRUNC)
+      return false;
+
+    if (n < 4 && !read_fully(fd, reinterpret_cast<char*>(header) + n, 4 - n))
+      return false;
+    const unsigned long len = (static_cast<unsigned long>(header[0]) << 24)
+      | (static_cast<unsigned long>(header[1]) << 16)
+      | (static_cast<unsigned long>(header[2]) << 8)
+      | static_cast<unsigned long>(header[3]);
+    if (len == 0 || len > CSSCD_MAX_REQUEST)
+      return false;
+    std::vector<char> payload(len);
+    if (!read_fully(fd, payload.data(), len) || payload.back() != '\0')
+      return false;
+
+    std::vector<std::string> fields;
+    for (const char *p = payload.data(); p < payload.data() + len;
+	 p += strlen(p) + 1)
+      fields.push_back(p);
+    if (fields.size() < 3 || fields[0] != CSSCD_MAGIC || fields[1].empty()
+	|| fields[1][0] != '/')
+      return false;
+    req->cwd = fields[1];
+    req->args.assign(fields.begin() + 2, fields.end());
+    return true;
+  }
+
+  void
+  handle_connection(int fd)
+  {
+    request req;
+    int client_fds[2] = { -1, -1 };
+    // Even an untrusted client's request is read, so that it is not
+    // still sending when we hang up on it.
+    const bool trusted = peer_is_trusted(fd);
+    if (receive_request(fd, &req, client_fds) && trusted)
+      {
+	FILE *out = fdopen(client_fds[0], "w");
+	FILE *err = fdopen(client_fds[1], "w");
+	int status = FALLBACK;
+	if (out && err)
+	  {
+	    setvbuf(err, nullptr, _IONBF, 0);
+	    client_streams io(out, err);
+	    try
+	      {
+		status = serve(req, io);
+	      }
+	    catch (const std::exception& e)
+	      {
+		fprintf(err, "%s: %s\n", req.args[0].c_str(), e.what());
+		status = 1;
+	      }
+	  }
+	if (out)
+	  {
+	    if (fclose_failed(fclose(out)) && status == 0)
+	      status = 1;
+	  }
+	else
+	  {
+	    close(client_fds[0]);
+	  }
+	if (err)
+	  fclose(err);
+	else
+	  close(client_fds[1]);
+
+	char reply[32];
+	if (status == FALLBACK)
+	  snprintf(reply, sizeof(reply), "fallback\n");
+	else
+	  snprintf(reply, sizeof(reply), "exit %d\n", status);
+	write_fully(fd, reply, strlen(reply));
+      }
+    else
+      {
+	for (int cfd : client_fds)
+	  if (cfd >= 0)
+	    close(cfd);
+	// We have served nothing, so the client should do the work.
+	static const char fallback[] = "fallback\n";
+	write_fully(fd, fallback, sizeof(fallback) - 1);
+      }
+    close(fd);
+  }
+
+  FailureOr<int>
+  listen_on(const std::string& path)
+  {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+      return cssc::make_failure_builder_from_errno(ENAMETOOLONG)
+	<< "socket name " << path << " is too long";
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+      return cssc::make_failure_builder_from_errno(errno)
+	<< "failed to create a socket";
+
+    // If there is a socket already, either another server is using it
+    // (in which case we don't start) or it is left over.
+    if (0 == connect(fd, reinterpret_cast<struct sockaddr*>(&addr),
+		     sizeof(addr)))
+      {
+	close(fd);
+	return cssc::make_failure_builder_from_errno(EADDRINUSE)
+	  << "a server is already listening on " << path;
+      }
+    close(fd);
+    unlink(path.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+      return cssc::make_failure_builder_from_errno(errno)
+	<< "failed to create a socket";
+    const mode_t saved_umask = umask(077);
+    const int bound = bind(fd, reinterpret_cast<struct sockaddr*>(&addr),
+			   sizeof(addr));
+    const int saved_errno = errno;
+    umask(saved_umask);
+    if (bound != 0)
+      {
+	close(fd);
+	return cssc::make_failure_builder_from_errno(saved_errno)
+	  << "failed to bind to " << path;
+      }
+    if (0 != listen(fd, SOMAXCONN))
+      {
+	const int listen_errno = errno;
+	close(fd);
+	return cssc::make_failure_builder_from_errno(listen_errno)
+	  << "failed to listen on " << path;
+      }
+    return fd;
+  }
+
+  // Accepts connections on LISTEN_FD for ever, handling each in a
+  // new thread.
+  template <class Handler>
+  int
+  accept_loop(int listen_fd, Handler handler)
+  {
+    for (;;)
+      {
+	int fd = accept(listen_fd, nullptr, nullptr);
+	if (fd < 0)
+	  {
+	    if (errno == EINTR || errno == ECONNABORTED)
+	      continue;
+	    errormsg_with_errno("accept failed");
+	    return 1;
+	  }
+	std::thread(handler, fd).detach();
+      }
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  Cleaner arbitrary_name;
+  std::string socket_name;
+  unsigned long max_files = 100uL;
+
+  if (argc > 0)
+    set_prg_name(argv[0]);
+  else
+    set_prg_name("csscd");
+  start_stats();
+
+  const char *env = getenv("CSSC_SERVER");
+  if (env)
+    socket_name = env;
+
+  bool serve_http = false;	// -H
+  unsigned long http_port = 0uL;
+  std::string http_root = ".";	// -D
+
+  CSSC_Options opts(argc, argv, "s!n!H!D!V");
+  for (int c = opts.next(); c != CSSC_Options::END_OF_ARGUMENTS;
+       c = opts.next())
+    {
+      switch (c)
+	{
+	default:
+	  errormsg("Unsupported option: '%c'", c);
+	  return 2;
+
+	case 's':
+	  socket_name = opts.getarg();
+	  break;
+
+	case 'n':
+	  {
+	    char *end;
+	    max_files = strtoul(opts.getarg(), &end, 10);
+	    if (*end || 0 == max_files)
+	      {
+		errormsg("Invalid number of files: '%s'", opts.getarg());
+		return 2;
+	      }
+	  }
+	  break;
+
+	case 'H':
+	  {
+	    char *end;
+	    http_port = strtoul(opts.getarg(), &end, 10);
+	    if (*end || !*opts.getarg() || http_port > 65535uL)
+	      {
+		errormsg("Invalid port number: '%s'", opts.getarg());
+		return 2;
+	      }
+	    serve_http = true;
+	  }
+	  break;
+
+	case 'D':
+	  http_root = opts.getarg();
+	  break;
+
+	case 'V':
+	  version();
+	  break;
+	}
+    }
+  if (opts.get_index() != argc)
+    {
+      usage();
+      return 2;
+    }
+  if (socket_name.empty() && !serve_http)
+    {
+      errormsg("No socket specified; use -s or -H, or set CSSC_SERVER.");
+      return 2;
+    }
+  // Remove any trailing slashes from the root, since the paths of
+  // requests begin with one.
+  while (http_root.size() > 1 && http_root[http_root.size() - 1] == '/')
+    http_root.resize(http_root.size() - 1);
+  if (http_root == "/")
+    http_root.clear();
+
+  // A client which goes away must not kill the server.
+  signal(SIGPIPE, SIG_IGN);
+
+  int listen_fd = -1;
+  if (!socket_name.empty())
+    {
+      FailureOr<int> listening = listen_on(socket_name);
+      if (!listening.ok())
+	{
+	  errormsg("%s", listening.to_string().c_str());
+	  return 1;
+	}
+      listen_fd = *listening;
+    }
+
+  int http_fd = -1;
+  if (serve_http)
+    {
+      unsigned short bound;
+      FailureOr<int> listening =
+	http_listen(static_cast<unsigned short>(http_port), &bound);
+      if (!listening.ok())
+	{
+	  errormsg("%s", listening.to_string().c_str());
+	  return 1;
+	}
+      http_fd = *listening;
+      if (0 == http_port)
+	{
+	  // Tell the user which port the system chose.
+	  printf("http://127.0.0.1:%u/\n", static_cast<unsigned>(bound));
+	  fflush(stdout);
+	}
+    }
+
+  sfile_cache files(max_files);
+  cache = &files;
+  auto web = [&http_root](int fd) { http_serve(fd, http_root, cache); };
+  if (listen_fd < 0)
+    return accept_loop(http_fd, web);
+  if (http_fd >= 0)
+    std::thread([http_fd, web]() { accept_loop(http_fd, web); }).detach();
+  return accept_loop(listen_fd, handle_connection);
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,81 @@
+/*
+ * date-index.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Members of the class date_index.
+ *
+ */
+
+#include <config.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "cssc.h"
+#include "date-index.h"
+#include "delta-table.h"
+#include "sccsdate.h"
+
+
+date_index::date_index(const cssc_delta_table& table)
+  : highest_(table.highest_seqno()),
+    by_date_()
+{
+  by_date_.reserve(table.size());
+  for (cssc_delta_table::size_type i = 0; i < table.size(); ++i)
+    {
+      const delta& d = table.at(i);
+      by_date_.push_back(entry(d.date().packed(), d.seq()));
+    }
+  std::sort(by_date_.begin(), by_date_.end());
+}
+
+
+seq_set
+date_index::make_set(std::vector<entry>::const_iterator first,
+		     std::vector<entry>::const_iterator last) const
+{
+  seq_set result(highest_ / 64u + 1u, 0u);
+  for (; first != last; ++first)
+    result[first->second / 64u] |= std::uint64_t(1u) << (first->second % 64u);
+  return result;
+}
+
+
+seq_set
+date_index::later_than(const sccs_date& cutoff) const
+{
+  ASSERT(cutoff.valid());
+  const entry key(cutoff.packed(), std::numeric_limits<seq_no>::max());
+  return make_set(std::upper_bound(by_date_.begin(), by_date_.end(), key),
+		  by_date_.end());
+}
+
+
+seq_set
+date_index::earlier_than(const sccs_date& cutoff) const
+{
+  ASSERT(cutoff.valid());
+  const entry key(cutoff.packed(), 0);
+  return make_set(by_date_.begin(),
+		  std::lower_bound(by_date_.begin(), by_date_.end(), key));
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
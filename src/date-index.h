@@ -0,0 +1,69 @@
+/*
+ * date-index.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Defines the class date_index, which finds the deltas of a history
+ * file made before or after a given date.
+ *
+ */
+
+#ifndef CSSC__DATE_INDEX_H__
+#define CSSC__DATE_INDEX_H__
+
+#include <utility>
+#include <vector>
+
+#include "ancestry.h"		/* for seq_set */
+#include "delta.h"		/* for seq_no */
+
+class cssc_delta_table;
+class sccs_date;
+
+// A date_index holds the deltas of a delta table (removed ones too,
+// since prs can show those) sorted by date, using sccs_date::packed() as the key, so that finding the
+// deltas on either side of a cutoff date is a binary search.  Like
+// ancestry_index, it is correct for the deltas it knew about when it
+// was built, and highest_seqno() says which those were.
+class date_index
+{
+public:
+  explicit date_index(const cssc_delta_table&);
+
+  seq_no highest_seqno() const { return highest_; }
+
+  // The deltas whose date is later than cutoff.
+  seq_set later_than(const sccs_date& cutoff) const;
+
+  // The deltas whose date is earlier than cutoff.
+  seq_set earlier_than(const sccs_date& cutoff) const;
+
+private:
+  typedef std::pair<long long, seq_no> entry;
+
+  seq_set make_set(std::vector<entry>::const_iterator first,
+		   std::vector<entry>::const_iterator last) const;
+
+  seq_no highest_;
+  std::vector<entry> by_date_;
+};
+
+#endif /* CSSC__DATE_INDEX_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -107,6 +107,13 @@ const_delta_iterator::operator ->() const
   return &dtbl_->at(pos_);
 }
 
+const delta&
+const_delta_iterator::operator*() const
+{
+  ASSERT(nullptr != dtbl_);
+  return dtbl_->at(pos_);
+}
+
 
 
 /* Local variables: */
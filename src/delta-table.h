@@ -28,7 +28,6 @@
 
 #include <deque>
 #include <vector>
-#include <map>
 
 #include "delta.h"
 
@@ -37,7 +36,11 @@ class stl_delta_list
   seq_no high_seqno_;
   sid high_release_;
   std::vector<struct delta> items_;
-  std::map<seq_no, size_t> seq_table_;
+  // seq_table_[s] is one more than the position in items_ of the
+  // delta with serial number s, or zero if there is none.  Serial
+  // numbers are dense, so this is smaller and much faster than a map
+  // once there are many deltas.
+  std::vector<size_t> seq_table_;
 
 protected:
   void update_highest(const delta& d)
@@ -100,7 +103,9 @@ public:
   {
     size_t pos = items_.size();
     items_.push_back(d);
-    seq_table_[d.seq()] = pos;
+    if (d.seq() >= seq_table_.size())
+      seq_table_.resize(d.seq() + size_t(1), 0);
+    seq_table_[d.seq()] = pos + 1;
     update_highest(d);
   }
 
@@ -115,15 +120,13 @@ public:
 
   bool delta_at_seq_exists(seq_no seq) const
   {
-    std::map<seq_no, size_t>::const_iterator i = seq_table_.find(seq);
-    return i != seq_table_.end();
+    return seq < seq_table_.size() && seq_table_[seq] != 0;
   }
 
   const delta& delta_at_seq(seq_no seq) const
   {
-    std::map<seq_no, size_t>::const_iterator i = seq_table_.find(seq);
-    ASSERT (i != seq_table_.end());
-    return items_[i->second];
+    ASSERT (delta_at_seq_exists(seq));
+    return items_[seq_table_[seq] - 1];
   }
 };
 
@@ -27,7 +27,16 @@
 
 
 #include <config.h>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+#include <ctype.h>
+#include <unistd.h>
 
 #include "cssc.h"
 #include "delta.h"
@@ -38,9 +47,14 @@
 #include "version.h"
 #include "except.h"
 #include "ioerr.h"
+#include "sid_list.h"
 #include "file.h"
 #include "fileiter.h"
+#include "l-split.h"
+#include "quit.h"
+#include "sync-group.h"
 #include "cssc.h"
+#include "stats.h"
 
 
 
@@ -48,36 +62,335 @@
 void
 usage() {
 	fprintf(stderr,
-"usage: %s [-nsVp] [-m MRs] [-r SID] [-y comments] file ...\n",
+"usage: %s [-nsVpT] [-j jobs] [-m MRs] [-r SID] [-y comments] file ...\n",
 		prg_name);
 }
 
 #define EXITVAL_INVALID_OPTION (1)
 
+// What "get" would have reported for a file retrieved by "delta -T".
+struct retrieval
+{
+  std::string name;
+  sid id;
+  unsigned lines;
+};
+
+/* Replaces the working file GNAME, from which delta ID of FILE has
+ * just been made, with the read-only version that "get -t" would now
+ * retrieve (this is what "sccs delget" does).  Normally that is the
+ * new delta, whose text we already have in GNAME, so we don't need to
+ * read the history file again.
+ */
+static cssc::Failure
+get_new_version(sccs_file& file, sccs_name& name, const std::string& gname,
+		sid id, retrieval *done)
+{
+  sid top;
+  std::unique_ptr<sccs_file> reread;
+  if (!file.find_requested_sid(sid::null_sid(), top, true) || top != id)
+    {
+      // For example, the d flag names some other delta.
+      reread.reset(new sccs_file(name, READ));
+      if (!reread->find_requested_sid(sid::null_sid(), top, true))
+	{
+	  errormsg("%s: Requested SID not found.", name.c_str());
+	  return cssc::make_failure(cssc::errorcode::OperationFailed);
+	}
+    }
+
+  FILE *in = nullptr;
+  if (!reread)
+    {
+      in = fopen_as_real_user(gname.c_str(), "r");
+      if (nullptr == in)
+	return cssc::make_failure_builder_from_errno(errno)
+	  << "failed to open " << gname << " for reading";
+    }
+  ResourceCleanup in_closer([in](){ if (in) fclose(in); });
+
+  cssc::Failure unlinked = unlink_file_as_real_user(gname.c_str());
+  if (!unlinked.ok())
+    return cssc::make_failure_builder(unlinked)
+      << "Failed to remove file " << gname;
+
+  const bool executable = file.gfile_should_be_executable();
+  int mode = CREATE_AS_REAL_USER | CREATE_FOR_GET | CREATE_READ_ONLY;
+  if (executable)
+    mode |= CREATE_EXECUTABLE;
+  cssc::FailureOr<FILE*> fof = fcreate(gname, mode);
+  if (!fof.ok())
+    return fof.fail();
+  FILE *out = *fof;
+
+  cssc::FailureOr<get_status> gotten = reread
+    ? reread->get(out, gname, nullptr, top, sccs_date(), sid_list(),
+		  sid_list(), true, cssc::optional<std::string>(),
+		  false, false, false, false)
+    : file.get_checked_in(in, out, gname, top, true);
+  cssc::Failure f = fclose_failure(out);
+  if (gotten.ok())
+    f = Update(f, set_gfile_writable(gname, false, executable));
+  f = Update(gotten.ok() ? cssc::Failure::Ok() : gotten.fail(), f);
+  if (!f.ok())
+    {
+      remove(gname.c_str());
+      return f;
+    }
+  done->name = name.c_str();
+  done->id = top;
+  done->lines = (*gotten).lines;
+  return cssc::Failure::Ok();
+}
+
+// What each file needs from the command line.
+struct delta_request
+{
+  sid rid;
+  bool keep_gfile;		// -n
+  bool suppress_mrs;		// -m given with no argument
+  bool display_diff_output;	// -p
+  bool then_get;		// -T
+  std::vector<std::string> mr_list;
+  std::vector<std::string> comment_list;
+  sync_group *sync;		// null unless we are using several jobs
+
+  delta_request()
+    : rid(sid::null_sid()), keep_gfile(false), suppress_mrs(false),
+      display_diff_output(false), then_get(false),
+      mr_list(), comment_list(), sync(nullptr)
+  {
+  }
+};
+
+// If we still have to prompt for the MRs or comments, we do so once
+// we have opened the first history file (since that tells us whether
+// MRs are needed at all).
+struct delta_prompts
+{
+  std::string mrs;
+  std::string comments;
+  bool want_mrs;
+  bool want_comments;
+  bool done;
+};
+
+/* Makes the delta for one history file NAME, writing what delta
+ * reports about it to REPORT.  If FIRST is not null, it is used to
+ * prompt for whatever the command line did not give.  If the new version was retrieved
+ * (for -T), DONE describes that and *GOT is set.  Returns the exit
+ * value for this file.
+ */
+static int
+delta_file(delta_request& req, delta_prompts *first, sccs_name& name,
+	   FILE *report, retrieval *done, bool *got)
+{
+  int retval = 0;
+  *got = false;
+  try
+    {
+      sccs_file file(name, UPDATE);
+      file.set_sync_group(req.sync);
+
+      if (first)
+	{
+	  if (first->want_mrs && file.mr_required())
+	    first->mrs = prompt_user("MRs? ");
+	  if (first->want_comments)
+	    first->comments = prompt_user("comments? ");
+	  req.mr_list = split_mrs(first->mrs);
+	  req.comment_list = split_comments(first->comments);
+	  first->done = true;
+	}
+
+      std::string gname = name.gfile();
+      cssc::FailureOr<sid> added =
+	file.check_in(req.rid, gname, req.mr_list, req.suppress_mrs,
+		      req.comment_list, req.display_diff_output, report);
+      if (!added.ok())
+	{
+	  retval = 1;
+	  // if delta failed, don't delete the g-file.
+	}
+      else if (req.then_get)
+	{
+	  cssc::Failure gotten = get_new_version(file, name, gname,
+						 *added, done);
+	  if (gotten.ok())
+	    {
+	      *got = true;
+	    }
+	  else
+	    {
+	      if (!gotten.detail().empty())
+		errormsg("%s", gotten.to_string().c_str());
+	      retval = 1;
+	    }
+	}
+      else
+	{
+	  if (!req.keep_gfile)
+	    {
+	      /* SourceForge bug 489005: remove the g-file
+	       * as the real user if we are running setuid.
+	       */
+	      cssc::Failure unlinked = unlink_file_as_real_user(gname.c_str());
+	      if (!unlinked.ok())
+		{
+		  errormsg("Failed to remove file %s: %s",
+			   gname.c_str(), unlinked.to_string().c_str());
+		  retval = 1;
+		}
+	    }
+	}
+    }
+  catch (CsscExitvalException e)
+    {
+      if (e.exitval > retval)
+	retval = e.exitval;	// continue with next file.
+    }
+  return retval;
+}
+
+
+/* Makes the deltas for the files in NAMES using JOBS threads.  What
+ * is reported for each file is collected and printed in the order in
+ * which the files were named, as soon as all the files before it are
+ * done, so the output is the same as if we had done the files one at
+ * a time.  The new history files are synced in groups before they
+ * replace the old ones.
+ */
+static int
+delta_in_parallel(delta_request& req, const std::vector<std::string>& names,
+		  unsigned long jobs, std::vector<retrieval>& retrieved)
+{
+  struct outcome
+  {
+    outcome() : done(false), retval(0), got(false), gotten(),
+		report(), diagnostics() {}
+    bool done;
+    int retval;
+    bool got;
+    retrieval gotten;
+    std::string report;
+    std::string diagnostics;
+  };
+  std::vector<outcome> outcomes(names.size());
+  std::mutex mutex;
+  std::condition_variable finished;
+  size_t next = 0;
+
+  sync_group sync;
+  req.sync = &sync;
+
+  auto worker = [&]()
+    {
+      for (;;)
+	{
+	  size_t i;
+	  {
+	    std::lock_guard<std::mutex> lock(mutex);
+	    if (next >= names.size())
+	      return;
+	    i = next++;
+	  }
+
+	  outcome result;
+	  {
+	    error_context ctx(nullptr, &result.diagnostics);
+	    std::unique_ptr<FILE, int (*)(FILE*)> report(tmpfile(), fclose);
+	    if (!report)
+	      {
+		errormsg_with_errno("cannot create a temporary file");
+		result.retval = 1;
+	      }
+	    else
+	      {
+		sccs_name name;
+		name = names[i];
+		result.retval = delta_file(req, nullptr, name, report.get(),
+					   &result.gotten, &result.got);
+		rewind(report.get());
+		char buf[BUFSIZ];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof buf, report.get())) > 0)
+		  result.report.append(buf, n);
+	      }
+	  }
+
+	  std::lock_guard<std::mutex> lock(mutex);
+	  result.done = true;
+	  outcomes[i] = result;
+	  finished.notify_all();
+	}
+    };
+
+  std::vector<std::thread> threads;
+  for (unsigned long t = 0; t < jobs && t < names.size(); ++t)
+    threads.emplace_back(worker);
+
+  int retval = 0;
+  for (auto& o : outcomes)
+    {
+      outcome result;
+      {
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&o]() { return o.done; });
+	result = o;
+      }
+      fputs(result.report.c_str(), stdout);
+      fputs(result.diagnostics.c_str(), stderr);
+      if (result.got)
+	retrieved.push_back(result.gotten);
+      if (result.retval > retval)
+	retval = result.retval;
+    }
+
+  for (auto& t : threads)
+    t.join();
+  req.sync = nullptr;
+  return retval;
+}
+
+
+/* Several jobs may only be used by a programme which is not
+ * set-user-id or set-group-id, since the privileges it drops while
+ * working on a file belong to the whole process.
+ */
+static bool
+threads_allowed()
+{
+#if defined HAVE_GETEUID && defined HAVE_GETEGID
+  return getuid() == geteuid() && getgid() == getegid();
+#else
+  return true;
+#endif
+}
+
+
 static int
 delta_main(int argc, char **argv)
 {
   Cleaner arbitrary_name;
   int c;
-  sid rid(sid::null_sid());
+  delta_request req;
   int silent = 0;		/* -s */
-  int keep_gfile = 0;		/* -n */
   std::string mrs;		/* -m -M */
   std::string comments;		/* -y -Y */
-  int suppress_mrs = 0;		// if -m given with no arg.
   int got_mrs = 0;		// if no need to prompt for MRs.
   int suppress_comments = 0;	// if -y given with no arg.
   int got_comments = 0;
-  bool display_diff_output = false; // -p
+  unsigned long jobs = 1;	// -j
   if (argc > 0) {
     set_prg_name(argv[0]);
   } else {
     set_prg_name("delta");
   }
+  start_stats();
 
-  ASSERT(!rid.valid());
+  ASSERT(!req.rid.valid());
 
-  class CSSC_Options opts(argc, argv, "r!sng!m!y!pV", EXITVAL_INVALID_OPTION);
+  class CSSC_Options opts(argc, argv, "r!sng!m!y!pTj!V", EXITVAL_INVALID_OPTION);
   for(c = opts.next();
       c != CSSC_Options::END_OF_ARGUMENTS;
       c = opts.next()) {
@@ -87,8 +400,8 @@ delta_main(int argc, char **argv)
       return EXITVAL_INVALID_OPTION;
 
     case 'r':
-      rid = sid(opts.getarg());
-      if (!rid.valid()) {
+      req.rid = sid(opts.getarg());
+      if (!req.rid.valid()) {
 	errormsg("Invaild SID: '%s'", opts.getarg());
 	return EXITVAL_INVALID_OPTION;
       }
@@ -99,16 +412,20 @@ delta_main(int argc, char **argv)
       break;
 
     case 'n':
-      keep_gfile = 1;
+      req.keep_gfile = true;
       break;
 
     case 'p':
-      display_diff_output = true;
+      req.display_diff_output = true;
+      break;
+
+    case 'T':
+      req.then_get = true;
       break;
 
     case 'm':
       mrs = opts.getarg();
-      suppress_mrs = (mrs == "");
+      req.suppress_mrs = (mrs == "");
       got_mrs = 1;
       break;
 
@@ -118,6 +435,19 @@ delta_main(int argc, char **argv)
       got_comments = 1;
       break;
 
+    case 'j':
+      {
+	char *end;
+	errno = 0;
+	jobs = strtoul(opts.getarg(), &end, 10);
+	if (errno || *end || jobs < 1 || !isdigit((unsigned char)*opts.getarg()))
+	  {
+	    errormsg("Invalid number of jobs: '%s'", opts.getarg());
+	    return EXITVAL_INVALID_OPTION;
+	  }
+      }
+      break;
+
     case 'V':
       version();
       break;
@@ -139,149 +469,82 @@ delta_main(int argc, char **argv)
 	}
     }
 
-  std::vector<std::string> comment_list;
-  std::vector<std::string> mr_list;
-  int first = 1;
+  delta_prompts prompts;
+  prompts.mrs = mrs;
+  prompts.comments = comments;
+  prompts.want_mrs = !req.suppress_mrs && !got_mrs;
+  prompts.want_comments = !suppress_comments && !got_comments;
+  prompts.done = false;
+  delta_prompts *first = &prompts;
+  if (!prompts.want_mrs && !prompts.want_comments)
+    {
+      req.mr_list = split_mrs(mrs);
+      req.comment_list = split_comments(comments);
+      first = nullptr;
+    }
+
+  // The output of diff for -p goes straight to stdout, so it is
+  // only tidy if we do one file at a time.
+  if (req.display_diff_output || !threads_allowed())
+    jobs = 1;
 
+  std::vector<retrieval> retrieved;
   int retval = 0;
 
-  while (iter.next())
+  if (jobs > 1)
     {
-      try
+      std::vector<std::string> names;
+      while (iter.next())
+	names.push_back(iter.get_name().sfile());
+
+      // Any prompt is issued for the first file we can open, so we
+      // do the files up to that one before starting the others.
+      size_t start = 0;
+      while (first && start < names.size())
 	{
-	  bool failed = false;
-	  sccs_name &name = iter.get_name();
-	  sccs_file file(name, UPDATE);
-	  sccs_pfile pfile(name, sccs_pfile::pfile_mode::PFILE_UPDATE);
-
-	  if (first)
-	    {
-	      if (!suppress_mrs && !got_mrs && file.mr_required())
-		{
-		  mrs = prompt_user("MRs? ");
-		  got_mrs = 1;
-		}
-	      if (!suppress_comments && !got_comments)
-		{
-		  comments = prompt_user("comments? ");
-		  got_comments = 1;
-		}
-	      mr_list = split_mrs(mrs);
-	      comment_list = split_comments(comments);
-	      first = 0;
-	    }
-
-	  const std::pair<sccs_pfile::find_status, sccs_pfile::iterator> found(pfile.find_sid(rid));
-	  switch (found.first) {
-	  case sccs_pfile::find_status::FOUND:
-	    break;
-
-	  case sccs_pfile::find_status::NOT_FOUND:
-	    if (!rid.valid())
-	      {
-		errormsg("%s: You have no edits outstanding.",
-			 name.c_str());
-	      }
-	    else
-	      {
-		errormsg("%s: Specified SID hasn't been locked for"
-			 " editing by you.",
-			 name.c_str());
-	      }
-	    failed = true;
-	    retval = EXITVAL_INVALID_OPTION;
-	    break;
-
-	  case sccs_pfile::find_status::AMBIGUOUS:
-	    if (rid.valid())
-	      {
-		errormsg("%s: Specified SID is ambiguous.",
-			 name.c_str());
-	      }
-	    else
-	      {
-		errormsg("%s: You must specify a SID on the"
-			 " command line.", name.c_str());
-	      }
-	    failed = true;
-	    retval = EXITVAL_INVALID_OPTION;
-	    break;
-
-	  default:
-	    abort();
-	  }
-
-	  if (!failed)
-	    {
-	      if (!suppress_mrs && file.mr_required())
-		{
-		  if (mr_list.empty())
-		    {
-		      errormsg("%s: MR number(s) must be supplied.",
-			       name.c_str());
-		      retval = 1;
-		      continue;
-		    }
-		  if (file.check_mrs(mr_list))
-		    {
-		      /* In this case, _real_ SCCS prints the ID anyway.
-		       */
-		      found.second->delta.print(stdout);
-		      putchar('\n');
-		      errormsg("%s: Invalid MR number(s).",
-			       name.c_str());
-		      retval = 1;
-		      continue;
-		    }
-		}
-	      else if (!mr_list.empty())
-		{
-		  // MRs were specified and the MR flag is turned off.
-		  found.second->delta.print(stdout);
-		  putchar('\n');
-		  errormsg("%s: MR verification ('v') flag not set, MRs"
-			   " are not allowed.\n",
-			   name.c_str());
-		  retval = 1;
-		  continue;
-		}
-
-	      std::string gname = name.gfile();
-
-	      // The check that authorised() makes cannot fail, since it
-	      // is a lookup on an in-memory data structure.  It
-	      // issues its own error message.
-	      if (!file.authorised() || !file.add_delta(gname, pfile, found.second,
-							mr_list, comment_list,
-							display_diff_output))
-		{
-		  retval = 1;
-		  // if delta failed, don't delete the g-file.
-		}
-	      else
-		{
-		  if (!keep_gfile)
-		    {
-		      /* SourceForge bug 489005: remove the g-file
-		       * as the real user if we are running setuid.
-		       */
-		      cssc::Failure unlinked = unlink_file_as_real_user(gname.c_str());
-		      if (!unlinked.ok())
-			{
-			  errormsg("Failed to remove file %s: %s",
-				   gname.c_str(), unlinked.to_string().c_str());
-			  retval = 1;
-			}
-		    }
-		}
-	    }
+	  sccs_name name;
+	  name = names[start++];
+	  retrieval done;
+	  bool got;
+	  const int file_retval = delta_file(req, first, name, stdout,
+					     &done, &got);
+	  if (first->done)
+	    first = nullptr;
+	  if (got)
+	    retrieved.push_back(done);
+	  if (file_retval > retval)
+	    retval = file_retval;
 	}
-      catch (CsscExitvalException e)
+      std::vector<std::string> rest(names.begin() + start, names.end());
+      const int rest_retval = delta_in_parallel(req, rest, jobs, retrieved);
+      if (rest_retval > retval)
+	retval = rest_retval;
+    }
+  else
+    {
+      while (iter.next())
 	{
-	  if (e.exitval > retval)
-	    retval = e.exitval;	// continue with next file.
+	  retrieval done;
+	  bool got;
+	  const int file_retval = delta_file(req, first, iter.get_name(),
+					     stdout, &done, &got);
+	  if (first && first->done)
+	    first = nullptr;
+	  if (got)
+	    retrieved.push_back(done);
+	  if (file_retval > retval)
+	    retval = file_retval;
 	}
     }
+
+  // Report the retrievals as get would have, after the deltas.
+  for (const auto& done : retrieved)
+    {
+      if (!iter.unique())
+	printf("\n%s:\n", done.name.c_str());
+      done.id.print(stdout);
+      printf("\n%u lines\n", done.lines);
+    }
   return retval;
 }
 
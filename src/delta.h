@@ -33,7 +33,13 @@
 #include "sid.h"
 #include "sccsdate.h"
 
-typedef unsigned short seq_no;
+// Serial numbers.  SCCS does not allow them to go beyond
+// classic_max_seq_no; CSSC reads files whose serial numbers go up to
+// max_seq_no, but only creates deltas beyond the classic limit if
+// extended_seqno_allowed() (see environment.cc).
+typedef unsigned int seq_no;
+const seq_no classic_max_seq_no = 65535u;
+const seq_no max_seq_no = 4294967295u;
 
 class delta
 {
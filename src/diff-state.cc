@@ -273,16 +273,16 @@ diff_state::process(FILE *out, seq_no seq)
         {
           if (state_ == diffstate::DELETE || state_ == diffstate::INSERT)
             {
-              fprintf(out, "\001E %d\n", seq);
+              fprintf(out, "\001E %u\n", seq);
             }
           next_state();
           if (state_ == diffstate::INSERT)
             {
-              fprintf(out, "\001I %d\n", seq);
+              fprintf(out, "\001I %u\n", seq);
             }
           else if (state_ == diffstate::DELETE)
             {
-              fprintf(out, "\001D %d\n", seq);
+              fprintf(out, "\001D %u\n", seq);
             }
         }
       lines_left_--;
@@ -25,6 +25,7 @@
  */
 #include "config.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
@@ -33,13 +34,16 @@
 
 #include "cssc.h"
 
-bool binary_file_creation_allowed (void)
+/* Returns the setting of the environment variable VAR, which may be
+ * "enabled" or "disabled", or DFLT if it is unset.
+ */
+static bool
+env_flag(const char *var, bool dflt)
 {
-  static const char * const bin_var = "CSSC_BINARY_SUPPORT";
   static const char * const enabled = "enabled";
   static const char * const disabled = "disabled";
 
-  const char *p = getenv(bin_var);
+  const char *p = getenv(var);
 
   if (p)
     {
@@ -60,20 +64,31 @@ bool binary_file_creation_allowed (void)
 	  fprintf(stderr,
 		  "Error: The %s environment variable, if set, must be set "
 		  "to either '%s' or '%s'.\n",
-		  bin_var,
+		  var,
 		  enabled,
 		  disabled);
 	  exit(1);
 	}
     }
-  else
-    {
+  return dflt;
+}
+
+
+bool binary_file_creation_allowed (void)
+{
 #ifdef CONFIG_DISABLE_BINARY_SUPPORT
-      return false;
+  return env_flag("CSSC_BINARY_SUPPORT", false);
 #else
-      return true;
+  return env_flag("CSSC_BINARY_SUPPORT", true);
 #endif
-    }
+}
+
+
+bool extended_seqno_allowed (void)
+{
+  // Other implementations of SCCS cannot read files with serial
+  // numbers beyond 65535, so we only create them if asked to.
+  return env_flag("CSSC_EXTENDED_SEQNO", false);
 }
 
 
@@ -112,8 +127,64 @@ long max_sfile_line_len(void)
 }
 
 
+long lock_wait_timeout(void)
+{
+  static const char * const timeout_var = "CSSC_LOCK_TIMEOUT";
+  const char *p = getenv(timeout_var);
+
+  if (p)
+    {
+      char *endptr;
+      errno = 0;
+      const long secs = strtol(p, &endptr, 10);
+      if ( (endptr == p) || *endptr || (0 != errno) || secs < 0)
+	{
+	  fprintf(stderr,
+		  "Error: Environment variable '%s' is set to '%s', but "
+		  "should be either a number of seconds or unset.\n",
+		  timeout_var,
+		  p);
+	  exit(1);
+	}
+      // A longer wait than this is as good as forever, and we must
+      // be able to add the timeout to the clock without overflow.
+      const long max_secs = 366L * 24L * 60L * 60L;
+      return std::min(secs, max_secs);
+    }
+  else
+    {
+      // Wait for as long as it takes, as SCCS does.
+      return -1;
+    }
+}
+
+
+bool lock_stats_wanted (void)
+{
+  return env_flag("CSSC_LOCK_STATS", false);
+}
+
+
+bool stats_wanted (void)
+{
+  return env_flag("CSSC_STATS", false);
+}
+
+
+const char *stats_file (void)
+{
+  // If this is unset (or empty) the statistics go to stderr.
+  const char *p = getenv("CSSC_STATS_FILE");
+  return (p && *p) ? p : nullptr;
+}
+
+
 void check_env_vars(void)
 {
   (void) binary_file_creation_allowed();
   (void) max_sfile_line_len();
+  (void) extended_seqno_allowed();
+  (void) lock_wait_timeout();
+  (void) lock_stats_wanted();
+  (void) stats_wanted();
 }
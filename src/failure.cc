@@ -68,6 +68,18 @@ namespace cssc
 	return "the selected revision cannot be removed as it is referred to by another delta in the history file";
       case isit(errorcode::HistoryFileCorrupt):
 	return "format/parsing error in history file";
+      case isit(errorcode::EditNotLocked):
+	return "the selected revision has not been locked for editing";
+      case isit(errorcode::EditLockAmbiguous):
+	return "more than one revision is locked for editing, so the revision must be specified";
+      case isit(errorcode::InvalidMRList):
+	return "the modification request (MR) numbers are missing, invalid or not permitted";
+      case isit(errorcode::UserNotAuthorised):
+	return "the user is not in the list of users authorised to make deltas";
+      case isit(errorcode::OperationFailed):
+	return "the operation on the history file failed";
+      case isit(errorcode::LockWaitTimedOut):
+	return "timed out waiting for the lock on the SCCS file";
       default:
 	return "unknown CSSC error";
       }
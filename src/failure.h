@@ -67,6 +67,12 @@ namespace cssc
       UsagePreconditionFailureDeltaHasSuccessor,
       UsagePreconditionFailureDeltaInUse,
       HistoryFileCorrupt,
+      EditNotLocked,
+      EditLockAmbiguous,
+      InvalidMRList,
+      UserNotAuthorised,
+      OperationFailed,
+      LockWaitTimedOut,
     };
 
   // condition is for storing in std::error_condition
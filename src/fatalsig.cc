@@ -143,3 +143,12 @@ void quit_on_fatal_signals (void)
 
   already_called = 1;
 }
+
+void block_fatal_signals (sigset_t *saved)
+{
+  sigset_t blocked;
+  sigemptyset(&blocked);
+  for (int sig : fatal_signals_to_trap)
+    sigaddset(&blocked, sig);
+  pthread_sigmask(SIG_BLOCK, &blocked, saved);
+}
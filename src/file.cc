@@ -26,15 +26,27 @@
  */
 #include "config.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <cstdio>
 #include <stdlib.h>
+#ifdef HAVE_SYS_VFS_H
+#include <sys/vfs.h>
+#endif
+#ifdef HAVE_SYS_MOUNT_H
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
 
 #include "cssc.h"		/* for CONFIG_CAN_HARD_LINK_AN_OPEN_FILE */
 #include "cssc-assert.h"
@@ -172,13 +184,19 @@ file_exists(const char *name) {
 const char *
 get_user_name()
 {
-  struct passwd *p = getpwuid(getuid());
-  if (nullptr == p)
+  // The real user ID never changes, so look it up only once (which
+  // also means that threads do not share the result of getpwuid()).
+  static const std::string name = []() -> std::string
     {
-      fatal_quit(-1, "UID %s not found in password file.",
-		 cssc::stringify(getuid()).c_str());
-    }
-  return p->pw_name;
+      struct passwd *p = getpwuid(getuid());
+      if (nullptr == p)
+	{
+	  fatal_quit(-1, "UID %s not found in password file.",
+		     cssc::stringify(getuid()).c_str());
+	}
+      return p->pw_name;
+    }();
+  return name.c_str();
 }
 
 bool
@@ -290,7 +308,158 @@ maybe_wait_a_bit(long attempt, const char *lockfile)
 }
 
 
-static FailureOr<int> atomic_nfs_create(const std::string& path, int flags, int perms)
+/* Totals over all the locks this process has asked for, in any
+ * thread.
+ */
+static lock_wait_stats lock_totals;
+static std::mutex lock_totals_mutex;
+
+lock_wait_stats
+get_lock_wait_stats()
+{
+  std::lock_guard<std::mutex> guard(lock_totals_mutex);
+  return lock_totals;
+}
+
+
+namespace
+{
+  /* A lock_waiter decides how long to wait before each further
+   * attempt to take a lock, and counts what the waiting cost.  If
+   * CSSC_LOCK_TIMEOUT is unset we wait as SCCS does, indefinitely.
+   * Otherwise each wait is about twice as long as the last, from
+   * 10ms up to a second, less a random amount so that processes
+   * waiting for the same lock do not retry in step, and we give up
+   * once the timeout has passed.
+   */
+  class lock_waiter
+  {
+  public:
+    explicit lock_waiter(const std::string& lockfile)
+      : lockfile_(lockfile),
+	timeout_(lock_wait_timeout()),
+	report_(lock_stats_wanted()),
+	start_(std::chrono::steady_clock::now()),
+	retries_(0uL),
+	delay_(std::chrono::milliseconds(10)),
+	random_(static_cast<std::minstd_rand::result_type>
+		(getpid() ^ start_.time_since_epoch().count()))
+    {
+    }
+
+    /* Waits before another attempt; returns false if the timeout has
+     * passed.
+     */
+    bool wait()
+    {
+      if (timeout_ < 0)
+	{
+	  maybe_wait_a_bit(static_cast<long>(retries_++), lockfile_.c_str());
+	  return true;
+	}
+      const auto deadline = start_ + std::chrono::seconds(timeout_);
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+	return false;
+      ++retries_;
+
+      std::uniform_int_distribution<std::chrono::microseconds::rep>
+	jitter(delay_.count() / 2, delay_.count());
+      auto pause = std::chrono::microseconds(jitter(random_));
+      const auto remaining =
+	std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+      if (pause > remaining)
+	pause = remaining;
+      std::this_thread::sleep_for(pause);
+
+      delay_ = std::min<std::chrono::microseconds>(2 * delay_,
+						   std::chrono::seconds(1));
+      return true;
+    }
+
+    /* Adds this attempt to the totals, and reports it if the user
+     * asked for that.
+     */
+    void finish(bool acquired)
+    {
+      const std::chrono::duration<double> waited =
+	std::chrono::steady_clock::now() - start_;
+      {
+	std::lock_guard<std::mutex> guard(lock_totals_mutex);
+	if (acquired)
+	  ++lock_totals.locks;
+	else
+	  ++lock_totals.failures;
+	lock_totals.retries += retries_;
+	lock_totals.seconds += waited.count();
+      }
+
+      if (report_)
+	{
+	  errormsg("%s: lock %s after %lu retr%s in %.3f seconds",
+		   lockfile_.c_str(),
+		   acquired ? "acquired" : "not acquired",
+		   retries_,
+		   (retries_ == 1 ? "y" : "ies"),
+		   waited.count());
+	}
+    }
+
+  private:
+    const std::string lockfile_;
+    const long timeout_;
+    const bool report_;
+    const std::chrono::steady_clock::time_point start_;
+    unsigned long retries_;
+    std::chrono::microseconds delay_;
+    std::minstd_rand random_;
+  };
+}
+
+
+/* Returns true if the directory |dirname| is on a file system which
+ * we know is local, so that open(2) with O_EXCL is atomic.  When we
+ * cannot tell, we say no.
+ */
+static bool
+exclusive_open_is_reliable(const std::string& dirname)
+{
+#if defined HAVE_STATFS && defined __linux__
+  struct statfs fs;
+  if (0 != statfs(dirname.empty() ? "." : dirname.c_str(), &fs))
+    return false;
+  switch (static_cast<unsigned long>(fs.f_type) & 0xFFFFFFFFuL)
+    {
+    case 0xEF53uL:		// ext2, ext3, ext4
+    case 0x58465342uL:		// xfs
+    case 0x9123683EuL:		// btrfs
+    case 0x01021994uL:		// tmpfs
+    case 0x858458F6uL:		// ramfs
+    case 0x2FC12FC1uL:		// zfs
+    case 0xF2F52010uL:		// f2fs
+    case 0x52654973uL:		// reiserfs
+    case 0x3153464AuL:		// jfs
+    case 0xCA451A4EuL:		// bcachefs
+    case 0x794C7630uL:		// overlayfs
+      return true;
+    default:
+      return false;
+    }
+#elif defined HAVE_STATFS && defined MNT_LOCAL
+  struct statfs fs;
+  if (0 != statfs(dirname.empty() ? "." : dirname.c_str(), &fs))
+    return false;
+  return 0 != (fs.f_flags & MNT_LOCAL);
+#else
+  (void) dirname;
+  return false;
+#endif
+}
+
+
+static FailureOr<int>
+try_atomic_nfs_create(const std::string& path, int flags, int perms,
+		      lock_waiter& waiter)
 {
   auto fallback = [&path, flags, perms]() -> cssc::FailureOr<int>
     {
@@ -309,6 +478,26 @@ static FailureOr<int> atomic_nfs_create(const std::string& path, int flags, int
   std::string dirname, basename;
   split_filename(path, dirname, basename);
 
+  /* On a local file system, O_EXCL does all we need, and we need not
+   * share the nfslck* files below with processes locking other files
+   * in the same directory.
+   */
+  if (exclusive_open_is_reliable(dirname))
+    {
+      for (long attempt=0; attempt < 10000; ++attempt)
+	{
+	  int fd = open(path.c_str(), flags, perms);
+	  if (fd >= 0)
+	    return fd;
+	  if (EEXIST != errno)
+	    return cssc::make_failure_from_errno(errno);
+	  /* The z.* file exists; wait a bit. */
+	  if (!waiter.wait())
+	    return cssc::make_failure(cssc::errorcode::LockWaitTimedOut);
+	}
+      return cssc::make_failure_from_errno(EEXIST);
+    }
+
   /* Rely (slightly) on only 11 characters of filename. */
   for (long attempt=0; attempt < 10000; ++attempt)
     {
@@ -359,7 +548,11 @@ static FailureOr<int> atomic_nfs_create(const std::string& path, int flags, int
                   else
 		    {
                       /* The z.* file exists; wait a bit. */
-                      maybe_wait_a_bit(attempt, path.c_str());
+                      if (!waiter.wait())
+			{
+			  return cssc::make_failure
+			    (cssc::errorcode::LockWaitTimedOut);
+			}
 		    }
                 }
             }
@@ -378,7 +571,8 @@ static FailureOr<int> atomic_nfs_create(const std::string& path, int flags, int
                * Try again.  Sleep first if we're not doing well,
                * but try to avoid pathalogical cases...
                */
-              maybe_wait_a_bit(attempt, path.c_str());
+              if (!waiter.wait())
+		return cssc::make_failure(cssc::errorcode::LockWaitTimedOut);
               break;
 
             default:            /* hard failure. */
@@ -386,7 +580,17 @@ static FailureOr<int> atomic_nfs_create(const std::string& path, int flags, int
             }
         }
     }
-  return -1;
+  return cssc::make_failure_from_errno(EEXIST);
+}
+
+
+static FailureOr<int>
+atomic_nfs_create(const std::string& path, int flags, int perms)
+{
+  lock_waiter waiter(path);
+  FailureOr<int> result = try_atomic_nfs_create(path, flags, perms, waiter);
+  waiter.finish(result.ok());
+  return result;
 }
 
 
@@ -652,13 +856,6 @@ file_lock::file_lock(const std::string& zname)
     fcreate(zname, CREATE_READ_ONLY | CREATE_EXCLUSIVE | CREATE_NFS_ATOMIC);
   if (!fof.ok())
     {
-      // XXX: do not assume errno has been preserved.
-      if (errno == EEXIST)
-        {
-	  ASSERT(lock_state_.has_value());
-	  ASSERT(lock_state_.value().ok());
-          return;
-        }
       lock_state_ =
 	(cssc::FailureBuilder(fof.fail())
 	 .diagnose() << "can't create lock file " <<  zname);
@@ -682,13 +879,18 @@ file_lock::file_lock(const std::string& zname)
   return;
 }
 
-file_lock::~file_lock() {
+void
+file_lock::release() {
   if (lock_state_.has_value()) {
     lock_state_.reset();
     unlink(name_.c_str());
   }
 }
 
+file_lock::~file_lock() {
+  release();
+}
+
 
 
 cssc::FailureOr<bool>
@@ -65,6 +65,19 @@ void split_filename(const std::string& fullname,
 		    std::string& dirname,
 		    std::string& basename);
 
+// What waiting for locks on history files has cost this process so
+// far: how many locks we took, how many we gave up on (because
+// CSSC_LOCK_TIMEOUT passed), how many times we waited and for how
+// long in all.
+struct lock_wait_stats
+{
+  unsigned long locks;
+  unsigned long failures;
+  unsigned long retries;
+  double seconds;
+};
+lock_wait_stats get_lock_wait_stats();
+
 
 #ifdef CONFIG_SYNC_BEFORE_REOPEN
 int ffsync(FILE *f);
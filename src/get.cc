@@ -45,31 +45,11 @@
 #include "file.h"
 #include "privs.h"
 #include "subst-parms.h"
+#include "stats.h"
 
 #include <limits.h>
 
 
-/* Prints a list of included or excluded SIDs. */
-
-static cssc::Failure
-print_id_list(FILE *fp, const char *s, std::vector<sid> const &list)
-{
-  cssc::Failure status;
-  if (!list.empty())
-    {
-      if (fprintf_failed(fprintf(fp, "%s:\n", s)))
-	status = cssc::Update(status, cssc::make_failure_from_errno(errno));
-
-      for (const auto& sid : list)
-        {
-	  status = cssc::Update(status, sid.print(fp));
-          if (fputc_failed(fputc('\n', fp)))
-	    status = cssc::Update(status, cssc::make_failure_from_errno(errno));
-        }
-    }
-  return status;
-}
-
 void
 usage() {
         fprintf(stderr,
@@ -124,6 +104,7 @@ main(int argc, char **argv)
       set_prg_name(argv[0]);
   else
     set_prg_name("get");
+  start_stats();
 
   ASSERT(!rid.valid());
   ASSERT(!org_rid.valid());
@@ -258,9 +239,8 @@ main(int argc, char **argv)
 
         case 'a':
           {
-            int i;
-            i = atoi(opts.getarg());
-            if (i < 1 || i > USHRT_MAX)
+            const long long i = atoll(opts.getarg());
+            if (i < 1 || i > max_seq_no)
               {
                 errormsg("Invalid sequence number: '%s'", opts.getarg());
                 return 2;
@@ -593,171 +573,6 @@ main(int argc, char **argv)
   return retval;
 }
 
-/* Output the specified version to a file with possible modifications.
-   Most of the actual work is done with a seqstate object that
-   figures out whether or not given line of the SCCS file body
-   should be included in the output file. */
-cssc::FailureOr<get_status>
-sccs_file::get(FILE *out, const std::string& gname,
-	       FILE *summary_file,
-	       sid id, sccs_date cutoff_date,
-               sid_list include, sid_list exclude,
-               bool keywords, cssc::optional<std::string> wstring,
-               bool show_sid, bool show_module, bool debug,
-	       bool for_edit)
-{
-  ASSERT(nullptr != delta_table_);
-
-  seq_state state(highest_delta_seqno());
-  const delta *d = find_delta(id);
-  ASSERT(d != NULL);
-
-  ASSERT(nullptr != delta_table_);
-
-  cssc::Failure edit_allowed = edit_mode_permitted(for_edit);
-  if (!edit_allowed.ok())	// "get -e" on BK files is not allowed
-    return edit_allowed;
-
-  prepare_seqstate(state, d->seq(), include, exclude, cutoff_date);
-
-  // Fix by Mark Fortescue.
-  // Fix Cutoff Date Problem
-  const delta *dparm;
-  bool set=false;
-
-  for (seq_no s = d->seq(); s>0; s--)
-    {
-      if (delta_table_->delta_at_seq_exists(s))
-	{
-	    const struct delta & del = delta_table_->delta_at_seq(s);
-
-	    if (!state.is_excluded(s) && !set)
-	      {
-		dparm = find_delta(del.id());
-		set = true;
-	      }
-	}
-    }
-  if ( !set ) dparm = d;
-  // End of fix
-
-  if (getenv("CSSC_SHOW_SEQSTATE"))
-    {
-      for (seq_no s = d->seq(); s>0; s--)
-        {
-          if (!delta_table_->delta_at_seq_exists(s))
-            {
-              /* skip non-existent seq number */
-              continue;
-            }
-
-          fprintf(stderr, "%4d (", s);
-          delta_table_->delta_at_seq(s).id().dprint(stderr);
-          fprintf(stderr, ") ");
-
-          if (state.is_explicitly_tagged(s))
-            {
-              fprintf(stderr, "explicitly ");
-            }
-
-          if (state.is_ignored(s))
-            {
-              fprintf(stderr, "ignored\n");
-            }
-          else if (state.is_included(s))
-            {
-              fprintf(stderr, "included\n");
-            }
-          else if (state.is_excluded(s))
-            {
-              fprintf(stderr, "excluded");
-            }
-          else
-            {
-              fprintf(stderr, "irrelevant\n");
-            }
-        }
-    }
-
-  if (summary_file)
-    {
-      bool first = true;
-
-      for (seq_no s = d->seq(); s>0; s--)
-        {
-          if (delta_table_->delta_at_seq_exists(s)
-	      && state.is_included(s))
-	    {
-	      const struct delta & it = delta_table_->delta_at_seq(s);
-
-	      fprintf (summary_file, "%s    ",
-		       first ? "" : "\n");
-	      first = false;
-	      it.id().print(summary_file);
-	      fprintf (summary_file, "\t");
-	      it.date().print(summary_file);
-	      fprintf (summary_file, " %s\n", it.user().c_str());
-
-	      for (const std::string& comment : it.comments())
-		{
-		  fprintf (summary_file, "\t%s\n", comment.c_str());
-		}
-	    }
-	}
-      fputc ('\n', summary_file);
-    }
-
-
-
-  // The subst_parms here may not be the Whole Truth since
-  // the cutoff date may affect which version is actually
-  // gotten.  That's taken care of; the correct delta is
-  // passed as a parameter to the substitution function.
-  // (eugh...)
-  // Changed to use dparm not d to deal with Cutoff Date (Mark Fortescue)
-  struct subst_parms parms(gname, get_module_name(),
-			   out, wstring, *dparm,
-                           0, sccs_date::now());
-
-
-  cssc::Failure got = do_get(gname, state, parms, keywords, show_sid, show_module, debug,
-			     false, false);
-  if (!got.ok())
-    {
-      // TODO: verify whether or not we need to delete the g-file.
-      return got;
-    }
-
-  // only issue a warning about there being no keywords
-  // substituted, IF keyword substitution was being done.
-  if (keywords && !parms.found_id)
-    {
-      no_id_keywords(name_.c_str());
-      // this function normally returns.
-    }
-
-  /* Set the return status. */
-  struct get_status goodstatus;
-  goodstatus.lines = parms.out_lineno;
-
-  seq_no seq;
-  for(seq = 1; seq <= highest_delta_seqno(); seq++)
-    {
-      if (state.is_explicitly_tagged(seq))
-        {
-          const sid id_of_this_seq = seq_to_sid(seq);
-
-          if (state.is_included(seq))
-            goodstatus.included.push_back(id_of_this_seq);
-          else if (state.is_excluded(seq))
-            goodstatus.excluded.push_back(id_of_this_seq);
-        }
-    }
-  return goodstatus;
-}
-
-
-
 /* Local variables: */
 /* mode: c++ */
 /* End: */
@@ -0,0 +1,425 @@
+/*
+ * libcssc.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Implementation of the in-process interface declared in libcssc.h.
+ *
+ */
+#include "config.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cssc.h"
+#include "libcssc.h"
+#include "delta.h"
+#include "delta-iterator.h"
+#include "delta-table.h"
+#include "except.h"
+#include "file.h"
+#include "ioerr.h"
+#include "quit.h"
+#include "sccsfile.h"
+#include "sccsname.h"
+
+namespace cssc
+{
+  struct history_file::impl
+  {
+    sccs_file_open_mode mode;
+    sccs_name name;
+    std::string sfile;
+    std::unique_ptr<sccs_file> file;
+    std::vector<delta_info> deltas;
+    std::string diagnostics;
+
+    explicit impl(sccs_file_open_mode m)
+      : mode(m), name(), sfile(), file(), deltas(), diagnostics()
+    {
+    }
+  };
+
+  namespace
+  {
+    // Runs FN, converting any exception thrown by the lower layers
+    // (which is how they report a corrupt file, for example) into a
+    // Failure.  The message itself will already have been captured
+    // in DIAGNOSTICS by an error_context.
+    template <class Result, class Fn>
+    Result
+    guarded(const std::string& diagnostics, Fn fn)
+    {
+      try
+	{
+	  return fn();
+	}
+      catch (const CsscSfileCorruptException&)
+	{
+	  return make_failure(errorcode::HistoryFileCorrupt, diagnostics);
+	}
+      catch (const CsscExitvalException&)
+	{
+	  return make_failure(errorcode::OperationFailed, diagnostics);
+	}
+    }
+
+    // Adds the captured diagnostics to a failure which lacks detail.
+    Failure
+    with_diagnostics(const Failure& f, const std::string& diagnostics)
+    {
+      if (f.ok() || !f.detail().empty() || diagnostics.empty())
+	return f;
+      return Failure(f.code(), diagnostics);
+    }
+
+    delta_info
+    describe(const delta& d)
+    {
+      delta_info info;
+      info.type = d.get_type();
+      info.sid = d.id().as_string();
+      info.date = d.date().as_string();
+      info.user = d.user();
+      info.seq = d.seq();
+      info.prev_seq = d.prev_seq();
+      info.inserted = d.inserted();
+      info.deleted = d.deleted();
+      info.unchanged = d.unchanged();
+      info.mrs = d.mrs();
+      info.comments = d.comments();
+      return info;
+    }
+
+    void
+    to_strings(const std::vector<sid>& sids, std::vector<std::string> *out)
+    {
+      for (const auto& s : sids)
+	out->push_back(s.as_string());
+    }
+
+    // A FILE* through which sccs_file::get can deliver the body to a
+    // body_sink.
+    class sink_stream
+    {
+    public:
+      explicit sink_stream(const body_sink& sink)
+	: sink_(sink), status_(), f_(nullptr)
+      {
+      }
+
+      ~sink_stream()
+      {
+	if (f_)
+	  fclose(f_);
+      }
+
+      FailureOr<FILE*> open()
+      {
+#ifdef HAVE_FOPENCOOKIE
+	cookie_io_functions_t functions = { nullptr, &sink_stream::write,
+					    nullptr, nullptr };
+	f_ = fopencookie(this, "w", functions);
+#else
+	// Without fopencookie, we collect the body in a temporary
+	// file and pass it on when the retrieval is complete.
+	f_ = tmpfile();
+#endif
+	if (nullptr == f_)
+	  return make_failure_builder_from_errno(errno)
+	    << "failed to create an output stream";
+	return f_;
+      }
+
+      // Delivers any remaining output to the sink, and closes the
+      // stream.
+      Failure finish()
+      {
+	Failure result;
+#ifndef HAVE_FOPENCOOKIE
+	if (fflush_failed(fflush(f_)))
+	  result = make_failure_from_errno(errno);
+	rewind(f_);
+	char buf[8192];
+	size_t n;
+	while (result.ok() && (n = fread(buf, 1, sizeof(buf), f_)) > 0)
+	  result = sink_(buf, n);
+	if (result.ok() && ferror(f_))
+	  result = make_failure_from_errno(errno);
+#endif
+	FILE *f = f_;
+	f_ = nullptr;
+	if (fclose_failed(fclose(f)) && result.ok())
+	  result = status_.ok() ? make_failure_from_errno(errno) : status_;
+	return Update(status_, result);
+      }
+
+    private:
+#ifdef HAVE_FOPENCOOKIE
+      static ssize_t write(void *cookie, const char *buf, size_t size)
+      {
+	sink_stream *self = static_cast<sink_stream*>(cookie);
+	if (!self->status_.ok())
+	  return -1;
+	self->status_ = self->sink_(buf, size);
+	if (!self->status_.ok())
+	  return -1;
+	return static_cast<ssize_t>(size);
+      }
+#endif
+
+      const body_sink& sink_;
+      Failure status_;
+      FILE *f_;
+    };
+  }
+
+  history_file::history_file(std::unique_ptr<impl> p)
+    : impl_(std::move(p))
+  {
+  }
+
+  history_file::~history_file()
+  {
+    // Any lock messages go to the diagnostics, not stderr.
+    error_context ctx(nullptr, &impl_->diagnostics);
+    impl_->file.reset();
+  }
+
+  FailureOr<std::unique_ptr<history_file>>
+  history_file::open(const std::string& name, open_mode mode)
+  {
+    if (name.empty())
+      return make_failure(errorcode::NotAnSccsHistoryFileName);
+
+    std::unique_ptr<impl> p(new impl(mode == open_mode::update
+				     ? UPDATE : READ));
+    // This is the same treatment that the command-line tools give
+    // their arguments; "foo" means "s.foo".
+    p->name = name;
+    if (!p->name.valid())
+      {
+	p->name.make_valid();
+	if (!p->name.valid())
+	  return make_failure(errorcode::NotAnSccsHistoryFileName, name);
+      }
+    p->sfile = p->name.sfile();
+    std::unique_ptr<history_file> result(new history_file(std::move(p)));
+    Failure loaded = result->reload();
+    if (!loaded.ok())
+      return loaded;
+    return result;
+  }
+
+  // (Re-)reads the history file.  This is needed after an update,
+  // because the sccs_file object keeps reading the body of the file
+  // it originally opened.  The new sccs_file is opened before the old
+  // one is dropped; they share self.name, whose lock count keeps the
+  // file locked throughout.  If the file can't be read again, we keep
+  // the old sccs_file (and so the lock) and report the failure.
+  Failure
+  history_file::reload()
+  {
+    impl& self(*impl_);
+    self.diagnostics.clear();
+    error_context ctx(nullptr, &self.diagnostics);
+    std::unique_ptr<sccs_file> fresh;
+    std::vector<delta_info> deltas;
+    Failure opened = guarded<Failure>(self.diagnostics,
+				      [&self, &fresh, &deltas]() -> Failure
+      {
+	fresh.reset(new sccs_file(self.name, self.mode));
+	fresh->keep_indexes();
+	const_delta_iterator iter(&fresh->delta_table(), delta_selector::all);
+	while (iter.next())
+	  deltas.push_back(describe(*iter));
+	return Failure::Ok();
+      });
+    if (!opened.ok())
+      return opened;
+    self.file = std::move(fresh);
+    self.deltas.swap(deltas);
+    return opened;
+  }
+
+  const std::string&
+  history_file::name() const
+  {
+    return impl_->sfile;
+  }
+
+  const std::vector<delta_info>&
+  history_file::deltas() const
+  {
+    return impl_->deltas;
+  }
+
+  const std::string&
+  history_file::diagnostics() const
+  {
+    return impl_->diagnostics;
+  }
+
+  FailureOr<get_result>
+  history_file::get(const get_request& request, const body_sink& sink)
+  {
+    impl& self(*impl_);
+    self.diagnostics.clear();
+    if (!self.file)
+      return make_failure(errorcode::OperationFailed, "history file is not open");
+    error_context ctx(nullptr, &self.diagnostics);
+
+    sid rid(sid::null_sid());
+    if (!request.sid.empty())
+      {
+	rid = sid(request.sid.c_str());
+	if (!rid.valid())
+	  return make_failure_builder(errorcode::UsagePreconditionFailureSidNotFound)
+	    << "invalid SID " << request.sid;
+      }
+    sid_list include(request.include.c_str());
+    sid_list exclude(request.exclude.c_str());
+    if (!include.valid() || !exclude.valid())
+      return make_failure_builder(errorcode::UsagePreconditionFailureSidNotFound)
+	<< "invalid SID list";
+    sccs_date cutoff_date;
+    if (!request.cutoff.empty())
+      {
+	cutoff_date = sccs_date(request.cutoff.c_str());
+	if (!cutoff_date.valid())
+	  return make_failure_builder(errorcode::OperationFailed)
+	    << "invalid cutoff date " << request.cutoff;
+      }
+
+    return guarded<FailureOr<get_result>>(self.diagnostics,
+      [&]() -> FailureOr<get_result>
+      {
+	sid retrieve;
+	if (!self.file->find_requested_sid(rid, retrieve))
+	  return make_failure(errorcode::UsagePreconditionFailureSidNotFound,
+			      request.sid);
+
+	sink_stream stream(sink);
+	FailureOr<FILE*> out = stream.open();
+	if (!out.ok())
+	  return out.fail();
+	FailureOr<get_status> got =
+	  self.file->get(*out, self.name.gfile(), nullptr, retrieve,
+			 cutoff_date, include, exclude,
+			 request.expand_keywords, optional<std::string>(),
+			 false, false, false, false);
+	Failure finished = stream.finish();
+	if (!got.ok())
+	  return with_diagnostics(got.fail(), self.diagnostics);
+	if (!finished.ok())
+	  return finished;
+
+	get_result result;
+	result.sid = retrieve.as_string();
+	result.lines = (*got).lines;
+	to_strings((*got).included, &result.included);
+	to_strings((*got).excluded, &result.excluded);
+	return result;
+      });
+  }
+
+  FailureOr<get_result>
+  history_file::get(const get_request& request, std::string *body)
+  {
+    return get(request,
+	       [body](const char *data, size_t len) -> Failure
+	       {
+		 body->append(data, len);
+		 return Failure::Ok();
+	       });
+  }
+
+  FailureOr<delta_result>
+  history_file::add_delta(const delta_request& request)
+  {
+    impl& self(*impl_);
+    self.diagnostics.clear();
+    if (!self.file)
+      return make_failure(errorcode::OperationFailed, "history file is not open");
+    if (self.mode != UPDATE)
+      return make_failure(errorcode::LockNotHeld,
+			  "history file was not opened for update");
+
+    std::string diagnostics;
+    sid new_sid;
+    {
+      error_context ctx(nullptr, &diagnostics);
+      sid rid(sid::null_sid());
+      if (!request.sid.empty())
+	{
+	  rid = sid(request.sid.c_str());
+	  if (!rid.valid())
+	    return make_failure_builder(errorcode::EditNotLocked)
+	      << "invalid SID " << request.sid;
+	}
+      const std::string gname =
+	request.gfile.empty() ? self.name.gfile() : request.gfile;
+      FailureOr<sid> added = guarded<FailureOr<sid>>(diagnostics,
+	[&]() -> FailureOr<sid>
+	{
+	  return self.file->check_in(rid, gname, request.mrs, false,
+				     request.comments, false, nullptr);
+	});
+      if (!added.ok())
+	{
+	  self.diagnostics = diagnostics;
+	  return with_diagnostics(added.fail(), diagnostics);
+	}
+      new_sid = *added;
+      if (!request.keep_gfile)
+	{
+	  Failure unlinked = unlink_file_as_real_user(gname.c_str());
+	  if (!unlinked.ok())
+	    {
+	      self.diagnostics = diagnostics;
+	      return unlinked;
+	    }
+	}
+    }
+
+    // The history file has been replaced, so read it again.
+    Failure reloaded = reload();
+    self.diagnostics = diagnostics + self.diagnostics;
+    if (!reloaded.ok())
+      return reloaded;
+
+    delta_result result;
+    result.sid = new_sid.as_string();
+    for (const auto& d : self.deltas)
+      {
+	if (d.sid == result.sid)
+	  {
+	    result.inserted = d.inserted;
+	    result.deleted = d.deleted;
+	    result.unchanged = d.unchanged;
+	    break;
+	  }
+      }
+    return result;
+  }
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,181 @@
+/*
+ * libcssc.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * An interface for programs which want to work with SCCS history
+ * files in-process, instead of running get, prs or delta once for
+ * each operation.
+ *
+ * Only standard library types (and cssc::Failure) appear in this
+ * interface, so callers do not depend on the layout of the classes
+ * used internally to represent SIDs, dates and so forth.  SIDs,
+ * SID lists and dates are passed as strings in the same formats the
+ * command-line tools accept.
+ *
+ * Diagnostics which the command-line tools would print on stderr are
+ * collected and returned in the detail of the cssc::Failure (and are
+ * also available from history_file::diagnostics()).  Nothing is
+ * written to stdout or stderr.  Different history_file objects may
+ * be used concurrently from different threads; a single
+ * history_file object must not be.
+ */
+
+#ifndef CSSC__LIBCSSC_H__
+#define CSSC__LIBCSSC_H__
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "failure.h"
+#include "failure_or.h"
+
+namespace cssc
+{
+  // One entry in the delta table of a history file.
+  struct delta_info
+  {
+    char type;			// 'D' (normal) or 'R' (removed)
+    std::string sid;
+    std::string date;		// "YY/MM/DD hh:mm:ss"
+    std::string user;
+    unsigned long seq;
+    unsigned long prev_seq;
+    unsigned long inserted, deleted, unchanged;
+    std::vector<std::string> mrs;
+    std::vector<std::string> comments;
+
+    delta_info()
+      : type('D'), sid(), date(), user(), seq(0uL), prev_seq(0uL),
+	inserted(0uL), deleted(0uL), unchanged(0uL), mrs(), comments()
+    {
+    }
+  };
+
+  // What to retrieve; the fields correspond to the options of "get".
+  struct get_request
+  {
+    std::string sid;		// -r; empty means the default SID
+    bool expand_keywords;	// false is like -k
+    std::string include;	// -i
+    std::string exclude;	// -x
+    std::string cutoff;		// -c
+
+    get_request()
+      : sid(), expand_keywords(true), include(), exclude(), cutoff()
+    {
+    }
+  };
+
+  struct get_result
+  {
+    std::string sid;		// the SID actually retrieved
+    unsigned long lines;
+    std::vector<std::string> included, excluded;
+
+    get_result()
+      : sid(), lines(0uL), included(), excluded()
+    {
+    }
+  };
+
+  // The parameters of a new delta; the fields correspond to the
+  // options of "delta".  The edit must previously have been locked
+  // in the p-file, for example by running "get -e".
+  struct delta_request
+  {
+    std::string sid;		// -r; may be empty if only one edit is locked
+    std::vector<std::string> mrs;
+    std::vector<std::string> comments;
+    std::string gfile;		// empty means the usual g-file name
+    bool keep_gfile;		// -n
+
+    delta_request()
+      : sid(), mrs(), comments(), gfile(), keep_gfile(false)
+    {
+    }
+  };
+
+  struct delta_result
+  {
+    std::string sid;		// the SID of the new delta
+    unsigned long inserted, deleted, unchanged;
+
+    delta_result()
+      : sid(), inserted(0uL), deleted(0uL), unchanged(0uL)
+    {
+    }
+  };
+
+  // Receives the body of a retrieved version in pieces.  A failure
+  // returned by the sink aborts the retrieval.
+  typedef std::function<Failure(const char *data, size_t len)> body_sink;
+
+  class history_file
+  {
+  public:
+    enum class open_mode { read, update };
+
+    // Opens the history file NAME (which may also be given as the
+    // name of the g-file, as on the command line).  In update mode
+    // the history file is locked until the object is destroyed.
+    static FailureOr<std::unique_ptr<history_file>>
+      open(const std::string& name, open_mode mode = open_mode::read);
+
+    ~history_file();
+
+    const std::string& name() const;
+
+    // The delta table, newest delta first (as in the file itself).
+    const std::vector<delta_info>& deltas() const;
+
+    // Passes the body of the selected version to SINK.
+    FailureOr<get_result> get(const get_request& request,
+			      const body_sink& sink);
+
+    // Appends the body of the selected version to *BODY.
+    FailureOr<get_result> get(const get_request& request,
+			      std::string *body);
+
+    // Checks in a locked edit.  The history file must have been
+    // opened in update mode, and it remains usable afterwards (its
+    // delta table includes the new delta).
+    FailureOr<delta_result> add_delta(const delta_request& request);
+
+    // The diagnostics issued by the most recent operation.
+    const std::string& diagnostics() const;
+
+  private:
+    struct impl;
+    explicit history_file(std::unique_ptr<impl>);
+    history_file(const history_file&) = delete;
+    history_file& operator=(const history_file&) = delete;
+
+    Failure reload();
+
+    std::unique_ptr<impl> impl_;
+  };
+}
+
+#endif /* CSSC__LIBCSSC_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
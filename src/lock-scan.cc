@@ -0,0 +1,170 @@
+/*
+ * lock-scan.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The parallel directory walk behind "sact -R".
+ *
+ */
+
+#include <config.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include "cssc.h"
+#include "lock-scan.h"
+
+namespace
+{
+  // What we found in one directory.
+  struct listing
+  {
+    std::vector<std::string> subdirs;
+    std::vector<std::string> locked;
+  };
+
+  bool
+  is_real_directory(const std::string& path, const struct dirent *dent)
+  {
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+    if (dent->d_type != DT_UNKNOWN)
+      return dent->d_type == DT_DIR;
+#else
+    (void) dent;
+#endif
+    struct stat st;
+    return 0 == lstat(path.c_str(), &st) && S_ISDIR(st.st_mode);
+  }
+
+  cssc::Failure
+  list_directory(const std::string& dirname, listing *result)
+  {
+    DIR *dir = opendir(dirname.c_str());
+    if (nullptr == dir)
+      {
+	return cssc::make_failure_builder_from_errno(errno)
+	  .diagnose() << "cannot open directory " << dirname;
+      }
+    const std::string prefix =
+      (dirname.back() == '/') ? dirname : dirname + "/";
+
+    std::unordered_set<std::string> sfiles, pfiles;
+    cssc::Failure status = cssc::Failure::Ok();
+    for (;;)
+      {
+	errno = 0;
+	const struct dirent *dent = readdir(dir);
+	if (nullptr == dent)
+	  {
+	    if (errno)
+	      {
+		status = cssc::make_failure_builder_from_errno(errno)
+		  .diagnose() << "failed to read directory " << dirname;
+	      }
+	    break;
+	  }
+	const char *name = dent->d_name;
+	if (name[0] == '.'
+	    && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+	  continue;
+	// A directory may be called s.something too, and is searched
+	// like any other.
+	const std::string path = prefix + name;
+	if (is_real_directory(path, dent))
+	  result->subdirs.push_back(path);
+	else if ((name[0] == 's' || name[0] == 'p') && name[1] == '.'
+		 && name[2] != '\0')
+	  (name[0] == 's' ? sfiles : pfiles).insert(name + 2);
+      }
+    closedir(dir);
+
+    for (const auto& base : pfiles)
+      {
+	if (sfiles.count(base))
+	  result->locked.push_back(prefix + "s." + base);
+      }
+    return status;
+  }
+}
+
+
+cssc::Failure
+find_locked_files(const std::vector<std::string>& roots,
+		  unsigned long jobs,
+		  std::vector<std::string> *sfiles)
+{
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::string> todo(roots.begin(), roots.end());
+  unsigned long busy = 0;	// threads listing a directory
+  cssc::Failure result = cssc::Failure::Ok();
+  std::vector<std::string> found;
+
+  auto worker = [&]()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      for (;;)
+	{
+	  changed.wait(lock, [&]() { return !todo.empty() || busy == 0; });
+	  if (todo.empty())
+	    return;		// nothing left, and nobody to add more.
+	  const std::string dirname = todo.front();
+	  todo.pop_front();
+	  ++busy;
+	  lock.unlock();
+
+	  listing here;
+	  // list_directory() reports its own failures.
+	  const cssc::Failure listed = list_directory(dirname, &here);
+
+	  lock.lock();
+	  if (result.ok())
+	    result = listed;
+	  todo.insert(todo.end(), here.subdirs.begin(), here.subdirs.end());
+	  found.insert(found.end(), here.locked.begin(), here.locked.end());
+	  --busy;
+	  changed.notify_all();
+	}
+    };
+
+  std::vector<std::thread> threads;
+  for (unsigned long t = 1; t < jobs; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& t : threads)
+    t.join();
+
+  std::sort(found.begin(), found.end());
+  sfiles->swap(found);
+  return result;
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,48 @@
+/*
+ * lock-scan.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Finds the history files in a directory tree which have edit locks.
+ *
+ */
+
+#ifndef CSSC__LOCK_SCAN_H__
+#define CSSC__LOCK_SCAN_H__
+
+#include <string>
+#include <vector>
+
+#include "failure.h"
+
+// Walks the directory trees under ROOTS using JOBS threads, and sets
+// *SFILES to the names of the history files which have a p-file, in
+// sorted order.  A file is found from the directory listing alone:
+// we look for "p.foo" next to "s.foo", so that a tree of history files
+// is scanned without opening or even stat()ing the files which are
+// not being edited.  Symbolic links to directories are not followed.
+// A directory which cannot be read is diagnosed and the walk goes on;
+// the result then reports the first such failure.
+cssc::Failure find_locked_files(const std::vector<std::string>& roots,
+				unsigned long jobs,
+				std::vector<std::string> *sfiles);
+
+#endif /* CSSC__LOCK_SCAN_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,137 @@
+/*
+ * multicall.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The table of tools built into a multicall "sccs".  Each tool is
+ * compiled from its usual source file by builtin-TOOL.cc, which
+ * renames its main() and usage() functions.
+ *
+ */
+#include "config.h"
+
+#include <cstring>
+
+#include "cssc.h"
+#include "cssc-assert.h"
+#include "except.h"
+#include "multicall.h"
+#include "quit.h"
+
+#define CSSC_BUILTIN(tool) \
+  int cssc_ ## tool ## _main(int argc, char **argv); \
+  void cssc_ ## tool ## _usage();
+
+CSSC_BUILTIN(admin)
+CSSC_BUILTIN(cdc)
+CSSC_BUILTIN(comb)
+CSSC_BUILTIN(delta)
+CSSC_BUILTIN(get)
+CSSC_BUILTIN(prs)
+CSSC_BUILTIN(prt)
+CSSC_BUILTIN(rmdel)
+CSSC_BUILTIN(sact)
+CSSC_BUILTIN(unget)
+CSSC_BUILTIN(val)
+CSSC_BUILTIN(what)
+
+#undef CSSC_BUILTIN
+
+namespace
+{
+  struct builtin
+  {
+    const char *name;
+    int (*main)(int argc, char **argv);
+    void (*usage)();
+  };
+
+#define CSSC_BUILTIN(tool) { #tool, cssc_ ## tool ## _main, cssc_ ## tool ## _usage }
+
+  const builtin builtins[] =
+    {
+      CSSC_BUILTIN(admin),
+      CSSC_BUILTIN(cdc),
+      CSSC_BUILTIN(comb),
+      CSSC_BUILTIN(delta),
+      CSSC_BUILTIN(get),
+      CSSC_BUILTIN(prs),
+      CSSC_BUILTIN(prt),
+      CSSC_BUILTIN(rmdel),
+      CSSC_BUILTIN(sact),
+      CSSC_BUILTIN(unget),
+      CSSC_BUILTIN(val),
+      CSSC_BUILTIN(what),
+    };
+
+#undef CSSC_BUILTIN
+
+  const builtin *running = nullptr;
+
+  const builtin *
+  find_builtin(const char *name)
+  {
+    for (const builtin& b : builtins)
+      {
+	if (0 == strcmp(b.name, name))
+	  return &b;
+      }
+    return nullptr;
+  }
+}
+
+// The library calls usage() when a tool is given invalid options;
+// this is normally defined by the tool itself.
+void
+usage()
+{
+  if (running)
+    running->usage();
+}
+
+int
+cssc_is_builtin(const char *name)
+{
+  return nullptr != find_builtin(name);
+}
+
+const char *
+cssc_builtin_name(int i)
+{
+  if (i < 0 || static_cast<size_t>(i) >= sizeof(builtins) / sizeof(builtins[0]))
+    return nullptr;
+  return builtins[i].name;
+}
+
+int
+cssc_run_builtin(const char *name, int argc, char **argv)
+{
+  running = find_builtin(name);
+  ASSERT(running != nullptr);
+  try
+    {
+      return running->main(argc, argv);
+    }
+  catch (const CsscExitvalException& e)
+    {
+      return e.exitval;
+    }
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,55 @@
+/*
+ * multicall.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The interface through which the "sccs" driver (which is written in
+ * C) runs the tools built into it when CSSC is configured with
+ * --enable-multicall.
+ *
+ */
+
+#ifndef CSSC__MULTICALL_H__
+#define CSSC__MULTICALL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns nonzero if NAME (for example "get") is built in. */
+int cssc_is_builtin (const char *name);
+
+/* Returns the name of the Ith built-in tool, or NULL if there are
+ * fewer than I+1 of them.
+ */
+const char *cssc_builtin_name (int i);
+
+/* Runs the built-in tool NAME as if it had been executed with
+ * arguments ARGV, and returns its exit status.  This can be done only
+ * once per process.
+ */
+int cssc_run_builtin (const char *name, int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CSSC__MULTICALL_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
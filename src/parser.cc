@@ -27,6 +27,10 @@
 #include <limits.h>		/* INT_MAX, INT_MIN */
 #include <errno.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "cssc.h"
 // TODO: eliminate the need to #include "defaults.h" directly.
 #include "defaults.h"
@@ -38,6 +42,7 @@
 #include "file.h"
 #include "linebuf.h"
 #include "quit.h"
+#include "stats.h"
 
 namespace
 {
@@ -148,8 +153,18 @@ sccs_file_parser::sccs_file_parser(const string& n, sccs_file_open_mode m,
 {
 }
 
-/* Reads a delta from the SCCS file's delta table and adds it to the
-   delta table. */
+/* Serial numbers are given out in order, so the highest is normally
+   the number of deltas.  We allow for gaps, but a serial number far
+   beyond that comes from a corrupt file, and would make every table
+   indexed by serial number enormous.  Anything up to 65535 is accepted,
+   as it always was. */
+static bool
+plausible_seqno(seq_no highest, size_t ndeltas)
+{
+  return highest <= 65535u || highest / 2u <= ndeltas;
+}
+
+/* Reads a delta from the SCCS file's delta table. */
 
 std::unique_ptr<delta>
 sccs_file_parser::read_delta() {
@@ -213,8 +228,8 @@ sccs_file_parser::read_delta() {
         tmp->set_date(newdate);
 
         tmp->set_user(args[4]);
-        tmp->set_seq(strict_atous(here(), args[5]));
-        tmp->set_prev_seq(strict_atous(here(), args[6]));
+        tmp->set_seq(strict_atoseq(here(), args[5]));
+        tmp->set_prev_seq(strict_atoseq(here(), args[6]));
 
         /* Read in any lists of included, excluded or ignored seq. no's. */
         char c = rl();
@@ -267,7 +282,7 @@ sccs_file_parser::read_delta() {
                                   ASSERT(*end == 0);
                                   ++end;
                                 }
-                                seq_no seq = strict_atous(here(), start);
+                                seq_no seq = strict_atoseq(here(), start);
                                 switch (c) {
                                 case 'i':
                                   if (bDebug)
@@ -520,13 +535,27 @@ sccs_file_parser::parse_header(FILE *f_local, ParserOptions opts)
     {
       return nullptr;
     }
+  // The checksum covers everything from here on.
+  const long checksum_start = ftell(f_local);
+  if (checksum_start == -1L)
+    {
+      errormsg_with_errno("ftell() failed.");
+      (void)fclose(f_local);
+      return nullptr;
+    }
 
   int sum = 0u;
   /* Read the whole file and compute the checksum. */
+  if (!opts.skip_checksum())
   {
-    int c;
-    while ((c=getc(f_local)) != EOF)
-      sum += static_cast<char>(c);    // Yes, I mean plain char, not signed, not unsigned.
+    stats_timer timer(stats_phase::checksum);
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f_local)) > 0)
+      {
+	for (size_t i = 0; i < n; ++i)
+	  sum += buf[i];    // Yes, I mean plain char, not signed, not unsigned.
+      }
 
     if (ferror(f_local))
       {
@@ -559,6 +588,7 @@ sccs_file_parser::parse_header(FILE *f_local, ParserOptions opts)
     }
 #endif
 
+  stats_timer header_timer(stats_phase::delta_table);
   std::unique_ptr<open_result> result = make_unique_open_result();
   result->computed_sum = sum & 0xFFFFu;
   result->is_bk = is_bk;
@@ -630,8 +660,10 @@ sccs_file_parser::parse_header(FILE *f_local, ParserOptions opts)
 	}
 
       given_sum &= 0xFFFFu;
-      result->checksum_valid_ = (result->stored_sum == result->computed_sum);
-      if (!result->checksum_valid_ && !opts.silent_checksum_error())
+      result->checksum_valid_ = !opts.skip_checksum()
+	&& (result->stored_sum == result->computed_sum);
+      if (!result->checksum_valid_ && !opts.silent_checksum_error()
+	  && !opts.skip_checksum())
 	{
 	  warning("%s: bad checksum "
 		  "(expected=%d, calculated %d).\n",
@@ -639,18 +671,31 @@ sccs_file_parser::parse_header(FILE *f_local, ParserOptions opts)
 	}
     }
 
-  /* Read the delta table. */
+  /* Read the delta table.  The table, and everything else indexed by
+   * serial number, has room for the highest one, so we check that
+   * before adding any of the deltas.
+   */
+  std::vector<std::unique_ptr<delta>> deltas;
+  seq_no highest = 0;
   READ_LINE(c, return nullptr);
   while (c == 's')
     {
-      if (!result->delta_table)
-	{
-	  result->delta_table = make_unique_cssc_delta_table();
-	}
-      std::unique_ptr<delta> d = read_delta();
-      result->delta_table->add(*d); // FIXME: memory allocation churn, excess copying
+      deltas.push_back(read_delta());
+      highest = std::max(highest, deltas.back()->seq());
       READ_LINE(c, return nullptr);
     }
+  if (!plausible_seqno(highest, deltas.size()))
+    {
+      corrupt(here(), "Serial number %lu is too large for a file "
+	      "with %lu deltas", static_cast<unsigned long>(highest),
+	      static_cast<unsigned long>(deltas.size()));
+    }
+  if (!deltas.empty())
+    {
+      result->delta_table = make_unique_cssc_delta_table();
+      for (const auto& d : deltas)
+	result->delta_table->add(*d);
+    }
 
   if (c != 'u')
     {
@@ -740,10 +785,38 @@ sccs_file_parser::parse_header(FILE *f_local, ParserOptions opts)
       errormsg_with_errno("ftell() failed.");
       return nullptr;
     }
+
+  // Work out how much of the checksum comes from the body, so that an
+  // update which copies the body unchanged need not read it again.
+  // The header is small, so reading it a second time costs little.
+  int header_sum = 0;
+  if (!opts.skip_checksum())
+    {
+      stats_timer timer(stats_phase::checksum);
+      if (fseek(f_local, checksum_start, SEEK_SET) != 0)
+	{
+	  errormsg_with_errno("%s: fseek() failed.", name);
+	  (void)fclose(f_local);
+	  return nullptr;
+	}
+      for (long n = body_offset - checksum_start; n > 0; --n)
+	{
+	  const int c = getc(f_local);
+	  if (EOF == c)
+	    {
+	      errormsg_with_errno("%s: read error", name);
+	      (void)fclose(f_local);
+	      return nullptr;
+	    }
+	  header_sum += static_cast<char>(c);
+	}
+    }
+
   // The body scanner takes ownership of f_local.
   result->body_scanner =
     make_unique_sccs_file_body_scanner(this->name(), f_local,
-				       body_offset, here().line_number());
+				       body_offset, here().line_number(),
+				       (sum - header_sum) & 0xFFFFu);
   return result;
 }
 
@@ -57,7 +57,7 @@ class ParserOptions
 {
 public:
   explicit ParserOptions()
-  : silent_checksum_error_(false)
+  : silent_checksum_error_(false), skip_checksum_(false)
   {
   }
 
@@ -74,8 +74,23 @@ public:
     return silent_checksum_error_;
   }
 
+  // Don't read the whole file to verify its checksum.  Only for
+  // files opened to be read: the checksum is then never valid, and
+  // the body scanner cannot supply a body checksum for an update.
+  ParserOptions& set_skip_checksum(bool state)
+  {
+    skip_checksum_ = state;
+    return *this;
+  }
+
+  bool skip_checksum() const
+  {
+    return skip_checksum_;
+  }
+
 private:
   bool silent_checksum_error_;
+  bool skip_checksum_;
 };
 
 
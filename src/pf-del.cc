@@ -173,7 +173,10 @@ sccs_pfile::update(bool pfile_already_exists) const
 	}
       pf = NULL;
 
-      if (pfile_already_exists)
+      // If we still need a p-file and can rename over the old one,
+      // we do that, so that nobody sees it missing meanwhile.
+      if (pfile_already_exists
+	  && !(locks_remaining && CONFIG_CAN_RENAME_OVER_EXISTING_FILE))
 	{
 	  if (remove(pname_.c_str()) != 0)
 	    {
@@ -186,7 +189,8 @@ sccs_pfile::update(bool pfile_already_exists) const
 	{
 	  if (rename(q_name.c_str(), pname_.c_str()) != 0)
 	    {
-	      // this is really bad; we have already deleted the old p-file!
+	      // this is really bad if we have already deleted the old
+	      // p-file!
 	      return cssc::make_failure_builder_from_errno(errno)
 	      .diagnose() << "failed to rename " << q_name << " to " << pname_;
 	    }
@@ -22,14 +22,27 @@
  * placed in the Public Domain.
  */
 #include "config.h"
+
+#include <cerrno>
+#include <mutex>
+
+#include "cssc.h"
+#include "sysdep.h"
+#include "quit.h"
 #include "privs.h"
 
 namespace
 {
 
-/* A flag to indicate whether or not the programme is an privileged
-   (effective UID != real UID) or unprivileged (effective UID == real
-   UID). */
+/* The number of TempPrivDrop objects which have given up privileges.
+   We give them up when this becomes nonzero, and restore them when it
+   becomes zero again.  A programme which is not set-user-id (effective
+   UID == real UID) has no privileges to give up, so it changes no IDs
+   at all, and its threads may drop their (absent) privileges at once.
+   A set-user-id one must not use threads, since the user ID belongs
+   to the whole process.  The mutex guards the count and the saved
+   IDs. */
+static std::mutex privs_mutex;
 static int unprivileged = 0;
 
 #ifdef CONFIG_UIDS
@@ -37,13 +50,16 @@ static int unprivileged = 0;
 # ifdef SAVED_IDS_OK
 
 static uid_t old_euid;
+static bool ids_changed = false; // we must change the ID back.
 
 // Set-user-id is saved.  TODO: What about setuid-root binaries?
 void
 give_up_privileges() {
+        std::lock_guard<std::mutex> guard(privs_mutex);
         if (unprivileged++ == 0) {
                 old_euid = geteuid();
-                if (setuid(getuid()) == -1) {
+                ids_changed = (old_euid != getuid());
+                if (ids_changed && setuid(getuid()) == -1) {
                         fatal_quit(errno, "setuid(%d) failed", getuid());
                 }
                 ASSERT(getuid() == geteuid());
@@ -52,13 +68,14 @@ give_up_privileges() {
 
 void
 restore_privileges() {
-        if (--unprivileged == 0) {
+        std::lock_guard<std::mutex> guard(privs_mutex);
+        ASSERT(unprivileged > 0);
+        if (--unprivileged == 0 && ids_changed) {
                 if (setuid(old_euid) == -1) {
                         fatal_quit(errno, "setuid(%d) failed", old_euid);
                 }
                 ASSERT(geteuid() == old_euid);
         }
-        ASSERT(unprivileged >= 0);
 }
 
 # elif defined(HAVE_SETREUID)
@@ -67,14 +84,17 @@ restore_privileges() {
 // setreuid() instead.
 
 static uid_t old_ruid, old_euid;
+static bool ids_changed = false; // we must change the IDs back.
 
 void
 give_up_privileges() {
+        std::lock_guard<std::mutex> guard(privs_mutex);
         if (unprivileged++ == 0) {
                 old_ruid = getuid();
                 old_euid = geteuid();
+                ids_changed = (old_euid != old_ruid);
 
-                if (setreuid(old_euid, old_ruid) == -1) {
+                if (ids_changed && setreuid(old_euid, old_ruid) == -1) {
                         fatal_quit(errno, "setreuid(%d, %d) failed.",
                                    old_euid, old_ruid);
                 }
@@ -84,14 +104,15 @@ give_up_privileges() {
 
 void
 restore_privileges() {
-        if (--unprivileged == 0) {
+        std::lock_guard<std::mutex> guard(privs_mutex);
+        ASSERT(unprivileged > 0);
+        if (--unprivileged == 0 && ids_changed) {
                 if (setreuid(old_ruid, old_euid) == -1) {
                         fatal_quit(errno, "setreuid(%d, %d) failed.",
                                    old_ruid, old_euid);
                 }
                 ASSERT(geteuid() == old_euid);
         }
-        ASSERT(unprivileged >= 0);
 }
 
 
@@ -101,6 +122,7 @@ restore_privileges() {
 // and setreuid() is not available.
 void
 give_up_privileges() {
+        std::lock_guard<std::mutex> guard(privs_mutex);
         ++unprivileged;
         if (geteuid() != getuid()) {
                 fatal_quit(-1, "Set UID not supported.");
@@ -109,8 +131,9 @@ give_up_privileges() {
 
 void
 restore_privileges() {
+        std::lock_guard<std::mutex> guard(privs_mutex);
+        ASSERT(unprivileged > 0);
         --unprivileged;
-        ASSERT(unprivileged >= 0);
 }
 
 # endif /* defined(HAVE_SETREUID) */
@@ -122,6 +145,7 @@ void
 give_up_privileges()
 {
   // Dummy implementation for systems without Unix-like UIDs.
+  std::lock_guard<std::mutex> guard(privs_mutex);
   unprivileged++;
 }
 
@@ -129,6 +153,7 @@ void
 restore_privileges()
 {
   // Dummy implementation for systems without Unix-like UIDs.
+  std::lock_guard<std::mutex> guard(privs_mutex);
   --unprivileged;
 }
 
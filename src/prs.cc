@@ -26,24 +26,59 @@
  */
 
 #include <config.h>
+#include <cerrno>
+#include <memory>
 #include <string>
 #include "cssc.h"
 #include "failure.h"
 #include "fileiter.h"
 #include "sccsfile.h"
+#include "parser.h"
 #include "my-getopt.h"
 #include "version.h"
 #include "delta.h"
 #include "except.h"
+#include "stats.h"
 
 
 void
 usage() {
 	fprintf(stderr,
-"usage: %s [-aelDRV] [-c cutoff] [-d format] [-r SID] file ...\n",
+"usage: %s [-aelDLRV] [-c cutoff] [-d format] [-r SID] file ...\n",
 		prg_name);
 }
 
+/* Copies the LEN bytes written to FROM onto TO as a single line: each
+ * run of newlines in them becomes a space, except at the end, and one
+ * newline ends the line.
+ */
+static cssc::Failure
+copy_as_one_line(FILE *from, long len, FILE *to)
+{
+  bool pending_space = false;
+  rewind(from);
+  while (len-- > 0)
+    {
+      const int c = getc(from);
+      if (EOF == c)
+	return cssc::make_failure_from_errno(ferror(from) ? errno : EIO);
+      if ('\n' == c)
+	{
+	  pending_space = true;
+	  continue;
+	}
+      if (pending_space && fputc_failed(putc(' ', to)))
+	return cssc::make_failure_from_errno(errno);
+      pending_space = false;
+      if (fputc_failed(putc(c, to)))
+	return cssc::make_failure_from_errno(errno);
+    }
+  if (fputc_failed(putc('\n', to)))
+    return cssc::make_failure_from_errno(errno);
+  return cssc::Failure::Ok();
+}
+
+
 int
 main(int argc, char **argv)
 {
@@ -55,15 +90,18 @@ main(int argc, char **argv)
   delta_selector selector = delta_selector::current; // -a
   sccs_date cutoff_date;
   int default_processing = 1;
+  bool format_given = false;
+  bool one_line_each = false;	// -L
 
   if (argc > 0)
     set_prg_name(argv[0]);
   else
     set_prg_name("prs");
+  start_stats();
 
   ASSERT(!rid.valid());
 
-  CSSC_Options opts(argc, argv, "d!Dr!elc!aV");
+  CSSC_Options opts(argc, argv, "d!Dr!elc!aLV");
   for(c = opts.next();
       c != CSSC_Options::END_OF_ARGUMENTS;
       c = opts.next())
@@ -76,10 +114,16 @@ main(int argc, char **argv)
 
 	case 'd':
 	  format = opts.getarg();
+	  format_given = true;
 	  /* specifying -d means, stop after the first match. */
 	  default_processing = 0;
 	  break;
 
+	case 'L':
+	  one_line_each = true;
+	  default_processing = 0;
+	  break;
+
 	case 'D':	// obsolete MySC-ism.
 	  default_processing = 0;
 	  break;
@@ -144,6 +188,24 @@ main(int argc, char **argv)
       selected = sccs_file::when::EARLIER;
     }
 
+  // With -L we print one line for each file, for listing a whole
+  // directory in one go.  Only the delta table is read: we don't
+  // read the body to check the checksum.
+  ParserOptions parser_options;
+  std::unique_ptr<FILE, int (*)(FILE*)> one_file(nullptr, fclose);
+  if (one_line_each)
+    {
+      if (!format_given)
+	format = ":F:\t:I:\t:D: :T:\t:P:";
+      parser_options.set_skip_checksum(true);
+      one_file.reset(tmpfile());
+      if (!one_file)
+	{
+	  errormsg_with_errno("Cannot create a temporary file");
+	  return 1;
+	}
+    }
+
   sccs_file_iterator iter(opts);
   if (iter.empty())
     {
@@ -158,15 +220,27 @@ main(int argc, char **argv)
       try
 	{
 	  sccs_name &name = iter.get_name();
-	  sccs_file file(name, READ);
+	  sccs_file file(name, READ, parser_options);
 
 	  if (default_processing)
 	    {
 	      printf("%s:\n\n", name.c_str());
 	    }
+	  FILE *out = one_line_each ? one_file.get() : stdout;
+	  if (one_line_each)
+	    rewind(out);
 	  cssc::FailureOr<bool> matched_or_fail =
-	    file.prs(stdout, "standard output", format, rid, cutoff_date,
+	    file.prs(out, "standard output", format, rid, cutoff_date,
 		     selected, selector);
+	  if (matched_or_fail.ok() && one_line_each && *matched_or_fail)
+	    {
+	      const long len = ftell(out);
+	      cssc::Failure copied = (len < 0)
+		? cssc::make_failure_from_errno(errno)
+		: copy_as_one_line(out, len, stdout);
+	      if (!copied.ok())
+		matched_or_fail = copied;
+	    }
 	  if (!matched_or_fail.ok())
 	    {
 	      errormsg("%s: %s", name.c_str(), matched_or_fail.fail().to_string().c_str());
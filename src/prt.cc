@@ -35,6 +35,7 @@
 #include "version.h"
 #include "delta.h"
 #include "except.h"
+#include "stats.h"
 
 
 void
@@ -70,6 +71,7 @@ main(int argc, char **argv)
     set_prg_name(argv[0]);
   else
     set_prg_name("prt");
+  start_stats();
 
   class CSSC_Options opts(argc, argv, "abdefistuVc!r!y!");
   for(int c = opts.next();
@@ -39,7 +39,11 @@
 
 // #include "pipe.h"
 
+#include <mutex>
+#include <signal.h>
 #include <stdarg.h>
+#include <string>
+#include <vector>
 
 const char *prg_name = NULL;
 
@@ -48,73 +52,170 @@ set_prg_name(const char *name) {
         prg_name = name;
 }
 
-static void
-v_errormsg(const char *fmt, va_list ap)
+namespace
+{
+  // The diagnostic context of the current thread; see error_context.
+  thread_local const char *context_name = nullptr;
+  thread_local std::string *context_sink = nullptr;
+
+  const char *
+  diagnostic_name()
+  {
+    return context_name ? context_name : prg_name;
+  }
+
+  void
+  append_vformat(std::string& out, const char *fmt, va_list ap)
+  {
+    char buf[256];
+    va_list ap2;
+    va_copy(ap2, ap);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    if (n < 0)
+      {
+        out.append(fmt);        // best effort
+      }
+    else if (static_cast<size_t>(n) < sizeof(buf))
+      {
+        out.append(buf, n);
+      }
+    else
+      {
+        std::vector<char> big(n + 1);
+        vsnprintf(big.data(), big.size(), fmt, ap2);
+        out.append(big.data(), n);
+      }
+    va_end(ap2);
+  }
+
+  // Each message is built up completely and then emitted with a
+  // single write, so that the output of concurrent operations is
+  // not interleaved mid-line.
+  void
+  emit(const std::string& msg)
+  {
+    if (context_sink)
+      {
+        context_sink->append(msg);
+      }
+    else
+      {
+        fwrite(msg.data(), 1, msg.size(), stderr);
+      }
+  }
+
+  std::string
+  prefix(const char *what)
+  {
+    std::string s;
+    const char *name = diagnostic_name();
+    if (name != NULL)
+      {
+        s.append(name);
+        s.append(what);
+      }
+    return s;
+  }
+}
+
+error_context::error_context(const char *name, std::string *sink)
+  : saved_name_(context_name), saved_sink_(context_sink)
+{
+  if (name)
+    context_name = name;
+  context_sink = sink;
+}
+
+error_context::~error_context()
 {
-  if (prg_name != NULL)
-    fprintf(stderr, "%s: ", prg_name);
+  context_name = saved_name_;
+  context_sink = saved_sink_;
+}
 
-  vfprintf(stderr, fmt, ap);
+static std::string
+v_errormsg_text(const char *fmt, va_list ap)
+{
+  std::string msg(prefix(": "));
+  append_vformat(msg, fmt, ap);
+  return msg;
 }
 
 void errormsg(const char *fmt, ...)
 {
   va_list ap;
   va_start(ap, fmt);
-  v_errormsg(fmt, ap);
+  std::string msg(v_errormsg_text(fmt, ap));
   va_end(ap);
-  putc('\n', stderr);
+  msg.push_back('\n');
+  emit(msg);
 }
 
 void warning (const char *fmt, ...)
 {
   va_list ap;
   va_start(ap, fmt);
-  fprintf(stderr, "%s: warning: ", prg_name);
-  vfprintf(stderr, fmt, ap);
+  std::string msg(prefix(": warning: "));
+  append_vformat(msg, fmt, ap);
   va_end(ap);
-  putc('\n', stderr);
+  msg.push_back('\n');
+  emit(msg);
 }
 
-static void
-v_errormsg_with_errno(const char *fmt, va_list ap)
+static std::string
+v_errormsg_with_errno_text(const char *fmt, va_list ap)
 {
   int saved_errno = errno;
 
-  v_errormsg(fmt, ap);
+  std::string msg(v_errormsg_text(fmt, ap));
+  msg.append(" : ");
+  msg.append(strerror(saved_errno));
+  msg.push_back('\n');
   errno = saved_errno;
-  perror(" ");
+  return msg;
 }
 
 void errormsg_with_errno(const char *fmt, ...)
 {
   va_list ap;
   va_start(ap, fmt);
-  v_errormsg_with_errno(fmt, ap);
+  std::string msg(v_errormsg_with_errno_text(fmt, ap));
   va_end(ap);
-  putc('\n', stderr);
+  msg.push_back('\n');
+  emit(msg);
+}
+
+static void
+v_errormsg_line(const char *fmt, va_list ap)
+{
+  std::string msg(v_errormsg_text(fmt, ap));
+  msg.push_back('\n');
+  emit(msg);
 }
 
 static void print_err(int err)
 {
-  fprintf (stderr, "%d - %s\n", err, strerror (err));
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%d - ", err);
+  emit(std::string(buf) + strerror(err) + "\n");
 }
 
 static NORETURN
 v_quit(int err, const char *fmt, va_list ap) {
         fflush(stdout);
-        cleanup::run_cleanups();
+        // Only the cleanups belonging to this thread are run, so that
+        // other operations in progress in the same process are not
+        // disturbed.
+        cleanup::run_thread_cleanups();
 
         fflush(stdout);
 
 	// We used to call usage() is err was -2, but
 	// nobody ever actually used that.
 
-	putc('\n', stderr);
+	emit("\n");
         if (fmt)
           {
-            v_errormsg(fmt, ap);
-            putc('\n', stderr);
+            v_errormsg_line(fmt, ap);
           }
 
         if (err >= 1) {
@@ -158,8 +259,7 @@ ctor_fail(int err, const char *fmt, ...) {
         va_start(ap, fmt);
         if (fmt)
           {
-            v_errormsg(fmt, ap);
-            putc('\n', stderr);
+            v_errormsg_line(fmt, ap);
           }
         throw CsscContstructorFailedException(err);
         /*NOTREACHED*/
@@ -181,8 +281,7 @@ s_corrupt_quit(const char *fmt, ...) {
 
 
         va_start(ap, fmt);
-        v_errormsg(fmt, ap);
-        putc('\n', stderr);
+        v_errormsg_line(fmt, ap);
         throw CsscSfileCorruptException();
         /*NOTREACHED*/
         va_end(ap);
@@ -220,10 +319,11 @@ s_missing_quit(const char *fmt, ...) {
 
 
         va_start(ap, fmt);
-        v_errormsg_with_errno(fmt, ap);
+        std::string msg(v_errormsg_with_errno_text(fmt, ap));
         va_end(ap);
 
-        putc('\n', stderr);
+        msg.push_back('\n');
+        emit(msg);
         throw CsscSfileMissingException();
         /*NOTREACHED*/
         ASSERT(0);              // not reached.
@@ -236,21 +336,19 @@ s_missing_quit(const char *fmt, ...) {
 NORETURN
 s_unrecognised_feature_quit(const char *fmt, va_list ap)
 {
-  if (prg_name != NULL)
-    fprintf(stderr, "%s: Warning: unknown feature: ", prg_name);
-
-  vfprintf(stderr, fmt, ap);
-  putc('\n', stderr);
+  std::string msg(prefix(": Warning: unknown feature: "));
+  append_vformat(msg, fmt, ap);
+  msg.push_back('\n');
+  emit(msg);
   throw CsscUnrecognisedFeatureException();
 }
 
 void
 v_unknown_feature_warning(const char *fmt, va_list ap)
 {
-  if (prg_name != NULL)
-    fprintf(stderr, "%s: Warning: unknown feature: ", prg_name);
-
-  vfprintf(stderr, fmt, ap);
+  std::string msg(prefix(": Warning: unknown feature: "));
+  append_vformat(msg, fmt, ap);
+  emit(msg);
 }
 
 
@@ -260,8 +358,7 @@ p_corrupt_quit(const char *fmt, ...) {
 
 
         va_start(ap, fmt);
-        v_errormsg(fmt, ap);
-        putc('\n', stderr);
+        v_errormsg_line(fmt, ap);
         throw CsscPfileCorruptException();
         /*NOTREACHED*/
         va_end(ap);
@@ -306,67 +403,128 @@ assert_failed(const char *file, int line,
 
 
 class cleanup *cleanup::head = NULL;
-int cleanup::running = 0;
-int cleanup::all_disabled = 0;
+std::atomic<int> cleanup::running(0);
+std::atomic<int> cleanup::all_disabled(0);
 #if HAVE_FORK
-int cleanup::in_child_flag = 0;
+std::atomic<int> cleanup::in_child_flag(0);
 #endif
 
-cleanup::cleanup()
-  : next(head) {
-  head = this;
-}
-
-cleanup::~cleanup()
+namespace
 {
-  if (head == NULL)
+  std::mutex cleanup_list_mutex;
+  // Prevents recursion if a cleanup action itself fails.
+  thread_local bool thread_running_cleanups = false;
+
+  // Holds cleanup_list_mutex with the fatal signals blocked in this
+  // thread.  The signal handler takes the mutex too, so it must never
+  // interrupt a thread which already holds it.
+  class list_lock
+  {
+  public:
+    list_lock()
     {
-      // SourceForge bug # 816679; cleanup::cleanup()
-      // can be called before there are any entries on the
-      // list.
-      return; // nothing to do.
+      block_fatal_signals(&saved_);
+      cleanup_list_mutex.lock();
     }
-  else
+
+    ~list_lock()
     {
-      class cleanup *p = head;
+      cleanup_list_mutex.unlock();
+      pthread_sigmask(SIG_SETMASK, &saved_, NULL);
+    }
 
-      if (p == this)
-	{
-	  head = next;
-	  return;
-        }
+    list_lock(const list_lock&) = delete;
+    list_lock& operator=(const list_lock&) = delete;
 
-      while (p->next != this)
-	{
-	  p = p->next;
-	  ASSERT(p != NULL);
-        }
+  private:
+    sigset_t saved_;
+  };
+}
+
+cleanup::cleanup()
+  : next(nullptr), owner(std::this_thread::get_id()), linked(true)
+{
+  list_lock guard;
+  next = head;
+  head = this;
+}
 
-      if (p != NULL) // 'if' fixes SourceForge bug # 816679
+// Removes this object from the list; the caller holds
+// cleanup_list_mutex.  We must not ASSERT here, since a failed
+// assertion would try to run the cleanups and so take the mutex
+// again.
+void
+cleanup::unlink_locked()
+{
+  // SourceForge bug # 816679; the object may already have been
+  // removed from the list (for example because its cleanup action
+  // has already been run).
+  for (class cleanup **pp = &head; *pp != NULL; pp = &(*pp)->next)
+    {
+      if (*pp == this)
 	{
-	  p->next = next;
+	  *pp = next;
+	  break;
 	}
     }
+  next = NULL;
+  linked = false;
+}
+
+cleanup::~cleanup()
+{
+  list_lock guard;
+  if (linked)
+    unlink_locked();
 }
 
 void
-cleanup::run_cleanups() {
-        if (running || all_disabled) {
-                return;
-        }
-        running = 1;
+cleanup::run_matching(bool only_this_thread)
+{
+  if (thread_running_cleanups || all_disabled)
+    return;
+  thread_running_cleanups = true;
+  running++;
+
+  // Detach each selected entry from the list before running it,
+  // since a cleanup action may destroy the object which owns it.
+  // This may be called from a signal handler, so we take the entries
+  // one at a time rather than allocating a list of them.
+  const std::thread::id me = std::this_thread::get_id();
+  for (;;)
+    {
+      class cleanup *p;
+      {
+	list_lock guard;
+	for (p = head; p != NULL; p = p->next)
+	  {
+	    if (!only_this_thread || p->owner == me)
+	      break;
+	  }
+	if (p != NULL)
+	  p->unlink_locked();
+      }
+      if (p == NULL)
+	break;
+      p->do_cleanup();
+    }
 
-        class cleanup *p = head;
-        while (p != NULL) {
-                p->do_cleanup();
-                p = p->next;
-        }
+  running--;
+  thread_running_cleanups = false;
+}
 
-        running = 0;
+void
+cleanup::run_cleanups() {
+        run_matching(false);
         all_disabled++;
         return;
 }
 
+void
+cleanup::run_thread_cleanups() {
+        run_matching(true);
+}
+
 
 Cleaner::~Cleaner()
 {
@@ -26,7 +26,9 @@
 #ifndef CSSC__QUIT_H__
 #define CSSC__QUIT_H__
 
+#include <signal.h>
 #include <stdarg.h>
+#include <string>
 
 #include "cssc-assert.h"
 
@@ -36,6 +38,28 @@ extern const char *prg_name;
 
 void set_prg_name(const char *name);
 
+// An error_context redirects the diagnostics (errormsg(), warning(),
+// the messages of the *_quit() functions and so on) which are issued
+// by the current thread while it is in scope.  If NAME is not null,
+// messages are prefixed with it rather than with prg_name.  If SINK
+// is not null, messages are appended to it rather than being written
+// to stderr.  Contexts nest; the previous one is restored by the
+// destructor.  This allows several operations to run in one process
+// (for example in different threads) each with its own diagnostics.
+class error_context
+{
+public:
+  explicit error_context(const char *name, std::string *sink = nullptr);
+  ~error_context();
+
+private:
+  error_context(const error_context&) = delete;
+  error_context& operator=(const error_context&) = delete;
+
+  const char *saved_name_;
+  std::string *saved_sink_;
+};
+
 // errormsg(): emit an error message preceded by the program name.
 //             then return to the caller (don't exit).
 void errormsg(const char *fmt, ...);
@@ -51,6 +75,9 @@ void errormsg_with_errno(const char *fmt, ...);
 
 
 void quit_on_fatal_signals(void); // defined in fatalsig.cc.
+// Blocks the signals handled by quit_on_fatal_signals() in the
+// calling thread, saving the previous mask; defined in fatalsig.cc.
+void block_fatal_signals(sigset_t *saved);
 
 
 
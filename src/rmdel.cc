@@ -37,6 +37,7 @@
 #include "except.h"
 #include "file.h"
 #include "privs.h"
+#include "stats.h"
 
 
 void
@@ -73,6 +74,7 @@ main(int argc, char **argv)
     set_prg_name(argv[0]);
   else
     set_prg_name("rmdel");
+  start_stats();
 
   ASSERT(!rid.valid());
 
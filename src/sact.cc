@@ -27,36 +27,109 @@
  */
 
 #include <config.h>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <ctype.h>
+
 #include "cssc.h"
 #include "fileiter.h"
+#include "lock-scan.h"
 #include "pfile.h"
 #include "version.h"
 #include "my-getopt.h"
 #include "except.h"
+#include "stats.h"
 
 void
 usage() {
 	fprintf(stderr,
-"usage: %s [-V] file ...\n",
-		prg_name);
+"usage: %s [-V] file ...\n"
+"       %s -R [-j jobs] [directory ...]\n",
+		prg_name, prg_name);
+}
+
+/* Prints the edit locks on the history file NAME, preceded by its
+ * name if SHOW_NAME is set and there are any.
+ */
+static void
+print_locks(sccs_name& name, bool show_name)
+{
+  sccs_pfile pfile(name, sccs_pfile::pfile_mode::PFILE_READ);
+
+  bool first = true;
+  for (sccs_pfile::const_iterator it = pfile.begin();
+       it != pfile.end();
+       ++it)
+    {
+      if (first) // first lock on this file...
+	{
+	  /*
+	   * Before we print out the information about the
+	   * first lock on a given file. we may have to
+	   * identify which file we are talking about.  We
+	   * don't do this if only one file was specified on
+	   * the command line.
+	   */
+	  if (show_name)
+	  {
+	    printf("\n%s:\n", name.c_str());
+	  }
+	  first = false;
+	}
+
+      it->got.print(stdout);
+      putchar(' ');
+      it->delta.print(stdout);
+      putchar(' ');
+      fputs(it->user.c_str(), stdout);
+      putchar(' ');
+      it->date.print(stdout);
+      putchar('\n');
+    }
 }
 
 int
 main(int argc, char **argv)
 {
   Cleaner arbitrary_name;
+  bool tree = false;		// -R
+  unsigned long jobs = 1;	// -j
   if (argc > 0)
     set_prg_name(argv[0]);
   else
     set_prg_name("sact");
+  start_stats();
 
 
-  class CSSC_Options opts(argc, argv, "V");
+  class CSSC_Options opts(argc, argv, "VRj!");
   int c;
   for (c = opts.next(); c != CSSC_Options::END_OF_ARGUMENTS; c = opts.next())
     {
       switch (c)
 	{
+	case CSSC_Options::UNRECOGNIZED_OPTION:
+	case CSSC_Options::MISSING_ARGUMENT:
+	  return 1;
+
+	case 'R':
+	  tree = true;
+	  break;
+
+	case 'j':
+	  {
+	    char *end;
+	    errno = 0;
+	    jobs = strtoul(opts.getarg(), &end, 10);
+	    if (errno || *end || jobs < 1 || !isdigit((unsigned char)*opts.getarg()))
+	      {
+		errormsg("Invalid number of jobs: '%s'", opts.getarg());
+		return 1;
+	      }
+	  }
+	  break;
+
 	case 'V':
 	  version();
 	  break;
@@ -64,6 +137,34 @@ main(int argc, char **argv)
     }
 
   int retval = 0;
+  if (tree)
+    {
+      // Find the history files with p-files in the trees named (or
+      // under the current directory), and only read those.
+      std::vector<std::string> roots(opts.get_argv() + opts.get_index(),
+				     opts.get_argv() + opts.get_argc());
+      if (roots.empty())
+	roots.push_back(".");
+      std::vector<std::string> locked;
+      if (!find_locked_files(roots, jobs, &locked).ok())
+	retval = 1;
+      for (const auto& sfile : locked)
+	{
+	  try
+	    {
+	      sccs_name name;
+	      name = sfile;
+	      print_locks(name, true);
+	    }
+	  catch (CsscExitvalException e)
+	    {
+	      if (e.exitval > retval)
+		retval = e.exitval;
+	    }
+	}
+      return retval;
+    }
+
   sccs_file_iterator iter(opts);
   if (iter.empty())
     {
@@ -75,40 +176,7 @@ main(int argc, char **argv)
     {
       try
 	{
-	  sccs_name &name = iter.get_name();
-	  sccs_pfile pfile(name, sccs_pfile::pfile_mode::PFILE_READ);
-
-
-	  bool first = true;
-	  for (sccs_pfile::const_iterator it = pfile.begin();
-	       it != pfile.end();
-	       ++it)
-	    {
-	      if (first) // first lock on this file...
-		{
-		  /*
-		   * Before we print out the information about the
-		   * first lock on a given file. we may have to
-		   * identify which file we are talking about.  We
-		   * don't do this if only one file was specified on
-		   * the command line.
-		   */
-		  if (!iter.unique())
-		  {
-		    printf("\n%s:\n", name.c_str());
-		  }
-		  first = false;
-		}
-
-	      it->got.print(stdout);
-	      putchar(' ');
-	      it->delta.print(stdout);
-	      putchar(' ');
-	      fputs(it->user.c_str(), stdout);
-	      putchar(' ');
-	      it->date.print(stdout);
-	      putchar('\n');
-	    }
+	  print_locks(iter.get_name(), !iter.unique());
 	}
       catch (CsscExitvalException e)
 	{
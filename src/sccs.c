@@ -54,6 +54,8 @@ static const char filever[] = "$Id: sccs.c,v 1.44 2007/12/19 00:21:14 jay Exp $"
 #include <sys/wait.h>
 #include <sys/param.h>          /* TODO: this does what? */
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <signal.h>             /* TODO: consider using sigaction(). */
 #include <errno.h>              /* TODO: same as in parent directory. */
 #include <pwd.h>                /* getpwuid() */
@@ -69,6 +71,9 @@ static const char filever[] = "$Id: sccs.c,v 1.44 2007/12/19 00:21:14 jay Exp $"
 
 #include "dirent-safer.h"
 #include "progname.h"
+#ifdef CSSC_MULTICALL
+#include "multicall.h"
+#endif
 
 #ifndef _PATH_BSHELL
 #define _PATH_BSHELL "/bin/sh"
@@ -321,7 +326,7 @@ const struct sccsprog SccsProg[] =
 {
   {"admin", PROG, REALUSER, _PATH_SCCSADMIN, 0 },
   {"cdc", PROG, 0, _PATH_SCCSCDC, 0 },
-  {"comb", PROG, WARN_MISSING, _PATH_SCCSCOMB, 0 },
+  {"comb", PROG, REALUSER, _PATH_SCCSCOMB, 0 },
   {"delta", PROG, 0, _PATH_SCCSDELTA, 0 },
   {"get", PROG, 0, _PATH_SCCSGET, 0 },
   {"unget", PROG, 0, _PATH_SCCSUNGET, 0 },
@@ -421,6 +426,17 @@ show_version(void)
   fprintf(stderr, "%s from GNU CSSC %s\n%s\n", program_name, (VERSION), filever);
   fprintf(stderr, "SccsPath = '%s'\nSccsDir = '%s'\n", SccsPath, SccsDir);
   fprintf(stderr, "Default prefix for SCCS subcommands is '%s'\n", (PREFIX));
+#ifdef CSSC_MULTICALL
+  {
+    int i;
+    const char *name;
+
+    fprintf(stderr, "Built-in subcommands:");
+    for (i = 0; (name = cssc_builtin_name (i)) != NULL; i++)
+      fprintf(stderr, " %s", name);
+    fprintf(stderr, "\n");
+  }
+#endif
 }
 
 
@@ -531,29 +547,40 @@ check_data_integrity()
  */
 static void cleanup_environment(void)
 {
-  const char * binary_support = "CSSC_BINARY_SUPPORT";
-  const char * max_line_len   = "CSSC_MAX_LINE_LENGTH";
-#ifdef HAVE_UNSETENV
-  unsetenv(binary_support);
-  unsetenv(max_line_len);
-#else
-
-  /* XXX: not ideal.  We'd like just to turn them off, but
-   * if we have no unsetenv(), we simply have to fail.
+  /* The lock and statistics variables are here too: how long we wait
+   * for a lock, and which file we append statistics to, are not up to
+   * the invoking user either.
    */
-  pfail = getenv(binary_support);
-  if (NULL == pfail)
-    pfail = getenv(max_line_len);
+  static const char * const vars[] =
+    {
+      "CSSC_BINARY_SUPPORT",
+      "CSSC_MAX_LINE_LENGTH",
+      "CSSC_EXTENDED_SEQNO",
+      "CSSC_LOCK_TIMEOUT",
+      "CSSC_LOCK_STATS",
+      "CSSC_STATS",
+      "CSSC_STATS_FILE",
+    };
+  size_t i;
 
-  if (pfail)
+  for (i = 0; i < sizeof(vars) / sizeof(vars[0]); ++i)
     {
-      fprintf(stderr,
-              "You should not set the %s environment variable when "
-              "the sccs driver is running set-user-id or set-group-id.\n",
-              pfail);
-      exit(CSSC_EX_NOPERM);
-    }
+#ifdef HAVE_UNSETENV
+      unsetenv(vars[i]);
+#else
+      /* XXX: not ideal.  We'd like just to turn them off, but
+       * if we have no unsetenv(), we simply have to fail.
+       */
+      if (getenv(vars[i]))
+	{
+	  fprintf(stderr,
+		  "You should not set the %s environment variable when "
+		  "the sccs driver is running set-user-id or set-group-id.\n",
+		  vars[i]);
+	  exit(CSSC_EX_NOPERM);
+	}
 #endif
+    }
 }
 
 static void
@@ -936,6 +963,44 @@ try_to_exec(const char *prog, char * const argv[])
     }
 }
 
+#ifdef CSSC_MULTICALL
+/*
+   **  FUSE_DELGET -- decide whether delta can do "delget" by itself
+   **
+   **   Our own delta has a -T option, which makes it replace the
+   **   g-file with the version that "get -t" would retrieve.  Since
+   **   delta already has the text of the new delta, this avoids
+   **   reading the history file again.  We use this only with the
+   **   built-in delta (which we know has the option), and only if
+   **   none of the options meant for get were given.
+   **
+   **   Parameters:
+   **           argv -- the arguments of the delget command.
+   **
+   **   Returns:
+   **           TRUE if "delta -T" can be used instead of the macro.
+   **
+   **   Side Effects:
+   **           none.
+ */
+
+static bool
+fuse_delget (char *const argv[])
+{
+  int i;
+
+  if (subprogram_exec_prefix != NULL || !cssc_is_builtin ("delta"))
+    return FALSE;
+  for (i = 0; argv[i] != NULL; i++)
+    {
+      if (argv[i][0] == '-' && argv[i][1] != '\0'
+          && my_index ("ixbekcl", argv[i][1]) != NULL)
+        return FALSE;
+    }
+  return TRUE;
+}
+#endif
+
 /*
    **  COMMAND -- look up and perform a command
    **
@@ -1102,10 +1167,15 @@ command (char *argv[], bool forkflag, const char *arg0)
 
     case CMACRO:                /* command macro */
       {
-        const char *s;
+        const char *s = cmd->sccspath;
+
+#ifdef CSSC_MULTICALL
+        if (0 == strcmp (cmd->sccsname, "delget") && fuse_delget (&ap[1]))
+          s = "delta:mysrp -T";
+#endif
 
         /* step through & execute each part of the macro */
-        for (s = cmd->sccspath; *s != '\0'; s++)
+        for (; *s != '\0'; s++)
           {
             const char *qq = s;
             while (*s != '\0' && *s != '/')
@@ -1342,6 +1412,207 @@ do_fork(void)
 }
 
 
+/*
+   **  TRY_SERVER -- ask a csscd server to run a program
+   **
+   **   If $CSSC_SERVER names the socket of a csscd server, read-only
+   **   commands are sent to it instead of being run directly.  The
+   **   server keeps recently used history files parsed, which is a
+   **   lot faster when the same files are examined repeatedly.  The
+   **   server writes the output of the command directly to our
+   **   stdout (or OutFile) and stderr, which we pass to it.  See the
+   **   comment at the top of csscd.cc for a description of the
+   **   protocol.
+   **
+   **   Parameters:
+   **           progpath -- pathname of the program to call.
+   **           argv -- an argument vector to pass to the program.
+   **           status -- where to store the exit status.
+   **
+   **   Returns:
+   **           true if the server ran the command, false if the
+   **           program should be run in the usual way (for example
+   **           because no server is running, or it declined the
+   **           request).
+ */
+
+/* These must match the definitions in csscd.cc. */
+#define CSSCD_MAGIC "CSSC1"
+#define CSSCD_MAX_REQUEST (1024uL * 1024uL)
+
+static bool
+try_server (const char *progpath, char *const argv[], int *status)
+{
+  const char *server;
+  const char *prog;
+  struct sockaddr_un addr;
+  char *cwd, *request, *p;
+  size_t cwdsize, len;
+  int fds[2];
+  int sock, i, n;
+  union
+  {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE (2 * sizeof (int))];
+  } control;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char reply[32];
+  size_t got;
+
+  /* The server runs with its owner's privileges, so we never use it
+   * when running setuid.
+   */
+  if (!TrustEnvironment)
+    return FALSE;
+  server = getenv ("CSSC_SERVER");
+  if (NULL == server || '\0' == server[0]
+      || strlen (server) >= sizeof (addr.sun_path))
+    return FALSE;
+  prog = tail (progpath);
+  if (strcmp (prog, "get") && strcmp (prog, "prs") && strcmp (prog, "prt"))
+    return FALSE;
+
+  cwdsize = 256;
+  cwd = NULL;
+  for (;;)
+    {
+      cwd = realloc (cwd, cwdsize);
+      if (NULL == cwd)
+        return FALSE;
+      if (getcwd (cwd, cwdsize))
+        break;
+      if (errno != ERANGE)
+        {
+          free (cwd);
+          return FALSE;
+        }
+      cwdsize *= 2;
+    }
+
+  /* Build the request: a 4-byte length, then NUL-terminated strings. */
+  len = sizeof (CSSCD_MAGIC) + strlen (cwd) + 1;
+  for (i = 0; argv[i] != NULL; i++)
+    len += strlen (argv[i]) + 1;
+  if (len > CSSCD_MAX_REQUEST)
+    {
+      free (cwd);
+      return FALSE;
+    }
+  request = malloc (len + 4);
+  if (NULL == request)
+    {
+      free (cwd);
+      return FALSE;
+    }
+  request[0] = (char) ((len >> 24) & 0xFF);
+  request[1] = (char) ((len >> 16) & 0xFF);
+  request[2] = (char) ((len >> 8) & 0xFF);
+  request[3] = (char) (len & 0xFF);
+  p = request + 4;
+  strcpy (p, CSSCD_MAGIC);
+  p += sizeof (CSSCD_MAGIC);
+  strcpy (p, cwd);
+  p += strlen (cwd) + 1;
+  for (i = 0; argv[i] != NULL; i++)
+    {
+      strcpy (p, argv[i]);
+      p += strlen (argv[i]) + 1;
+    }
+  free (cwd);
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, server);
+  sock = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0)
+    {
+      free (request);
+      return FALSE;
+    }
+  if (connect (sock, (struct sockaddr *) &addr, sizeof (addr)) != 0)
+    {
+      /* No server; that's fine. */
+      close (sock);
+      free (request);
+      return FALSE;
+    }
+
+  fds[0] = (OutFile >= 0) ? OutFile : 1;
+  fds[1] = 2;
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = request;
+  iov.iov_len = len + 4;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (2 * sizeof (int));
+  memcpy (CMSG_DATA (cmsg), fds, 2 * sizeof (int));
+
+  /* The descriptors go with the first part of the request. */
+  p = request;
+  len += 4;
+  while (len > 0)
+    {
+      ssize_t sent = sendmsg (sock, &msg, 0);
+      if (sent < 0 && errno == EINTR)
+        continue;
+      if (sent <= 0)
+        break;
+      p += sent;
+      len -= (size_t) sent;
+      iov.iov_base = p;
+      iov.iov_len = len;
+      msg.msg_control = NULL;
+      msg.msg_controllen = 0;
+    }
+  free (request);
+  if (len > 0)
+    {
+      /* The server can't have started on an incomplete request. */
+      close (sock);
+      return FALSE;
+    }
+
+  got = 0;
+  while (got < sizeof (reply) - 1)
+    {
+      ssize_t r = read (sock, reply + got, sizeof (reply) - 1 - got);
+      if (r < 0 && errno == EINTR)
+        continue;
+      if (r <= 0)
+        break;
+      got += (size_t) r;
+      if (memchr (reply, '\n', got))
+        break;
+    }
+  close (sock);
+  reply[got] = '\0';
+
+  /* A server which hangs up without a word has not run anything. */
+  if (0 == got || 0 == strcmp (reply, "fallback\n"))
+    return FALSE;
+  if (1 == sscanf (reply, "exit %d", &n))
+    {
+      *status = n;
+      return TRUE;
+    }
+
+  /* The server may already have produced some output, so running
+   * the program ourselves could duplicate it.
+   */
+  fprintf (stderr, "%s: %s: lost contact with the server at %s\n",
+           program_name, argv[0], server);
+  *status = CSSC_EX_TEMPFAIL;
+  return TRUE;
+}
+
+
 /*
    **  CALLPROG -- call a program
    **
@@ -1369,6 +1640,7 @@ callprog (const char *progpath,
           bool forkflag)
 {
   register int i;
+  int served_status;
 
 #ifdef DEBUG
   if (Debug)
@@ -1382,6 +1654,18 @@ callprog (const char *progpath,
   if (*argv == NULL)
     return (-1);
 
+  if (try_server (progpath, argv, &served_status))
+    {
+      if (OutFile >= 0)
+        {
+          close (OutFile);
+          OutFile = -1;
+        }
+      if (!forkflag)
+        exit (served_status);
+      return (served_status);
+    }
+
   /*
      **  Fork if appropriate.
    */
@@ -1461,6 +1745,28 @@ callprog (const char *progpath,
       close (OutFile);
     }
 
+#ifdef CSSC_MULTICALL
+  /* If we contain the program, run it ourselves rather than
+   * executing it, unless the user has asked (with --prefix) for the
+   * programs in a particular directory.  Where we forked, we keep
+   * the separate process so that the program's exit, its changes to
+   * global state and any loss of privileges do not affect us.
+   */
+  if (NULL == subprogram_exec_prefix && cssc_is_builtin (tail (progpath)))
+    {
+      int argc;
+
+      /* Our unflushed output belongs to the parent, which will write
+       * it; exec would have discarded the child's copy of it too.
+       */
+      if (forkflag)
+        fpurge (stdout);
+      for (argc = 0; argv[argc] != NULL; argc++)
+        ;
+      exit (cssc_run_builtin (tail (progpath), argc, (char **) argv));
+    }
+#endif
+
   /* call real SCCS program */
   try_to_exec (progpath, argv);
   exit (CSSC_EX_UNAVAILABLE);
@@ -1671,6 +1977,72 @@ form_gname(char *buf, size_t bufsize, struct dirent *dir)
 }
 
 
+static int
+compare_names (const void *a, const void *b)
+{
+  return strcmp (*(char *const *) a, *(char *const *) b);
+}
+
+/*
+   **  LIST_PFILES -- find the p-files in a directory
+   **
+   **   Reads the whole directory once, and rewinds it afterward.
+   **   This lets the caller tell which s-files are being edited
+   **   without trying to open a p-file for every one of them.
+   **
+   **   Parameters:
+   **           dirp -- the open directory.
+   **           count -- set to the number of names returned.
+   **
+   **   Returns:
+   **           A sorted array of the names of the p-files, without
+   **           their "p." prefix.  The caller frees the names and
+   **           the array with free_pfile_list().
+ */
+static char **
+list_pfiles (DIR *dirp, size_t *count)
+{
+  struct dirent *dir;
+  char **names = NULL;
+  size_t used = 0, allocated = 0;
+
+  while (NULL != (dir = readdir (dirp)))
+    {
+      if ('p' != dir->d_name[0] ||
+	  '.' != dir->d_name[1] ||
+	  0 == dir->d_name[2])
+        continue;
+      if (used == allocated)
+	{
+	  char **bigger;
+	  allocated = allocated ? 2 * allocated : 16;
+	  bigger = realloc (names, allocated * sizeof (*names));
+	  if (NULL == bigger)
+	    oom ();
+	  names = bigger;
+	}
+      names[used] = strdup (dir->d_name + 2);
+      if (NULL == names[used])
+	oom ();
+      ++used;
+    }
+  if (used > 1)
+    qsort (names, used, sizeof (*names), compare_names);
+  rewinddir (dirp);
+  *count = used;
+  return names;
+}
+
+static void
+free_pfile_list (char **names, size_t count)
+{
+  size_t i;
+  for (i = 0; i < count; ++i)
+    free (names[i]);
+  free (names);
+}
+
+
 /*
    **  CLEAN -- clean out recreatable files
    **
@@ -1706,6 +2078,8 @@ do_clean (int mode, char *const *argv, char buf[FBUFSIZ])
   const char *usernm = NULL;
   const char *subdir = NULL;
   const char *cmdname;
+  char **pfiles;
+  size_t npfiles;
 
   /*
      **  Process the argv
@@ -1771,15 +2145,19 @@ do_clean (int mode, char *const *argv, char buf[FBUFSIZ])
    */
 
   gotedit = FALSE;
+  pfiles = list_pfiles (dirp, &npfiles);
   while (NULL != (dir = readdir (dirp)))
     {
+      const char *gname;
+
       if ('s' != dir->d_name[0] ||
 	  '.' != dir->d_name[1] ||
 	  0 == dir->d_name[2])
         continue;
 
       /* got an s. file -- see if the p. file exists */
-      gstrcat (buf, "/p.", FBUFSIZ);/* XXX: BUG: wrong size limit. */
+      *bufend = '\0';
+      gstrcat (buf, "/p.", FBUFSIZ);
       basefile = bufend + 3;
       form_gname(basefile, FBUFSIZ-strlen(buf), dir);
 
@@ -1787,10 +2165,16 @@ do_clean (int mode, char *const *argv, char buf[FBUFSIZ])
       /*
          **  open and scan the p-file.
          **   'gotpfent' tells if we have found a valid p-file
-         **           entry.
+         **           entry.  Most s-files have no p-file, so we
+         **           only open the ones we saw in the directory.
        */
 
-      pfp = fopen (buf, "r");
+      gname = basefile;
+      if (NULL == bsearch (&gname, pfiles, npfiles, sizeof (*pfiles),
+			   compare_names))
+	pfp = NULL;
+      else
+	pfp = fopen (buf, "r");
       gotpfent = FALSE;
       if (pfp != NULL)
         {
@@ -1824,6 +2208,7 @@ do_clean (int mode, char *const *argv, char buf[FBUFSIZ])
     }
 
   /* cleanup & report results */
+  free_pfile_list (pfiles, npfiles);
   closedir (dirp);
   if (!gotedit && mode == INFOC)
     {
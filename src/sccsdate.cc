@@ -93,6 +93,13 @@ is_leapyear(int year)
     }
 }
 
+// The number of days in the months before each month, in a year
+// which is not a leap year.
+static const int days_before_month[13] =
+  {
+    0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+  };
+
 static int
 days_in_month(int mon, int year)
 {
@@ -125,7 +132,9 @@ days_in_month(int mon, int year)
 static inline int
 is_digit(char ch)
 {
-  return isdigit(static_cast<unsigned char>(ch));
+  // isdigit() only accepts these characters in any locale, and
+  // this is cheaper.
+  return ch >= '0' && ch <= '9';
 }
 
 static inline int
@@ -147,6 +156,39 @@ get_two_digits(const std::string& s, size_t pos)
   return get_digit(s[pos]) * 10 + get_digit(s[pos+1]);
 }
 
+// Set *value from the two digits at s, if they are digits.
+static inline bool
+two_digits(const char *s, int *value)
+{
+  if (is_digit(s[0]) && is_digit(s[1]))
+    {
+      *value = (s[0] - '0') * 10 + (s[1] - '0');
+      return true;
+    }
+  return false;
+}
+
+// Write value (which must be less than 100) as two digits at p,
+// returning the position after them.
+static inline char *
+put_two_digits(char *p, int value)
+{
+  *p++ = static_cast<char>('0' + value / 10 % 10);
+  *p++ = static_cast<char>('0' + value % 10);
+  return p;
+}
+
+// Write a, b and c as two digits each, separated by sep, at p.
+static inline char *
+put_triple(char *p, int a, int b, int c, char sep)
+{
+  p = put_two_digits(p, a);
+  *p++ = sep;
+  p = put_two_digits(p, b);
+  *p++ = sep;
+  return put_two_digits(p, c);
+}
+
 static int
 get_part(const char *&s, int def)
 {
@@ -248,12 +290,64 @@ sccs_date::sccs_date(const char *s)
   update_yearday();
 }
 
+// Set the date from the fixed "yy/mm/dd" and "hh:mm:ss" layout used
+// in SCCS files and p-files, returning false (and leaving the date
+// invalid) if they are not in that layout.  If century is zero, the
+// two-digit year is windowed.
+bool
+sccs_date::set_from_fields(const char *date, const char *time, int century)
+{
+  int yy, mm, dd, hh, mi, ss;
+
+  // The "1" in the if() is just there to make Emacs align the columns.
+  if (1
+      && two_digits(&date[0], &yy) && date[2] == '/'
+      && two_digits(&date[3], &mm) && date[5] == '/'
+      && two_digits(&date[6], &dd) && date[8] == '\0'
+
+      && two_digits(&time[0], &hh) && time[2] == ':'
+      && two_digits(&time[3], &mi) && time[5] == ':'
+      && two_digits(&time[6], &ss) && time[8] == '\0')
+    {
+      if (century)
+      {
+          // SourceForge bug ID 513800 - Data General Unix uses 4-digit year
+          // in the p-file.
+          year_ = century * 100 + yy;
+	  ASSERT(year_ >= 1969);
+	  ASSERT(year_ <  2069);
+      }
+      else
+      {
+	// Year 2000 fix (mandated by X/Open white paper, see above
+	// for more details).
+	year_ = y2k_window(yy);
+      }
+      month_     = mm;
+      month_day_ = dd;
+      hour_      = hh;
+      minute_    = mi;
+      second_    = ss;
+      update_yearday();
+      return true;
+    }
+  return false;
+}
+
 // Construct a date as specified in an SCCS file.
 sccs_date::sccs_date(const char *date_arg, const char *time)
   : year_(-1), month_(-1), month_day_(-1),
     hour_(-1), minute_(-1), second_(-1),
     yearday_(-1)
 {
+  // Nearly every date we read is in the usual form, which we can
+  // parse in place.
+  if (is_digit(date_arg[0]) && is_digit(date_arg[1]) && date_arg[2] == '/')
+    {
+      set_from_fields(date_arg, time, 0);
+      return;
+    }
+
   std::string date(date_arg);
   int century;
 
@@ -300,86 +394,66 @@ sccs_date::sccs_date(const char *date_arg, const char *time)
       date[0] = static_cast<char>(date[0] - 10);
     }
 
-  // The "1" in the if() is just there to make Emacs align the columns.
-  if (1
-      && is_digit(date[0]) && is_digit(date[1]) && date[2] == '/'
-      && is_digit(date[3]) && is_digit(date[4]) && date[5] == '/'
-      && is_digit(date[6]) && is_digit(date[7]) && date[8] == 0
-
-      && is_digit(time[0]) && is_digit(time[1]) && time[2] == ':'
-      && is_digit(time[3]) && is_digit(time[4]) && time[5] == ':'
-      && is_digit(time[6]) && is_digit(time[7]) && time[8] == '\0')
-    {
-      year_      = get_two_digits(date, 0);
-      month_     = get_two_digits(date, 3);
-      month_day_ = get_two_digits(date, 6);
-
-      hour_      = get_two_digits(&time[0]);
-      minute_    = get_two_digits(&time[3]);
-      second_    = get_two_digits(&time[6]);
-
-      if (century)
-      {
-          // SourceForge bug ID 513800 - Data General Unix uses 4-digit year
-          // in the p-file.
-          year_ = century * 100 + year_;
-	  ASSERT(year_ >= 1969);
-	  ASSERT(year_ <  2069);
-      }
-      else
-      {
-	// Year 2000 fix (mandated by X/Open white paper, see above
-	// for more details).
-	year_ = y2k_window(year_);
-      }
-      update_yearday();
-    }
+  set_from_fields(date.c_str(), time, century);
 }
 
 cssc::Failure
 sccs_date::printf(FILE *f, char fmt) const
 {
   const int yy = year_ % 100;
+  int fields[3];
+  int nfields = 3;
+  char sep = '/';
 
   switch(fmt)
     {
     case 'D':
-      return fprintf_failure(fprintf(f, "%02d/%02d/%02d",
-				     yy, month_, month_day_));
+      fields[0] = yy;
+      fields[1] = month_;
+      fields[2] = month_day_;
+      break;
+
     case 'H':
-      return fprintf_failure(fprintf(f, "%02d/%02d/%02d",
-				     month_, month_day_, yy));
+      fields[0] = month_;
+      fields[1] = month_day_;
+      fields[2] = yy;
+      break;
 
     case 'T':
-      return fprintf_failure(fprintf(f, "%02d:%02d:%02d",
-				     hour_, minute_, second_));
-    }
+      fields[0] = hour_;
+      fields[1] = minute_;
+      fields[2] = second_;
+      sep = ':';
+      break;
 
-  int value = 0;
-  switch (fmt)
-    {
     case 'y':
-      value = yy;
+      nfields = 1;
+      fields[0] = yy;
       break;
 
     case 'o':
-      value = month_;
+      nfields = 1;
+      fields[0] = month_;
       break;
 
     case 'd':
-      value = month_day_;
+      nfields = 1;
+      fields[0] = month_day_;
       break;
 
     case 'h':
-      value = hour_;
+      nfields = 1;
+      fields[0] = hour_;
       break;
 
     case 'm':
-      value = minute_;
+      nfields = 1;
+      fields[0] = minute_;
       break;
 
     case 's':
-      value = second_;
+      nfields = 1;
+      fields[0] = second_;
       break;
 
     default:
@@ -389,30 +463,61 @@ sccs_date::printf(FILE *f, char fmt) const
 	.diagnose() << "sccs_date::printf: Invalid format letter '"
 		    << fmt << "'";
     }
-  return fprintf_failure(fprintf(f, "%02d", value));
+
+  if (!valid())
+    {
+      // The fields of an invalid date are -1, which we have always
+      // printed as "-1"; put_two_digits() can't do that.
+      if (1 == nfields)
+	return fprintf_failure(fprintf(f, "%02d", fields[0]));
+      return fprintf_failure(fprintf(f, "%02d%c%02d%c%02d",
+				     fields[0], sep, fields[1], sep,
+				     fields[2]));
+    }
+
+  char buf[8];
+  char *end;
+  if (1 == nfields)
+    end = put_two_digits(buf, fields[0]);
+  else
+    end = put_triple(buf, fields[0], fields[1], fields[2], sep);
+  const size_t len = end - buf;
+  return fwrite_failed(fwrite(buf, 1, len, f), len);
 }
 
 cssc::Failure
 sccs_date::print(FILE *f) const
 {
-  cssc::Failure fail = this->printf(f, 'D');
-  fail = Update(fail, fputc_failure(' ', f));
-  fail = Update(fail, this->printf(f, 'T'));
-  return fail;
+  if (!valid())
+    {
+      return fprintf_failure(fprintf(f, "%02d/%02d/%02d %02d:%02d:%02d",
+				     year_ % 100, month_, month_day_,
+				     hour_, minute_, second_));
+    }
+  char buf[17];
+  char *p = put_triple(buf, year_ % 100, month_, month_day_, '/');
+  *p++ = ' ';
+  p = put_triple(p, hour_, minute_, second_, ':');
+  return fwrite_failed(fwrite(buf, 1, sizeof(buf), f), sizeof(buf));
 }
 
 
 std::string
 sccs_date::as_string() const
 {
-  char buf[18];
-  const int yy = year_ % 100;
-
-  sprintf(buf, "%02d/%02d/%02d %02d:%02d:%02d",
-          yy, month_, month_day_,
-          hour_, minute_, second_);
-
-  return std::string(buf);
+  if (!valid())
+    {
+      char buf[72];
+      snprintf(buf, sizeof(buf), "%02d/%02d/%02d %02d:%02d:%02d",
+	       year_ % 100, month_, month_day_,
+	       hour_, minute_, second_);
+      return std::string(buf);
+    }
+  char buf[17];
+  char *p = put_triple(buf, year_ % 100, month_, month_day_, '/');
+  *p++ = ' ';
+  p = put_triple(p, hour_, minute_, second_, ':');
+  return std::string(buf, sizeof(buf));
 }
 
 sccs_date::sccs_date(int yr, int mth, int day,
@@ -430,6 +535,67 @@ sccs_date::sccs_date()
 {
 }
 
+namespace
+{
+  // Days from 1970-01-01 to the given date in the proleptic Gregorian
+  // calendar, and back again.  See Howard Hinnant's paper
+  // "chrono-Compatible Low-Level Date Algorithms".
+  long days_from_civil(long y, int m, int d)
+  {
+    y -= m <= 2;
+    const long era = (y >= 0 ? y : y - 399) / 400;
+    const long yoe = y - era * 400;
+    const long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+  }
+
+  void civil_from_days(long z, int *year, int *month, int *day)
+  {
+    z += 719468;
+    const long era = (z >= 0 ? z : z - 146096) / 146097;
+    const long doe = z - era * 146097;
+    const long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const long mp = (5 * doy + 2) / 153;
+    *day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    *month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    *year = static_cast<int>(yoe + era * 400 + (*month <= 2));
+  }
+
+  // Time zone offsets only change at a multiple of a quarter of an
+  // hour, so an offset found once holds for the rest of that quarter
+  // hour; this keeps us from calling localtime() (which may look at
+  // the time zone files each time) for every new date.
+  const time_t offset_period = 15 * 60;
+
+  bool local_offset(time_t t, long *offset)
+  {
+    static thread_local time_t cached_start = static_cast<time_t>(-1);
+    static thread_local long cached_offset = 0;
+
+    const time_t start = t - t % offset_period;
+    if (start != cached_start)
+      {
+#ifdef HAVE_LOCALTIME_R
+	struct tm local;
+	struct tm *ptm = localtime_r(&start, &local);
+#else
+	struct tm *ptm = localtime(&start);
+#endif
+	if (ptm == nullptr)
+	  return false;
+	const long local_secs =
+	  days_from_civil(ptm->tm_year + 1900L, ptm->tm_mon + 1, ptm->tm_mday)
+	  * 86400L + ptm->tm_hour * 3600L + ptm->tm_min * 60L + ptm->tm_sec;
+	cached_offset = local_secs - static_cast<long>(start);
+	cached_start = start;
+      }
+    *offset = cached_offset;
+    return true;
+  }
+}
+
 sccs_date
 sccs_date::now()                // static member.
 {
@@ -440,28 +606,37 @@ sccs_date::now()                // static member.
       errormsg_with_errno("unable to determine current time");
       throw CsscQuitException(2);
     }
-  struct tm *ptm = localtime(&tt);
-  if (ptm == nullptr)
+  long offset;
+  if (!local_offset(tt, &offset))
     {
       errormsg_with_errno("unable to determine local time");
       throw CsscQuitException(2);
     }
 
-  return sccs_date(ptm->tm_year+1900, ptm->tm_mon+1, ptm->tm_mday,
-                   ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
+  const long local = static_cast<long>(tt) + offset;
+  long days = local / 86400L;
+  long secs = local % 86400L;
+  if (secs < 0)
+    {
+      secs += 86400L;
+      --days;
+    }
+  int year, month, day;
+  civil_from_days(days, &year, &month, &day);
+  return sccs_date(year, month, day, static_cast<int>(secs / 3600),
+		   static_cast<int>(secs / 60 % 60), static_cast<int>(secs % 60));
 }
 
 void
 sccs_date::update_yearday()
 {
-  int m=1, d=1;
-
-  yearday_ = 1;
-
-  while (m < month_)
-    yearday_ += days_in_month(m++, year_);
-
-  while (d++ < month_day_)
+  if (month_ < 1 || month_ > 12)
+    {
+      yearday_ = -1;		// the date is not valid anyway.
+      return;
+    }
+  yearday_ = days_before_month[month_] + month_day_;
+  if (month_ > 2 && is_leapyear(year_))
     yearday_++;
 }
 
@@ -500,6 +675,17 @@ int sccs_date::compare(const sccs_date& d) const
     return second_ - d.second_;
 }
 
+long long sccs_date::packed() const
+{
+  if (!valid())
+    return -1;
+  // Each field fits in the bits below the next one: yearday_ is less
+  // than 512, hour_ less than 32, and minute_ and second_ less than 64.
+  return (static_cast<long long>(year_) << 26)
+    | (static_cast<long long>(yearday_) << 17)
+    | (hour_ << 12) | (minute_ << 6) | second_;
+}
+
 bool sccs_date::operator >(sccs_date const & d) const
 {
   return compare(d) > 0;
@@ -66,8 +66,14 @@ public:
   bool operator <(sccs_date const &) const;
   bool operator <=(sccs_date const &) const;
 
+  // A number which orders valid dates in the same way as the
+  // comparison operators do, for use as a sort key.  Invalid dates
+  // give -1.
+  long long packed() const;
+
 private:
   inline int compare(sccs_date const &) const;
+  bool set_from_fields(const char *date, const char *time, int century);
   void update_yearday();
 };
 
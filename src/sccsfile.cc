@@ -33,6 +33,8 @@
 
 #include "cssc.h"
 #include "sccsfile.h"
+#include "ancestry.h"
+#include "date-index.h"
 #include "delta-table.h"
 #include "delta-iterator.h"
 #include "linebuf.h"
@@ -111,7 +113,9 @@ sccs_file::sccs_file(sccs_name &n, sccs_file_open_mode m,
     name_(n), checksum_valid_(false), mode_(m), xfile_created_(false), edit_mode_ok_(true),
     sfile_executable_(false),
     delta_table_(make_unique_cssc_delta_table()),
-    body_scanner_(), users_(), comments_()
+    body_scanner_(), ancestry_(), dates_(), keep_indexes_(false),
+    sync_(nullptr),
+    users_(), comments_()
 {
   if (!name_.valid())
     {
@@ -420,6 +424,12 @@ sccs_file::is_delta_creator(const char *user, sid id) const
 }
 
 
+const cssc_delta_table& sccs_file::delta_table() const
+{
+  ASSERT(nullptr != delta_table_);
+  return *delta_table_;
+}
+
 const delta * sccs_file::find_delta(sid id) const
 {
   ASSERT(nullptr != delta_table_);
@@ -50,6 +50,9 @@ class FilePosSaver;             // filepos.h
 
 struct delta;
 class cssc_delta_table;
+class ancestry_index;            // ancestry.h
+class date_index;                // date-index.h
+class sync_group;                // sync-group.h
 class delta_iterator;
 
 struct get_status
@@ -123,7 +126,25 @@ public:
 		 sccs_pfile &pfile,
 		 sccs_pfile::iterator it,
                  const std::vector<std::string>& mrs, const std::vector<std::string>& comments,
-                 bool display_diff_output);
+                 bool display_diff_output, FILE *report);
+
+  // check_in performs all the per-file work of "delta" (finding the
+  // edit lock, checking MRs and authorisation, then add_delta).  If
+  // REPORT is not null, the new SID and the line counts are printed
+  // on it.
+  cssc::FailureOr<sid> check_in(sid rid, const std::string& gname,
+				const std::vector<std::string>& mrs,
+				bool suppress_mrs,
+				const std::vector<std::string>& comments,
+				bool display_diff_output, FILE *report);
+
+  // get_checked_in writes the version ID, just created by
+  // check_in() from the working file IN, to OUT as get would
+  // retrieve it, but by copying IN rather than reading the body of
+  // the history file again.  GNAME is the name of OUT.
+  cssc::FailureOr<get_status> get_checked_in(FILE *in, FILE *out,
+					     const std::string& gname,
+					     sid id, bool keywords);
 
   // TODO: return cssc::Failure instead of bool?
   bool admin(const char *file_comment,
@@ -153,6 +174,7 @@ public:
   // The caller must check edit_mode_permitted() before calling cdc().
   void cdc(delta*, const std::vector<std::string>& mrs, const std::vector<std::string>& comments);
   cssc::Failure rmdel(sid rid);
+  cssc::FailureOr<long> comb(const std::vector<bool>& wanted, bool rewrite);
   // TODO: return cssc::Failure instead of bool?
   bool validate() const;
 
@@ -170,6 +192,7 @@ public:
 
   /* Forwarding functions for the delta table.
    */
+  const cssc_delta_table& delta_table() const;
   const delta *find_delta(sid id) const;
   const delta *find_any_delta(sid id) const;
   delta *find_delta(sid id);
@@ -193,13 +216,23 @@ public:
   // TODO: return cssc::Failure instead of bool?
   bool update_checksum();
   // TODO: return cssc::Failure instead of bool?
-  bool update();
+  // If |compact_body| is true, rewrite the body with as few control
+  // lines as possible instead of copying it.
+  bool update(bool compact_body = false);
 
   /* sf-add.c */
 
   cssc::FailureOr<FILE*> start_update(struct delta const &new_delta);
   cssc::Failure end_update(FILE **out, struct delta const &new_delta);
 
+  // If GROUP is not null, end_update() syncs the new history file
+  // through it before putting it in place of the old one.
+  void set_sync_group(sync_group *group) { sync_ = group; }
+
+  // This object will answer many requests (as one kept by csscd
+  // does), so it is worth building the ancestry and date indexes.
+  void keep_indexes() { keep_indexes_ = true; }
+
   int mr_required() const
   {
     if (flags.mr_checker)
@@ -258,6 +291,10 @@ protected:
   void prepare_seqstate_1(seq_state &state, seq_no seq);
   void prepare_seqstate_2(seq_state &state, sid_list include,
                         sid_list exclude, sccs_date cutoff_date);
+  ancestry_index& ancestry();
+  const date_index& dates();
+  bool use_ancestry() const;
+  bool use_dates() const;
 
   /* sf-write.c */
   void xfile_error(const char *msg) const;
@@ -265,8 +302,12 @@ protected:
   cssc::Failure write_delta(FILE *out, struct delta const &delta) const;
   cssc::Failure write(FILE *out) const;
   // TODO: return cssc::Failure instead of bool?
-  cssc::Failure end_update(FILE **out);  // NB: this closes the x-file too.
+  // NB: end_update() closes the x-file too.  If known_sum is given,
+  // it is the checksum of the x-file, which we need not then compute.
+  cssc::Failure end_update(FILE **out,
+			   cssc::optional<int> known_sum = cssc::optional<int>());
   cssc::Failure rehack_encoded_flag(FILE *out, int *sum) const;
+  static cssc::FailureOr<int> checksum_so_far(FILE *out);
 
 private:
   /* sf-prs.c */
@@ -346,10 +387,18 @@ private:
   bool sfile_executable_;
   std::unique_ptr<cssc_delta_table> delta_table_;
   std::unique_ptr<sccs_file_body_scanner> body_scanner_;
+  std::unique_ptr<ancestry_index> ancestry_; // built when first needed.
+  std::unique_ptr<date_index> dates_;	     // likewise.
+  bool keep_indexes_;
+  sync_group *sync_;
   std::vector<std::string> users_;	// FIXME: consider something more efficient.
   std::vector<std::string> comments_;
 };
 
+/* sf-get.cc */
+cssc::Failure print_id_list(FILE *fp, const char *s,
+			    std::vector<sid> const &list);
+
 /* sf-prt.cc */
 cssc::Failure print_flag(FILE *out, const char *fmt,  release flag, int& count);
 cssc::Failure print_flag(FILE *out, const char *fmt, std::string flag, int& count);
@@ -125,9 +125,9 @@ public:
     // TODO: assert that it's locked?
     if (--lock_cnt_ == 0)
       {
-	// Releasing the unique_ptr deletes the lock object which
+	// Resetting the unique_ptr deletes the lock object which
 	// releases the lock.
-	lock_.release();
+	lock_.reset();
       }
   }
 
@@ -0,0 +1,222 @@
+/*
+ * sf-comb.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Members of the class sccs_file used for combing old deltas out of
+ * an SCCS file.
+ *
+ */
+
+#include <config.h>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "cssc.h"
+#include "ancestry.h"
+#include "body-scanner.h"
+#include "comb-plan.h"
+#include "date-index.h"
+#include "delta-table.h"
+#include "failure.h"
+#include "file.h"
+#include "ioerr.h"
+#include "sccsfile.h"
+
+using cssc::Failure;
+
+namespace
+{
+  // Copy the rest of |in| to |out|.
+  cssc::Failure
+  copy_rest(FILE *in, FILE *out)
+  {
+    char buf[8192];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), in)) != 0)
+      {
+	cssc::Failure wrote = fwrite_failed(fwrite(buf, 1, got, out), got);
+	if (!wrote.ok())
+	  return wrote;
+      }
+    if (ferror(in))
+      return cssc::make_failure_from_errno(errno);
+    return cssc::Failure::Ok();
+  }
+
+  cssc::FailureOr<long>
+  file_size(FILE *f)
+  {
+    if (fflush_failed(fflush(f)))
+      return cssc::make_failure_from_errno(errno);
+    const long size = ftell(f);
+    if (size < 0)
+      return cssc::make_failure_from_errno(errno);
+    return size;
+  }
+}
+
+
+/* Rewrite the file with only the deltas in |wanted| (indexed by
+ * serial number) and the branch points between them; see comb-plan.h.
+ * We write the new body to a temporary file first, since we need the
+ * line counts of the kept deltas before we can write the delta table.
+ * If |rewrite| is false we leave the file as it is.  Either way, the
+ * result is the size of the new file.
+ */
+cssc::FailureOr<long>
+sccs_file::comb(const std::vector<bool>& wanted, bool rewrite)
+{
+  if (rewrite)
+    {
+      cssc::Failure can_edit = edit_mode_permitted(true);
+      if (!can_edit.ok())
+	return can_edit;
+    }
+
+  auto refuse = [this](const char *why) -> cssc::Failure
+    {
+      return cssc::make_failure_builder(cssc::errorcode::OperationFailed)
+	.diagnose() << name_.sfile() << ": " << why;
+    };
+  ancestry_index& index = ancestry();
+  if (index.has_seq_lists())
+    return refuse("cannot comb a file with included, excluded "
+		  "or ignored deltas");
+  const seq_no highest = delta_table_->highest_seqno();
+  for (seq_no s = 1; s <= highest; ++s)
+    {
+      if (delta_table_->delta_at_seq_exists(s) && !index.chain_ok(s))
+	return refuse("the delta table is corrupt");
+    }
+
+  const comb_plan plan(*delta_table_, wanted);
+  if (0 == plan.kept())
+    return refuse("no deltas would be kept");
+
+  std::unique_ptr<FILE, int (*)(FILE*)> body(tmpfile(), fclose);
+  if (!body)
+    {
+      return cssc::make_failure_builder_from_errno(errno)
+	.diagnose() << "cannot create a temporary file";
+    }
+  cssc::FailureOr<comb_result> combed = body_scanner_->comb(body.get(), plan);
+  if (!combed.ok())
+    return combed.fail();
+  const comb_result& counts = *combed;
+
+  // The kept deltas, with their new serial numbers and line counts.
+  // The delta table is written with the latest delta first.
+  std::unique_ptr<cssc_delta_table> table = make_unique_cssc_delta_table();
+  std::vector<unsigned long> visible(plan.kept() + 1u, 0uL);
+  std::vector<delta> kept;
+  for (seq_no s = 1; s <= plan.kept(); ++s)
+    {
+      delta d = delta_table_->delta_at_seq(plan.old_seq(s));
+      const seq_no prev = plan.new_prev(s);
+      d.set_seq(s);
+      d.set_prev_seq(prev);
+      visible[s] = visible[prev] + counts.inserted[s] - counts.deleted[s];
+      d.set_idu(counts.inserted[s], counts.deleted[s],
+		visible[prev] - counts.deleted[s]);
+      kept.push_back(d);
+    }
+  for (auto it = kept.rbegin(); it != kept.rend(); ++it)
+    table->add(*it);
+  delta_table_ = std::move(table);
+  ancestry_.reset();
+  dates_.reset();
+
+  cssc::FailureOr<long> body_size = file_size(body.get());
+  if (!body_size.ok())
+    {
+      return cssc::make_failure_builder(body_size.fail())
+	.diagnose() << "write error on a temporary file";
+    }
+
+  if (!rewrite)
+    {
+      std::unique_ptr<FILE, int (*)(FILE*)> header(tmpfile(), fclose);
+      if (!header)
+	{
+	  return cssc::make_failure_builder_from_errno(errno)
+	    .diagnose() << "cannot create a temporary file";
+	}
+      cssc::Failure wrote = write(header.get());
+      if (!wrote.ok())
+	{
+	  return cssc::make_failure_builder(wrote)
+	    .diagnose() << "write error on a temporary file";
+	}
+      cssc::FailureOr<long> header_size = file_size(header.get());
+      if (!header_size.ok())
+	{
+	  return cssc::make_failure_builder(header_size.fail())
+	    .diagnose() << "write error on a temporary file";
+	}
+      // The header does not include the checksum line, "^Ahnnnnn".
+      return *header_size + 8L + *body_size;
+    }
+
+  cssc::FailureOr<FILE*> fof = start_update();
+  if (!fof.ok())
+    return fof.fail();
+  FILE *out = *fof;
+
+  cssc::Failure wrote = write(out);
+  if (!wrote.ok())
+    {
+      return cssc::make_failure_builder(wrote)
+	.diagnose() << "write error on " << name_.xfile();
+    }
+  cssc::FailureOr<int> header_sum = checksum_so_far(out);
+  if (!header_sum.ok())
+    {
+      return cssc::make_failure_builder(header_sum.fail())
+	.diagnose() << "failed to read back " << name_.xfile();
+    }
+
+  rewind(body.get());
+  cssc::Failure copied = copy_rest(body.get(), out);
+  if (!copied.ok())
+    {
+      return cssc::make_failure_builder(copied)
+	.diagnose() << "write error on " << name_.xfile();
+    }
+  cssc::FailureOr<long> size = file_size(out);
+  if (!size.ok())
+    {
+      return cssc::make_failure_builder(size.fail())
+	.diagnose() << "write error on " << name_.xfile();
+    }
+
+  cssc::Failure updated =
+    end_update(&out, (*header_sum + counts.body_sum) & 0xFFFF);
+  if (!updated.ok())
+    {
+      return cssc::make_failure_builder(updated)
+	.diagnose() << "failed to complete update";
+    }
+  ASSERT(out == NULL);
+  return *size;
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,106 @@
+/*
+ * sf-delget.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Members of the class sccs_file used for retrieving a delta just
+ * after it has been made ("delta -T").
+ *
+ */
+
+#include <config.h>
+
+#include <cerrno>
+#include <string>
+
+#include "cssc.h"
+#include "sccsfile.h"
+#include "delta.h"
+#include "linebuf.h"
+#include "ioerr.h"
+#include "subst-parms.h"
+
+
+/* The text of a new delta is exactly the content of the working file
+   it was made from, so we can produce what get would retrieve by
+   copying that file.  For an encoded file the body holds the encoded
+   form, and get decodes it again without substituting keywords, so
+   the content is copied unchanged.  Otherwise we substitute keywords
+   line by line, just as sccs_file_body_scanner::get() does. */
+cssc::FailureOr<get_status>
+sccs_file::get_checked_in(FILE *in, FILE *out, const std::string& gname,
+			  sid id, bool keywords)
+{
+  const delta *d = find_delta(id);
+  ASSERT(d != NULL);
+
+  get_status status;
+  if (flags.encoded || !keywords)
+    {
+      char buf[BUFSIZ];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+	{
+	  cssc::Failure wrote = fwrite_failed(fwrite(buf, 1, n, out), n);
+	  if (!wrote.ok())
+	    return cssc::make_failure_builder(wrote)
+	      << "failed to write to " << gname;
+	}
+      if (ferror(in))
+	return cssc::make_failure_from_errno(errno);
+      // get counts the lines of the body, which for an encoded file
+      // are the lines of the encoded form.
+      status.lines = d->inserted() + d->unchanged();
+      return status;
+    }
+
+  struct subst_parms parms(gname, get_module_name(), out,
+			   cssc::optional<std::string>(), *d,
+			   0, sccs_date::now());
+  cssc_linebuf linebuf;
+  for (;;)
+    {
+      cssc::Failure read = linebuf.read_line(in);
+      if (!read.ok())
+	{
+	  if (isEOF(read))
+	    break;
+	  return read;
+	}
+      // check_in() would have failed on a file without a final newline.
+      const size_t len = strlen(linebuf.c_str());
+      ASSERT(len > 0 && linebuf[len - 1] == '\n');
+      linebuf.set_char(len - 1, '\0');
+
+      parms.out_lineno++;
+      cssc::Failure wrote = write_subst(linebuf.c_str(), &parms, *d, false);
+      if (wrote.ok() && fputc_failed(fputc('\n', out)))
+	wrote = cssc::make_failure_from_errno(errno);
+      if (!wrote.ok())
+	return cssc::make_failure_builder(wrote)
+	  << "failed to write to " << gname;
+    }
+
+  // check_in() has already warned if there are no keywords, so we
+  // don't repeat that.
+  status.lines = parms.out_lineno;
+  return status;
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -86,9 +86,34 @@ public:
 
 
 
-/* Adds a new delta to the SCCS file.  It doesn't add the delta to the
-   delta list in sccs_file object, so this should be the last operation
-   performed before the object is destroyed. */
+/* Check that we may give a new delta the serial number SEQ, and if
+ * not, say why.
+ */
+static bool
+new_seqno_ok(const char *name, seq_no seq)
+{
+  if (0 == seq)			// we went past max_seq_no.
+    {
+      errormsg("%s: This file already has as many deltas as CSSC "
+	       "can handle.", name);
+      return false;
+    }
+  if (seq > classic_max_seq_no && !extended_seqno_allowed())
+    {
+      errormsg("%s: The new delta would have serial number %u, but SCCS "
+	       "does not allow serial numbers beyond %u.  Set "
+	       "CSSC_EXTENDED_SEQNO=enabled to allow them (other "
+	       "implementations of SCCS will not be able to read the file).",
+	       name, seq, classic_max_seq_no);
+      return false;
+    }
+  return true;
+}
+
+/* Adds a new delta to the SCCS file.  The new delta is added to the
+   delta table of the sccs_file object, but the object still reads the
+   body of the old file, so apart from get_checked_in() this should be
+   the last operation performed before the object is destroyed. */
 
 bool
 sccs_file::add_delta(const std::string& gname,
@@ -96,7 +121,7 @@ sccs_file::add_delta(const std::string& gname,
 		     sccs_pfile::iterator it,
                      const std::vector<std::string>& new_mrs,
 		     const std::vector<std::string>& new_comments,
-                     bool display_diff_output)
+                     bool display_diff_output, FILE *report)
 {
   ASSERT(mode_ == UPDATE);
 
@@ -298,6 +323,8 @@ sccs_file::add_delta(const std::string& gname,
           // add a new automatic "null" release.  Use the same
           // MRs as for the actual delta (is that right?) but
           seq_no new_seq = delta_table_->next_seqno();
+	  if (!new_seqno_ok(name_.c_str(), new_seq))
+	    return false;
 
           // Set up for adding the next release.
           id = null_rel;
@@ -322,6 +349,8 @@ sccs_file::add_delta(const std::string& gname,
     }
   // assign a sequence number.
   seq_no new_seq = delta_table_->next_seqno();
+  if (!new_seqno_ok(name_.c_str(), new_seq))
+    return false;
 
 #if 1
   /* 2002-03-21: James Youngman: we already did this, above */
@@ -364,8 +393,11 @@ sccs_file::add_delta(const std::string& gname,
   ASSERT (new_delta.deleted() == 0);
   ASSERT (new_delta.unchanged() == 0);
 
-  new_delta.id().print(stdout);
-  printf("\n");
+  if (report)
+    {
+      new_delta.id().print(report);
+      fputc('\n', report);
+    }
 
   // Begin the update by writing out the new delta.
   // This also writes out the information for all the
@@ -403,9 +435,13 @@ sccs_file::add_delta(const std::string& gname,
       errormsg("failed to complete update of %s", updated.to_string().c_str());
       return false;
     }
+  delta_table_->prepend(new_delta);
 
-  printf("%lu inserted\n%lu deleted\n%lu unchanged\n",
-         new_delta.inserted(), new_delta.deleted(), new_delta.unchanged());
+  if (report)
+    {
+      fprintf(report, "%lu inserted\n%lu deleted\n%lu unchanged\n",
+	      new_delta.inserted(), new_delta.deleted(), new_delta.unchanged());
+    }
 
   if (pfile.update(true).ok())
     return true;
@@ -414,6 +450,104 @@ sccs_file::add_delta(const std::string& gname,
 }
 
 
+/* Performs the work of "delta" for one history file: finds the
+   edit lock for RID in the p-file, checks the MRs and the list of
+   authorised users, and adds the delta.  Returns the SID of the new
+   delta. */
+
+cssc::FailureOr<sid>
+sccs_file::check_in(sid rid, const std::string& gname,
+		    const std::vector<std::string>& mrs, bool suppress_mrs,
+		    const std::vector<std::string>& comments,
+		    bool display_diff_output, FILE *report)
+{
+  sccs_pfile pfile(name_, sccs_pfile::pfile_mode::PFILE_UPDATE);
+
+  const std::pair<sccs_pfile::find_status, sccs_pfile::iterator> found(pfile.find_sid(rid));
+  switch (found.first) {
+  case sccs_pfile::find_status::FOUND:
+    break;
+
+  case sccs_pfile::find_status::NOT_FOUND:
+    if (!rid.valid())
+      {
+	errormsg("%s: You have no edits outstanding.",
+		 name_.c_str());
+      }
+    else
+      {
+	errormsg("%s: Specified SID hasn't been locked for"
+		 " editing by you.",
+		 name_.c_str());
+      }
+    return cssc::make_failure(cssc::errorcode::EditNotLocked);
+
+  case sccs_pfile::find_status::AMBIGUOUS:
+    if (rid.valid())
+      {
+	errormsg("%s: Specified SID is ambiguous.",
+		 name_.c_str());
+      }
+    else
+      {
+	errormsg("%s: You must specify a SID on the"
+		 " command line.", name_.c_str());
+      }
+    return cssc::make_failure(cssc::errorcode::EditLockAmbiguous);
+
+  default:
+    abort();
+  }
+
+  const sid new_sid = found.second->delta;
+  if (!suppress_mrs && mr_required())
+    {
+      if (mrs.empty())
+	{
+	  errormsg("%s: MR number(s) must be supplied.",
+		   name_.c_str());
+	  return cssc::make_failure(cssc::errorcode::InvalidMRList);
+	}
+      if (check_mrs(mrs))
+	{
+	  /* In this case, _real_ SCCS prints the ID anyway.
+	   */
+	  if (report)
+	    {
+	      new_sid.print(report);
+	      fputc('\n', report);
+	    }
+	  errormsg("%s: Invalid MR number(s).",
+		   name_.c_str());
+	  return cssc::make_failure(cssc::errorcode::InvalidMRList);
+	}
+    }
+  else if (!mrs.empty())
+    {
+      // MRs were specified and the MR flag is turned off.
+      if (report)
+	{
+	  new_sid.print(report);
+	  fputc('\n', report);
+	}
+      errormsg("%s: MR verification ('v') flag not set, MRs"
+	       " are not allowed.\n",
+	       name_.c_str());
+      return cssc::make_failure(cssc::errorcode::InvalidMRList);
+    }
+
+  // The check that authorised() makes cannot fail, since it
+  // is a lookup on an in-memory data structure.  It
+  // issues its own error message.
+  if (!authorised())
+    return cssc::make_failure(cssc::errorcode::UserNotAuthorised);
+  if (!add_delta(gname, pfile, found.second, mrs, comments,
+		 display_diff_output, report))
+    return cssc::make_failure(cssc::errorcode::OperationFailed);
+  return new_sid;
+}
+
+
 std::unique_ptr<delta> make_unique_delta()
 {
 #if __cplusplus >= 201402L
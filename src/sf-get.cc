@@ -28,6 +28,7 @@
 
 #include <config.h>
 
+#include <cerrno>
 #include <cstdlib>
 #include <string>
 using std::string;
@@ -38,10 +39,13 @@ using std::string;
 #include "sccsfile.h"
 #include "pfile.h"
 #include "seqstate.h"
+#include "ancestry.h"
 #include "delta.h"
 #include "delta-table.h"
 #include "linebuf.h"
 #include "bodyio.h"
+#include "ioerr.h"
+#include "subst-parms.h"
 
 // We use @LIBOBJS@ instead now...
 // #ifndef HAVE_STRSTR
@@ -55,9 +59,27 @@ sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)
 
   seq_no y;
 
+  // A single get walks the chain; building the index would cost more.
+  ancestry_index *index = use_ancestry() ? &ancestry() : nullptr;
+
   // deltas descended from the version we want are wanted (unless excluded)
   y = seq;
-  do
+  if (index && index->chain_ok(seq))
+    {
+      const seq_set chain = index->ancestors(seq);
+      for (seq_set::size_type w = 0; w < chain.size(); ++w)
+	{
+	  unsigned bit = 0;
+	  for (std::uint64_t word = chain[w]; word; word >>= 1, ++bit)
+	    {
+	      if (word & 1u)
+		state.set_included(seq_no(w * 64u + bit), false);
+	    }
+	}
+      y = 0;
+      state.set_included(y, false);
+    }
+  else do
     {
       ASSERT(y <= seq);
       if (!delta_table_->delta_at_seq_exists(y)) {
@@ -75,8 +97,12 @@ sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)
     } while (y > 0);
   state.set_included(seq, false);
 
+  // Without any include, exclude or ignore lists in the file, the
+  // chain is all there is to it.
+  const bool have_lists = !index || index->has_seq_lists();
+
   // Apply any inclusions
-  for (y=seq; y>0; --y)
+  for (y=seq; have_lists && y>0; --y)
     {
       if (state.is_included(y))
 	{
@@ -86,7 +112,7 @@ sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)
 	    {
 	      const std::vector<seq_no>::size_type len = d.get_included_seqnos().size();
 	      fprintf(stderr,
-		      "seq %d includes %lu other deltas...\n",
+		      "seq %u includes %lu other deltas...\n",
 		      y, static_cast<unsigned long>(len));
 	    }
 
@@ -105,7 +131,7 @@ sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)
     }
 
   // Apply any exclusions
-  for (y=1; y<=seq; ++y)
+  for (y=1; have_lists && y<=seq; ++y)
     {
       if (state.is_included(y))
       {
@@ -115,7 +141,7 @@ sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)
 	  {
 	    const std::vector<seq_no>::size_type len = d.get_excluded_seqnos().size();
 	    fprintf(stderr,
-		    "seq %d excludes %lu other deltas...\n",
+		    "seq %u excludes %lu other deltas...\n",
 		    y, static_cast<unsigned long>(len));
 	  }
 
@@ -138,7 +164,7 @@ sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)
   // These are not recursive, so for example if version 1.6 ignored
   // version 1.2, the body lines for 1.1 will still be included.
   // (but what about any includes or excludes?)
-  for (y=seq; y>0; --y)
+  for (y=seq; have_lists && y>0; --y)
     {
       if (state.is_included(y))
 	{
@@ -147,7 +173,7 @@ sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)
 	    {
 	      const std::vector<seq_no>::size_type len = d.get_ignored_seqnos().size();
 	      fprintf(stderr,
-		      "seq %d ignores %lu other deltas...\n",
+		      "seq %u ignores %lu other deltas...\n",
 		      y, static_cast<unsigned long>(len));
 	    }
 
@@ -179,7 +205,7 @@ sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)
 	  else
 	    msg = "excluded";
 
-	  fprintf(stderr, "seq_no %d: %s\n", y, msg);
+	  fprintf(stderr, "seq_no %u: %s\n", y, msg);
 	}
       fprintf(stderr,
               "sccs_file::prepare_seqstate_1(seq_state &state, seq_no seq)"
@@ -219,6 +245,190 @@ sccs_file::do_get(const string& gname,
 			    do_kw_subst, debug, show_module, show_sid);
 }
 
+/* Output the specified version to a file with possible modifications.
+   Most of the actual work is done with a seqstate object that
+   figures out whether or not given line of the SCCS file body
+   should be included in the output file. */
+cssc::FailureOr<get_status>
+sccs_file::get(FILE *out, const std::string& gname,
+	       FILE *summary_file,
+	       sid id, sccs_date cutoff_date,
+               sid_list include, sid_list exclude,
+               bool keywords, cssc::optional<std::string> wstring,
+               bool show_sid, bool show_module, bool debug,
+	       bool for_edit)
+{
+  ASSERT(nullptr != delta_table_);
+
+  seq_state state(highest_delta_seqno());
+  const delta *d = find_delta(id);
+  ASSERT(d != NULL);
+
+  ASSERT(nullptr != delta_table_);
+
+  cssc::Failure edit_allowed = edit_mode_permitted(for_edit);
+  if (!edit_allowed.ok())	// "get -e" on BK files is not allowed
+    return edit_allowed;
+
+  prepare_seqstate(state, d->seq(), include, exclude, cutoff_date);
+
+  // Fix by Mark Fortescue.
+  // Fix Cutoff Date Problem
+  const delta *dparm;
+  bool set=false;
+
+  for (seq_no s = d->seq(); s>0; s--)
+    {
+      if (delta_table_->delta_at_seq_exists(s))
+	{
+	    const struct delta & del = delta_table_->delta_at_seq(s);
+
+	    if (!state.is_excluded(s) && !set)
+	      {
+		dparm = find_delta(del.id());
+		set = true;
+	      }
+	}
+    }
+  if ( !set ) dparm = d;
+  // End of fix
+
+  if (getenv("CSSC_SHOW_SEQSTATE"))
+    {
+      for (seq_no s = d->seq(); s>0; s--)
+        {
+          if (!delta_table_->delta_at_seq_exists(s))
+            {
+              /* skip non-existent seq number */
+              continue;
+            }
+
+          fprintf(stderr, "%4d (", s);
+          delta_table_->delta_at_seq(s).id().dprint(stderr);
+          fprintf(stderr, ") ");
+
+          if (state.is_explicitly_tagged(s))
+            {
+              fprintf(stderr, "explicitly ");
+            }
+
+          if (state.is_ignored(s))
+            {
+              fprintf(stderr, "ignored\n");
+            }
+          else if (state.is_included(s))
+            {
+              fprintf(stderr, "included\n");
+            }
+          else if (state.is_excluded(s))
+            {
+              fprintf(stderr, "excluded");
+            }
+          else
+            {
+              fprintf(stderr, "irrelevant\n");
+            }
+        }
+    }
+
+  if (summary_file)
+    {
+      bool first = true;
+
+      for (seq_no s = d->seq(); s>0; s--)
+        {
+          if (delta_table_->delta_at_seq_exists(s)
+	      && state.is_included(s))
+	    {
+	      const struct delta & it = delta_table_->delta_at_seq(s);
+
+	      fprintf (summary_file, "%s    ",
+		       first ? "" : "\n");
+	      first = false;
+	      it.id().print(summary_file);
+	      fprintf (summary_file, "\t");
+	      it.date().print(summary_file);
+	      fprintf (summary_file, " %s\n", it.user().c_str());
+
+	      for (const std::string& comment : it.comments())
+		{
+		  fprintf (summary_file, "\t%s\n", comment.c_str());
+		}
+	    }
+	}
+      fputc ('\n', summary_file);
+    }
+
+
+
+  // The subst_parms here may not be the Whole Truth since
+  // the cutoff date may affect which version is actually
+  // gotten.  That's taken care of; the correct delta is
+  // passed as a parameter to the substitution function.
+  // (eugh...)
+  // Changed to use dparm not d to deal with Cutoff Date (Mark Fortescue)
+  struct subst_parms parms(gname, get_module_name(),
+			   out, wstring, *dparm,
+                           0, sccs_date::now());
+
+
+  cssc::Failure got = do_get(gname, state, parms, keywords, show_sid, show_module, debug,
+			     false, false);
+  if (!got.ok())
+    {
+      // TODO: verify whether or not we need to delete the g-file.
+      return got;
+    }
+
+  // only issue a warning about there being no keywords
+  // substituted, IF keyword substitution was being done.
+  if (keywords && !parms.found_id)
+    {
+      no_id_keywords(name_.c_str());
+      // this function normally returns.
+    }
+
+  /* Set the return status. */
+  struct get_status goodstatus;
+  goodstatus.lines = parms.out_lineno;
+
+  seq_no seq;
+  for(seq = 1; seq <= highest_delta_seqno(); seq++)
+    {
+      if (state.is_explicitly_tagged(seq))
+        {
+          const sid id_of_this_seq = seq_to_sid(seq);
+
+          if (state.is_included(seq))
+            goodstatus.included.push_back(id_of_this_seq);
+          else if (state.is_excluded(seq))
+            goodstatus.excluded.push_back(id_of_this_seq);
+        }
+    }
+  return goodstatus;
+}
+
+/* Prints a list of included or excluded SIDs. */
+
+cssc::Failure
+print_id_list(FILE *fp, const char *s, std::vector<sid> const &list)
+{
+  cssc::Failure status;
+  if (!list.empty())
+    {
+      if (fprintf_failed(fprintf(fp, "%s:\n", s)))
+	status = cssc::Update(status, cssc::make_failure_from_errno(errno));
+
+      for (const auto& sid : list)
+        {
+	  status = cssc::Update(status, sid.print(fp));
+          if (fputc_failed(fputc('\n', fp)))
+	    status = cssc::Update(status, cssc::make_failure_from_errno(errno));
+        }
+    }
+  return status;
+}
+
 /* Local variables: */
 /* mode: c++ */
 /* End: */
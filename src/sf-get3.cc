@@ -33,8 +33,51 @@
 #include "cssc.h"
 #include "sccsfile.h"
 #include "seqstate.h"
+#include "ancestry.h"
+#include "date-index.h"
 #include "delta-iterator.h"
 #include "file.h"
+#include "stats.h"
+
+/* The indexes are built when first needed.  They remain correct for
+ * the deltas they knew about, since adding a delta changes neither
+ * the predecessors nor the dates of existing ones, so we rebuild them
+ * only when the delta table has grown.
+ */
+ancestry_index&
+sccs_file::ancestry()
+{
+  if (!ancestry_ || ancestry_->highest_seqno() != delta_table_->highest_seqno())
+    ancestry_.reset(new ancestry_index(*delta_table_));
+  return *ancestry_;
+}
+
+const date_index&
+sccs_file::dates()
+{
+  if (!dates_ || dates_->highest_seqno() != delta_table_->highest_seqno())
+    dates_.reset(new date_index(*delta_table_));
+  return *dates_;
+}
+
+// True if an index is worth asking: if it is already built, or if
+// this object will answer many requests (see keep_indexes()).  For a
+// single question, walking the delta table is cheaper than building
+// an index.
+bool
+sccs_file::use_ancestry() const
+{
+  return keep_indexes_
+    || (ancestry_ && ancestry_->highest_seqno() == delta_table_->highest_seqno());
+}
+
+bool
+sccs_file::use_dates() const
+{
+  return keep_indexes_
+    || (dates_ && dates_->highest_seqno() == delta_table_->highest_seqno());
+}
+
 
 /* Prepare a seqstate for use by marking which sequence numbers are to
  * be included and which are to be excluded.
@@ -46,6 +89,33 @@ sccs_file::prepare_seqstate_2(seq_state &state, sid_list include,
 {
 
   ASSERT(nullptr != delta_table_);
+  // This is the usual case, and there is nothing to do.
+  if (include.empty() && exclude.empty() && !cutoff_date.valid())
+    return;
+
+  // Unless the index is worth asking, we compare the date of each
+  // delta as we go.
+  const bool indexed = cutoff_date.valid() && use_dates();
+  seq_set later;
+  if (indexed)
+    later = dates().later_than(cutoff_date);
+
+  if (indexed && include.empty() && exclude.empty())
+    {
+      // Only the cutoff date matters.
+      for (seq_set::size_type w = 0; w < later.size(); ++w)
+	{
+	  unsigned bit = 0;
+	  for (std::uint64_t word = later[w]; word; word >>= 1, ++bit)
+	    {
+	      const seq_no s = seq_no(w * 64u + bit);
+	      if ((word & 1u) && !delta_table_->delta_at_seq(s).removed())
+		state.set_excluded(s);
+	    }
+	}
+      return;
+    }
+
   const_delta_iterator iter(delta_table_.get(), delta_selector::current);
 
   while (iter.next())
@@ -60,7 +130,9 @@ sccs_file::prepare_seqstate_2(seq_state &state, sid_list include,
         {
           state.set_explicitly_excluded(iter->seq());
         }
-      else if (cutoff_date.valid() && iter->date() > cutoff_date)
+      else if (indexed
+	       ? ancestry_index::member(later, iter->seq())
+	       : (cutoff_date.valid() && iter->date() > cutoff_date))
         {
           // Delta not explicitly included/excluded by the user, but
           // if it is newer than the cutoff date, we don't want it.
@@ -79,6 +151,7 @@ void sccs_file::prepare_seqstate(seq_state &state, seq_no seq,
                                  sid_list include,
                                  sid_list exclude, sccs_date cutoff_date)
 {
+    stats_timer timer(stats_phase::seqstate);
     prepare_seqstate_1(state, seq);
     prepare_seqstate_2(state, include, exclude, cutoff_date);
 }
@@ -38,6 +38,8 @@
 #include "delta-iterator.h"
 #include "delta-table.h"
 #include "linebuf.h"
+#include "ancestry.h"
+#include "date-index.h"
 #include "cssc-assert.h"
 #include "subst-parms.h"
 
@@ -693,9 +695,15 @@ sccs_file::prs(FILE *out, const char *outname,
     }
   else if (cutoff_type == when::LATER)
     {
+      const bool indexed = cutoff_date.valid() && use_dates();
+      seq_set earlier;
+      if (indexed)
+	earlier = dates().earlier_than(cutoff_date);
       while (iter.next())
 	{
-	  if (cutoff_date.valid() && iter->date() < cutoff_date)
+	  if (indexed
+	      ? ancestry_index::member(earlier, iter->seq())
+	      : (cutoff_date.valid() && iter->date() < cutoff_date))
 	    break;
 	  matched = true;
 	  Failure printed = print_delta(out, outname, fmt, *iter.operator->());
@@ -709,6 +717,10 @@ sccs_file::prs(FILE *out, const char *outname,
     }
   else                          // EARLIER
     {
+      const bool indexed = cutoff_date.valid() && use_dates();
+      seq_set later;
+      if (indexed)
+	later = dates().later_than(cutoff_date);
       while (iter.next())
 	{
 	  if (!matched)
@@ -716,7 +728,9 @@ sccs_file::prs(FILE *out, const char *outname,
 	      if (rid.valid() && (rid != iter->id()))
 		continue;
 	    }
-	  if (cutoff_date.valid() && (cutoff_date < iter->date()))
+	  if (indexed
+	      ? ancestry_index::member(later, iter->seq())
+	      : (cutoff_date.valid() && (cutoff_date < iter->date())))
 	    continue;
 	  matched = true;
 	  Failure printed = print_delta(out, outname, fmt, *iter.operator->());
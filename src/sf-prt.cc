@@ -335,9 +335,10 @@ sccs_file::prt(FILE *out,
 	  printed = iter->date().printf(out, 'T');
 	  if (!printed.ok())
 	    return printed;
-	  TRY_PRINTF(fprintf(out, " %s\t%hu %hu",
+	  TRY_PRINTF(fprintf(out, " %s\t%u %u",
 			     iter->user().c_str(),
-			     iter->seq(), iter->prev_seq()));
+			     static_cast<unsigned>(iter->seq()),
+			     static_cast<unsigned>(iter->prev_seq())));
 	  TRY_PRINTF(fprintf(out, "\t%05lu/%05lu/%05lu",
 			     iter->inserted(), iter->deleted(), iter->unchanged()));
 
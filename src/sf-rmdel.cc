@@ -91,13 +91,19 @@ sccs_file::rmdel(sid id)
   cssc::Failure written = write(out);
   if (!written.ok())
     return written;
+  cssc::FailureOr<int> header_sum = checksum_so_far(out);
+  if (!header_sum.ok())
+    {
+      return cssc::make_failure_builder(header_sum.fail())
+	.diagnose() << "failed to read back " << name_.xfile();
+    }
 
-  cssc::Failure removed = body_scanner_->remove(out, seq);
-  if (!removed.ok())
-    return removed;
+  cssc::FailureOr<int> body_sum = body_scanner_->remove(out, seq);
+  if (!body_sum.ok())
+    return body_sum.fail();
 
   // Only finish write out the file if we had no problem.
-  cssc::Failure updated = end_update(&out);
+  cssc::Failure updated = end_update(&out, (*header_sum + *body_sum) & 0xFFFF);
   if (!updated.ok())
     {
       return cssc::make_failure_builder(updated)
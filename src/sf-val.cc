@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "cssc.h"
+#include "body-scanner.h"
 #include "sccsfile.h"
 #include "delta.h"
 #include "delta-table.h"
@@ -343,7 +344,11 @@ sccs_file::validate() const
   // TODO: check for unknown flags
   // TODO: check for boolean flags with non-numeric value.
 
-  // TODO: check the body (unclosed deltas, etc.)
+  // Check the body (unclosed deltas, etc.)
+  if (!body_scanner_->validate(*delta_table_))
+    {
+      retval = false;
+    }
 
   return retval;
 }
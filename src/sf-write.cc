@@ -40,6 +40,7 @@
 #include "failure.h"
 #include "filepos.h"
 #include "file.h"
+#include "sync-group.h"
 #include "ioerr.h"
 
 using cssc::Failure;
@@ -502,7 +503,7 @@ maybe_sync(FILE *fp)
    renaming the x-file to replace the old SCCS file. */
 
 Failure
-sccs_file::end_update(FILE **pout)
+sccs_file::end_update(FILE **pout, cssc::optional<int> known_sum)
 {
   Failure real_result = cssc::Failure::Ok();
   ResourceCleanup pout_closer([&pout, &real_result](){
@@ -522,7 +523,7 @@ sccs_file::end_update(FILE **pout)
 
   // We execute the rest of end_update() inside a lambda so that we
   // can adjust real_result if we fail to close *pout.
-  real_result = cssc::Update(real_result, [this, xname, &pout, diagnose]() -> cssc::Failure {
+  real_result = cssc::Update(real_result, [this, xname, &pout, diagnose, known_sum]() -> cssc::Failure {
       auto write_error = [xname](int saved_errno)
 	{
 	  return cssc::make_failure_builder_from_errno(saved_errno)
@@ -538,14 +539,19 @@ sccs_file::end_update(FILE **pout)
 	return diagnose(result) << "failed to sync " << xname;
 
       int sum;
-      // Open the file (obtaining the checksum) and immediately close it.
-      {
-	auto opts = ParserOptions().set_silent_checksum_error(true);
-	auto open_result = sccs_file_parser::open_sccs_file(xname, READ, opts);
-	if (!open_result.ok())
-	  return diagnose(open_result.fail()) << "failed to open " << xname;
-	sum = (*open_result)->computed_sum;
-      }
+      if (known_sum.has_value())
+	{
+	  sum = known_sum.value();
+	}
+      else
+	{
+	  // Open the file (obtaining the checksum) and immediately close it.
+	  auto opts = ParserOptions().set_silent_checksum_error(true);
+	  auto open_result = sccs_file_parser::open_sccs_file(xname, READ, opts);
+	  if (!open_result.ok())
+	    return diagnose(open_result.fail()) << "failed to open " << xname;
+	  sum = (*open_result)->computed_sum;
+	}
 
 
       // For "admin -i", we may need to change the "encoded" flag
@@ -568,6 +574,15 @@ sccs_file::end_update(FILE **pout)
 	{
 	  return write_error(errno);
 	}
+      if (sync_)
+	{
+	  // Make the new file durable before it replaces the old one.
+	  result = fflush_failure(*pout);
+	  if (result.ok())
+	    result = sync_->sync(fileno(*pout));
+	  if (!result.ok())
+	    return diagnose(result) << "failed to sync " << xname;
+	}
       if (fclose_failed(fclose(*pout)))
 	{
 	  *pout = NULL;		// don't attempt to close it again.
@@ -594,7 +609,8 @@ sccs_file::end_update(FILE **pout)
 
       cssc::Failure retval = cssc::Failure::Ok();
 
-      if (mode_ != CREATE && remove(name_.c_str()) == -1)
+      if (mode_ != CREATE && !CONFIG_CAN_RENAME_OVER_EXISTING_FILE
+	  && remove(name_.c_str()) == -1)
 	{
 	  return cssc::make_failure_builder_from_errno(errno)
 	    .diagnose() << "failed to remove " << name_.c_str();
@@ -639,9 +655,44 @@ sccs_file::update_checksum()
 }
 
 
+/* Returns the contribution to the checksum of what has been written
+   to OUT so far, that is, of everything after the first line.  OUT
+   is left positioned where it was. */
+cssc::FailureOr<int>
+sccs_file::checksum_so_far(FILE *out)
+{
+  if (fflush_failed(fflush(out)))
+    return cssc::make_failure_from_errno(errno);
+  const off_t end = ftello(out);
+  if (end == -1)
+    return cssc::make_failure_from_errno(errno);
+
+  rewind(out);
+  int sum = 0;
+  bool first_line = true;
+  for (off_t pos = 0; pos < end; ++pos)
+    {
+      const int c = getc(out);
+      if (EOF == c)
+	{
+	  if (ferror(out))
+	    return cssc::make_failure_from_errno(errno);
+	  return cssc::make_failure(cssc::errorcode::UnexpectedEOF);
+	}
+      if (first_line)
+	first_line = (c != '\n');
+      else
+	sum += static_cast<char>(c);    // plain char, like the parser.
+    }
+  if (fseeko(out, end, SEEK_SET) != 0)
+    return cssc::make_failure_from_errno(errno);
+  return sum;
+}
+
+
 /* Update the SCCS file */
 bool
-sccs_file::update()
+sccs_file::update(bool compact_body)
 {
   ASSERT(mode_ != CREATE);
   ASSERT(body_scanner_);
@@ -662,6 +713,32 @@ sccs_file::update()
       return false;
     }
 
+  // Only the header has changed, so rather than reading the whole
+  // new file to compute its checksum, we add what the new header
+  // contributes to what the (unchanged) body did.
+  cssc::FailureOr<int> header_sum = checksum_so_far(out);
+  if (!header_sum.ok())
+    {
+      std::string msg = "failed to read back " + name_.xfile() + ": "
+	+ header_sum.fail().to_string();
+      xfile_error(msg.c_str());
+      return false;
+    }
+
+  if (compact_body)
+    {
+      cssc::FailureOr<int> body_sum =
+	body_scanner_->compact(out, delta_table_->highest_seqno());
+      if (!body_sum.ok())
+	{
+	  // compact() has already explained the problem, and the
+	  // x-file is removed when we are destroyed.
+	  xfile_error("Body not written.");
+	  return false;
+	}
+      return end_update(&out, (*header_sum + *body_sum) & 0xFFFF).ok();
+    }
+
   // assume that since the earlier seek_to_body() worked,
   // this one will too.
   if (!body_scanner_->seek_to_body().ok())
@@ -674,7 +751,8 @@ sccs_file::update()
       xfile_error(msg.c_str());
       return false;
     }
-  return end_update(&out).ok();	// TODO: change return type
+  const int sum = (*header_sum + body_scanner_->body_checksum()) & 0xFFFF;
+  return end_update(&out, sum).ok();	// TODO: change return type
 }
 
 /* Local variables: */
@@ -0,0 +1,173 @@
+/*
+ * sfile-cache.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Members of the class sfile_cache.
+ *
+ */
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "cssc.h"
+#include "sfile-cache.h"
+#include "sccsfile.h"
+#include "stat-time.h"
+
+sfile_identity::sfile_identity()
+  : dev(0), ino(0), size(0), mtime(), ctime()
+{
+}
+
+sfile_identity::sfile_identity(const struct stat& st)
+  : dev(st.st_dev), ino(st.st_ino), size(st.st_size),
+    mtime(get_stat_mtime(&st)), ctime(get_stat_ctime(&st))
+{
+}
+
+bool
+sfile_identity::operator==(const sfile_identity& other) const
+{
+  return dev == other.dev
+    && ino == other.ino
+    && size == other.size
+    && mtime.tv_sec == other.mtime.tv_sec
+    && mtime.tv_nsec == other.mtime.tv_nsec
+    && ctime.tv_sec == other.ctime.tv_sec
+    && ctime.tv_nsec == other.ctime.tv_nsec;
+}
+
+sfile_cache::entry::entry()
+  : mutex(), name(), file(), identity()
+{
+}
+
+sfile_cache::entry::~entry()
+{
+}
+
+sfile_cache::sfile_cache(size_t capacity)
+  : capacity_(capacity ? capacity : 1u), mutex_(), lru_(), index_(),
+    stats_()
+{
+}
+
+sfile_cache::~sfile_cache()
+{
+}
+
+sfile_cache::handle
+sfile_cache::lookup(const std::string& sfile)
+{
+  struct stat before;
+  const bool have_before = (0 == stat(sfile.c_str(), &before));
+  if (have_before)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = index_.find(sfile);
+      if (it != index_.end())
+	{
+	  handle h = it->second->second;
+	  if (h->identity == sfile_identity(before))
+	    {
+	      lru_.splice(lru_.begin(), lru_, it->second);
+	      ++stats_.hits;
+	      return h;
+	    }
+	}
+    }
+
+  // Not cached, or out of date.  We parse the file without holding
+  // the cache lock, since that may take a while.
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    ++stats_.misses;
+  }
+  handle h = std::make_shared<entry>();
+  h->name = sfile;
+  h->file.reset(new sccs_file(h->name, READ));
+  h->file->keep_indexes();
+
+  // If the file was replaced while we were reading it, we can't tell
+  // which version we got, so we use it once but do not keep it.
+  struct stat after;
+  if (have_before
+      && 0 == stat(sfile.c_str(), &after)
+      && sfile_identity(before) == sfile_identity(after))
+    {
+      h->identity = sfile_identity(after);
+      std::lock_guard<std::mutex> guard(mutex_);
+      insert_locked(sfile, h);
+    }
+  else
+    {
+      forget(sfile);
+    }
+  return h;
+}
+
+void
+sfile_cache::insert_locked(const std::string& sfile, handle h)
+{
+  auto it = index_.find(sfile);
+  if (it != index_.end())
+    {
+      lru_.erase(it->second);
+      index_.erase(it);
+    }
+  lru_.emplace_front(sfile, h);
+  index_[sfile] = lru_.begin();
+  while (lru_.size() > capacity_)
+    {
+      // Anybody still using the evicted entry keeps it alive.
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+      ++stats_.evictions;
+    }
+}
+
+void
+sfile_cache::forget(const std::string& sfile)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = index_.find(sfile);
+  if (it != index_.end())
+    {
+      lru_.erase(it->second);
+      index_.erase(it);
+    }
+}
+
+size_t
+sfile_cache::size() const
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  return lru_.size();
+}
+
+sfile_cache::statistics
+sfile_cache::stats() const
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  return stats_;
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,128 @@
+/*
+ * sfile-cache.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Defines the class sfile_cache, which keeps recently used history
+ * files parsed (in READ mode) so that a long-running process can
+ * serve repeated requests for them without parsing them again.
+ *
+ */
+
+#ifndef CSSC__SFILE_CACHE_H__
+#define CSSC__SFILE_CACHE_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "sccsname.h"
+
+class sccs_file;
+
+// Enough of the result of stat() to tell whether a file has been
+// changed or replaced.  History files are normally replaced (by
+// renaming the x-file over them) rather than changed in place, but
+// we check the size and times too, to catch editing by hand.
+struct sfile_identity
+{
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+  struct timespec ctime;
+
+  sfile_identity();
+  explicit sfile_identity(const struct stat& st);
+  bool operator==(const sfile_identity&) const;
+  bool operator!=(const sfile_identity& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+class sfile_cache
+{
+public:
+  // A parsed history file.  The sccs_file object reads the body of
+  // the file as it was when it was parsed, and is not safe for
+  // concurrent use, so callers must hold MUTEX while using FILE.
+  struct entry
+  {
+    std::mutex mutex;
+    sccs_name name;
+    std::unique_ptr<sccs_file> file;
+    sfile_identity identity;
+
+    entry();
+    ~entry();
+  };
+  typedef std::shared_ptr<entry> handle;
+
+  struct statistics
+  {
+    unsigned long hits, misses, evictions;
+
+    statistics() : hits(0uL), misses(0uL), evictions(0uL)
+    {
+    }
+  };
+
+  explicit sfile_cache(size_t capacity);
+  ~sfile_cache();
+
+  // Returns the history file SFILE, parsing it if it is not cached
+  // or if it has changed since it was cached.  Failures to open or
+  // parse the file are reported (and thrown) exactly as they would be
+  // by the sccs_file constructor; failed files are not cached.
+  handle lookup(const std::string& sfile);
+
+  // Drops SFILE from the cache, if it is there.
+  void forget(const std::string& sfile);
+
+  size_t size() const;
+  size_t capacity() const { return capacity_; }
+  statistics stats() const;
+
+private:
+  typedef std::list<std::pair<std::string, handle> > lru_list;
+
+  sfile_cache(const sfile_cache&) = delete;
+  sfile_cache& operator=(const sfile_cache&) = delete;
+
+  void insert_locked(const std::string& sfile, handle h);
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  lru_list lru_;		// most recently used first
+  std::unordered_map<std::string, lru_list::iterator> index_;
+  statistics stats_;
+};
+
+#endif /* CSSC__SFILE_CACHE_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
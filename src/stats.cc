@@ -0,0 +1,343 @@
+/*
+ * stats.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The CSSC_STATS report: totals for each phase and counter, over all
+ * threads, written as one line of JSON when the program exits.
+ *
+ */
+
+#include <config.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <new>
+#include <string>
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "cssc.h"
+#include "file.h"
+#include "quit.h"
+#include "stats.h"
+
+namespace
+{
+  struct phase_total
+  {
+    double wall;
+    double cpu;
+    unsigned long calls;
+  };
+
+  phase_total phase_totals[stats_phase_count];
+  std::mutex phase_totals_mutex;
+  std::atomic<unsigned long> counters[stats_counter_count];
+  thread_local stats_timer *current_timer = nullptr;
+  std::chrono::steady_clock::time_point process_start;
+
+  const char *const phase_names[stats_phase_count] =
+    {
+      "checksum", "delta_table", "seqstate", "body", "keywords", "output",
+    };
+
+  const char *const counter_names[stats_counter_count] =
+    {
+      "bytes_read", "lines_read", "control_lines", "lines_emitted",
+      "allocations",
+    };
+
+  bool
+  per_line(stats_phase p)
+  {
+    return stats_phase::keywords == p || stats_phase::output == p;
+  }
+
+  double
+  wall_now()
+  {
+    return std::chrono::duration<double>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // The CPU time of this thread, if the system can tell us.
+  double
+  cpu_now()
+  {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (0 == clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+      return static_cast<double>(ts.tv_sec) + ts.tv_nsec / 1e9;
+#endif
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+  }
+
+  // The caller holds phase_totals_mutex.
+  void
+  record(stats_phase p, double wall, double cpu, unsigned long calls)
+  {
+    phase_total& t = phase_totals[static_cast<int>(p)];
+    t.wall += wall;
+    t.cpu += cpu;
+    t.calls += calls;
+  }
+
+  void
+  append_json_string(std::string& out, const char *s)
+  {
+    out += '"';
+    for (; *s; ++s)
+      {
+	const unsigned char c = static_cast<unsigned char>(*s);
+	if ('"' == c || '\\' == c)
+	  {
+	    out += '\\';
+	    out += *s;
+	  }
+	else if (c < 0x20)
+	  {
+	    char buf[8];
+	    snprintf(buf, sizeof buf, "\\u%04x", c);
+	    out += buf;
+	  }
+	else
+	  {
+	    out += *s;
+	  }
+      }
+    out += '"';
+  }
+
+  void
+  append_format(std::string& out, const char *fmt, double value)
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, fmt, value);
+    out += buf;
+  }
+
+  void
+  report()
+  {
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - process_start;
+    struct rusage ru;
+    double cpu = 0.0;
+    if (0 == getrusage(RUSAGE_SELF, &ru))
+      {
+	cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+	  + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+      }
+
+    std::string out("{\"program\": ");
+    append_json_string(out, prg_name ? prg_name : "");
+    out += ", \"pid\": " + std::to_string(static_cast<long>(getpid()));
+    append_format(out, ", \"wall\": %.6f", elapsed.count());
+    append_format(out, ", \"cpu\": %.6f", cpu);
+
+    out += ", \"phases\": {";
+    {
+      std::lock_guard<std::mutex> guard(phase_totals_mutex);
+      for (int i = 0; i < stats_phase_count; ++i)
+	{
+	  const phase_total& t = phase_totals[i];
+	  if (i)
+	    out += ", ";
+	  append_json_string(out, phase_names[i]);
+	  append_format(out, ": {\"wall\": %.6f", t.wall);
+	  append_format(out, ", \"cpu\": %.6f", t.cpu);
+	  out += ", \"calls\": " + std::to_string(t.calls) + "}";
+	}
+    }
+
+    out += "}, \"counters\": {";
+    for (int i = 0; i < stats_counter_count; ++i)
+      {
+	if (i)
+	  out += ", ";
+	append_json_string(out, counter_names[i]);
+	out += ": " + std::to_string(counters[i].load());
+      }
+
+    const lock_wait_stats locks = get_lock_wait_stats();
+    out += "}, \"locks\": {\"taken\": " + std::to_string(locks.locks)
+      + ", \"failed\": " + std::to_string(locks.failures)
+      + ", \"retries\": " + std::to_string(locks.retries);
+    append_format(out, ", \"wait\": %.6f}}\n", locks.seconds);
+
+    const char *name = stats_file();
+    // The sccs driver unsets CSSC_STATS_FILE when it is privileged,
+    // but the tools may be installed set-user-id themselves.
+    FILE *f = name ? fopen_as_real_user(name, "a") : stderr;
+    if (nullptr == f)
+      {
+	errormsg_with_errno("%s: cannot write statistics", name);
+	return;
+      }
+    fputs(out.c_str(), f);
+    if (f != stderr)
+      fclose(f);
+    else
+      fflush(f);
+  }
+
+}
+
+bool stats_enabled = false;
+
+void
+start_stats()
+{
+  if (stats_enabled || !stats_wanted())
+    return;
+  process_start = std::chrono::steady_clock::now();
+  atexit(report);
+  stats_enabled = true;
+}
+
+void
+stats_add(stats_counter c, unsigned long n)
+{
+  counters[static_cast<int>(c)].fetch_add(n, std::memory_order_relaxed);
+}
+
+void
+stats_add_line(std::size_t len, bool control)
+{
+  counters[static_cast<int>(stats_counter::bytes_read)]
+    .fetch_add(len, std::memory_order_relaxed);
+  counters[static_cast<int>(stats_counter::lines_read)]
+    .fetch_add(1u, std::memory_order_relaxed);
+  if (control)
+    counters[static_cast<int>(stats_counter::control_lines)]
+      .fetch_add(1u, std::memory_order_relaxed);
+}
+
+void
+stats_timer::start()
+{
+  outer_ = current_timer;
+  current_timer = this;
+  if (!per_line(phase_))
+    {
+      inner_wall_ = inner_cpu_ = 0.0;
+      for (int i = 0; i < stats_phase_count; ++i)
+	{
+	  fine_wall_[i] = 0.0;
+	  fine_calls_[i] = 0uL;
+	}
+      cpu_ = cpu_now();
+    }
+  wall_ = wall_now();
+}
+
+void
+stats_timer::stop()
+{
+  const double wall = wall_now() - wall_;
+  current_timer = outer_;
+
+  if (per_line(phase_))
+    {
+      if (outer_ && !per_line(outer_->phase_))
+	{
+	  // Leave it to the enclosing timer, to save taking the lock
+	  // for each line.
+	  outer_->fine_wall_[static_cast<int>(phase_)] += wall;
+	  ++outer_->fine_calls_[static_cast<int>(phase_)];
+	}
+      else
+	{
+	  std::lock_guard<std::mutex> guard(phase_totals_mutex);
+	  record(phase_, wall, 0.0, 1uL);
+	}
+      return;
+    }
+
+  const double cpu = cpu_now() - cpu_;
+  if (outer_)
+    {
+      outer_->inner_wall_ += wall;
+      outer_->inner_cpu_ += cpu;
+    }
+
+  // Share the CPU time of this phase between it and the per-line
+  // phases within it, by elapsed time.
+  const double own_wall = wall - inner_wall_;
+  const double own_cpu = cpu - inner_cpu_;
+  double rest_wall = own_wall, rest_cpu = own_cpu;
+  std::lock_guard<std::mutex> guard(phase_totals_mutex);
+  for (int i = 0; i < stats_phase_count; ++i)
+    {
+      if (fine_calls_[i])
+	{
+	  const double share =
+	    (own_wall > 0.0) ? own_cpu * fine_wall_[i] / own_wall : 0.0;
+	  record(static_cast<stats_phase>(i), fine_wall_[i], share,
+		 fine_calls_[i]);
+	  rest_wall -= fine_wall_[i];
+	  rest_cpu -= share;
+	}
+    }
+  record(phase_, rest_wall, rest_cpu, 1uL);
+}
+
+
+// Counting allocations means replacing the global operator new; the
+// other forms of it (for arrays, and not throwing) call this one.
+void *
+operator new(std::size_t size)
+{
+  if (stats_enabled)
+    stats_add(stats_counter::allocations, 1uL);
+  if (0 == size)
+    size = 1;
+  for (;;)
+    {
+      void *p = std::malloc(size);
+      if (p)
+	return p;
+      std::new_handler handler = std::get_new_handler();
+      if (!handler)
+	throw std::bad_alloc();
+      handler();
+    }
+}
+
+void
+operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
@@ -0,0 +1,116 @@
+/*
+ * stats.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Timings and counts of the work done on history files, reported as
+ * JSON when the program exits if CSSC_STATS is "enabled".  When it
+ * is not, each timer or counter costs a test of stats_enabled.
+ *
+ */
+
+#ifndef CSSC__STATS_H__
+#define CSSC__STATS_H__
+
+#include <cstddef>
+
+enum class stats_phase
+{
+  checksum,			// reading the file to check its checksum
+  delta_table,			// parsing the header
+  seqstate,			// deciding which deltas to apply
+  body,				// scanning the body
+  keywords,			// keyword substitution (per line)
+  output,			// writing the lines retrieved (per line)
+};
+const int stats_phase_count = 6;
+
+enum class stats_counter
+{
+  bytes_read,
+  lines_read,
+  control_lines,
+  lines_emitted,
+  allocations,
+};
+const int stats_counter_count = 5;
+
+// Set from CSSC_STATS by start_stats(), which each tool calls near
+// the start of main(); it exits if CSSC_STATS has a bad value.
+extern bool stats_enabled;
+void start_stats();
+
+void stats_add(stats_counter c, unsigned long n);
+void stats_add_line(std::size_t len, bool control);
+
+inline void
+stats_count(stats_counter c, unsigned long n = 1uL)
+{
+  if (stats_enabled)
+    stats_add(c, n);
+}
+
+inline void
+stats_count_line(std::size_t len, bool control)
+{
+  if (stats_enabled)
+    stats_add_line(len, control);
+}
+
+// Adds the time from its construction to its destruction to a phase.
+// Time spent in a timer made meanwhile (in the same thread) counts
+// only towards that timer's phase.  The per-line phases measure only
+// elapsed time, since reading the CPU clock for every line would cost
+// more than the work being measured; they are given a share of the
+// CPU time of the phase they are in, in proportion to elapsed time.
+class stats_timer
+{
+public:
+  explicit stats_timer(stats_phase p)
+    : phase_(p), running_(stats_enabled)
+  {
+    if (running_)
+      start();
+  }
+
+  ~stats_timer()
+  {
+    if (running_)
+      stop();
+  }
+
+  stats_timer(const stats_timer&) = delete;
+  stats_timer& operator=(const stats_timer&) = delete;
+
+private:
+  void start();
+  void stop();
+
+  const stats_phase phase_;
+  const bool running_;
+  stats_timer *outer_;
+  double wall_, cpu_;
+  double inner_wall_, inner_cpu_;
+  double fine_wall_[stats_phase_count];
+  unsigned long fine_calls_[stats_phase_count];
+};
+
+#endif /* CSSC__STATS_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
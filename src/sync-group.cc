@@ -0,0 +1,151 @@
+/*
+ * sync-group.cc: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Members of the class sync_group.
+ *
+ */
+
+#include <config.h>
+
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cssc.h"
+#include "sync-group.h"
+
+
+sync_group::sync_group()
+  : mutex_(), done_(), syncing_(false),
+    arrived_(0uL), synced_(0uL), batches_(0uL),
+    pending_fds_(), pending_tickets_(), errors_()
+{
+}
+
+
+unsigned long
+sync_group::batches() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return batches_;
+}
+
+
+std::vector<int>
+sync_group::sync_files(const std::vector<int>& fds)
+{
+  std::vector<int> result(fds.size(), 0);
+#ifdef HAVE_SYNCFS
+  // One syncfs() for each file system; a file on a file system we
+  // have already synced needs nothing more.
+  std::vector<dev_t> done;
+  for (size_t i = 0; i < fds.size(); ++i)
+    {
+      struct stat st;
+      if (0 != fstat(fds[i], &st))
+	{
+	  result[i] = errno;
+	  continue;
+	}
+      bool seen = false;
+      for (dev_t d : done)
+	seen = seen || d == st.st_dev;
+      if (seen)
+	continue;
+      if (0 != syncfs(fds[i]))
+	{
+	  // Report the failure against the other files on this file
+	  // system too.
+	  const int saved_errno = errno;
+	  for (size_t j = i; j < fds.size(); ++j)
+	    {
+	      struct stat other;
+	      if (0 == fstat(fds[j], &other) && other.st_dev == st.st_dev)
+		result[j] = saved_errno;
+	    }
+	}
+      done.push_back(st.st_dev);
+    }
+#else
+  for (size_t i = 0; i < fds.size(); ++i)
+    {
+# ifdef HAVE_FDATASYNC
+      if (0 != fdatasync(fds[i]))
+# else
+      if (0 != fsync(fds[i]))
+# endif
+	result[i] = errno;
+    }
+#endif
+  return result;
+}
+
+
+cssc::Failure
+sync_group::sync(int fd)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  const unsigned long ticket = ++arrived_;
+  pending_fds_.push_back(fd);
+  pending_tickets_.push_back(ticket);
+
+  while (synced_ < ticket)
+    {
+      if (syncing_)
+	{
+	  done_.wait(lock);
+	  continue;
+	}
+
+      // Nobody is syncing, so we sync everything that is waiting,
+      // including our own file.
+      syncing_ = true;
+      std::vector<int> fds;
+      std::vector<unsigned long> tickets;
+      fds.swap(pending_fds_);
+      tickets.swap(pending_tickets_);
+      const unsigned long upto = arrived_;
+
+      lock.unlock();
+      const std::vector<int> errors = sync_files(fds);
+      lock.lock();
+
+      for (size_t i = 0; i < tickets.size(); ++i)
+	{
+	  if (errors[i])
+	    errors_[tickets[i]] = errors[i];
+	}
+      ++batches_;
+      synced_ = upto;
+      syncing_ = false;
+      done_.notify_all();
+    }
+
+  const auto it = errors_.find(ticket);
+  if (it == errors_.end())
+    return cssc::Failure::Ok();
+  const int saved_errno = it->second;
+  errors_.erase(it);
+  return cssc::make_failure_from_errno(saved_errno);
+}
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
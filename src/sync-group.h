@@ -0,0 +1,75 @@
+/*
+ * sync-group.h: Part of GNU CSSC.
+ *
+ *  Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Defines the class sync_group, which shares the cost of making
+ * files durable between several threads.
+ *
+ */
+
+#ifndef CSSC__SYNC_GROUP_H__
+#define CSSC__SYNC_GROUP_H__
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "failure.h"
+
+// A sync_group writes the data of files to stable storage on behalf
+// of several threads at once.  A thread calling sync() joins the
+// files waiting to be synced; if no sync is under way it does the
+// work for all of them itself, and otherwise it waits for the sync
+// after the current one, which covers its file too.  Where syncfs(2)
+// is available one call covers every waiting file on the same file
+// system; otherwise each is given to fdatasync(2) (or fsync(2)).
+class sync_group
+{
+public:
+  sync_group();
+
+  // Returns once the data of the open file FD is on stable storage.
+  cssc::Failure sync(int fd);
+
+  // The number of times we have synced a group of files.
+  unsigned long batches() const;
+
+private:
+  sync_group(const sync_group&) = delete;
+  sync_group& operator=(const sync_group&) = delete;
+
+  // Syncs FDS, returning the errno value for each (0 for success).
+  static std::vector<int> sync_files(const std::vector<int>& fds);
+
+  mutable std::mutex mutex_;
+  std::condition_variable done_;
+  bool syncing_;
+  unsigned long arrived_;	// tickets handed out so far
+  unsigned long synced_;	// tickets up to this one are done
+  unsigned long batches_;
+  std::vector<int> pending_fds_;
+  std::vector<unsigned long> pending_tickets_;
+  std::map<unsigned long, int> errors_; // ticket -> errno
+};
+
+#endif /* CSSC__SYNC_GROUP_H__ */
+
+/* Local variables: */
+/* mode: c++ */
+/* End: */
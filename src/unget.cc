@@ -35,6 +35,7 @@
 #include "version.h"
 #include "except.h"
 #include "file.h"
+#include "stats.h"
 
 
 void
@@ -57,6 +58,7 @@ main(int argc, char **argv)
     set_prg_name(argv[0]);
   else
     set_prg_name("unget");
+  start_stats();
 
   ASSERT(!rid.valid());
 
@@ -24,6 +24,15 @@
 
 #include <config.h>
 
+#include <cerrno>
+#include <cstdlib>
+#include <condition_variable>
+#include <ctype.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "cssc.h"
 #include "fileiter.h"
 #include "sccsfile.h"
@@ -32,14 +41,14 @@
 #include "except.h"
 #include "file.h"
 #include "valcodes.h"
-
-/* Prints a list of included or excluded SIDs. */
+#include "quit.h"
+#include "stats.h"
 
 void
 usage()
 {
   fprintf(stderr,
-	  "usage: %s [-sV] [-m module] [-rSID] [-y type]\n",
+	  "usage: %s [-sV] [-j jobs] [-m module] [-rSID] [-y type]\n",
 	  prg_name);
 }
 
@@ -51,29 +60,200 @@ static void problem(int &retval, const int &newprob)
 }
 
 
+/* The checks requested on the command line. */
+struct val_request
+{
+  val_request()
+    : silent(false), had_m_option(false), had_y_option(false),
+      had_r_option(false), req_sid_str(NULL), rid(sid::null_sid())
+  {
+  }
+
+  bool silent;
+  bool had_m_option;
+  std::string mstring;
+  bool had_y_option;
+  std::string ystring;
+  bool had_r_option;
+  const char *req_sid_str;
+  sid rid;
+};
+
+
+/* Checks one history file, returning the exit status for it. */
+static int
+validate_file(const val_request& req, sccs_name& name)
+{
+  int retval = 0;
+  try
+    {
+      sccs_file file(name, READ);
+
+      if (req.had_r_option)
+	{
+	  if (req.rid.valid() && nullptr == file.find_delta(req.rid))
+	    {
+	      if (!req.silent)
+		{
+		  errormsg("%s: Requested SID %s not found.",
+			   name.c_str(), req.req_sid_str);
+		}
+	      problem(retval, Val_NoSuchSID);
+	    }
+	}
+
+      if (req.had_m_option)
+	{
+	  const std::string &module_flag = file.get_module_name();
+	  if (module_flag != req.mstring)
+	    {
+	      if (!req.silent)
+		{
+		  errormsg("%s: mismatch for %%"
+			   "M%%: wanted \"%s\", got \"%s\"\n",
+			   name.c_str(),
+			   req.mstring.c_str(),
+			   module_flag.c_str());
+		}
+	      problem(retval, Val_MismatchedM);
+	    }
+	}
+
+      if (req.had_y_option)
+	{
+	  const std::string &type_flag = file.get_module_type_flag();
+	  if (type_flag != req.ystring)
+	    {
+	      if (!req.silent)
+		{
+		  errormsg("%s: mismatch for %%"
+			   "Y%%: wanted \"%s\", got \"%s\"\n",
+			   name.c_str(),
+			   req.mstring.c_str(),
+			   type_flag.c_str());
+		}
+	      problem(retval, Val_MismatchedY);
+	    }
+	}
+
+
+      if (!file.validate())
+	{
+	  problem(retval, Val_CorruptFile);
+	}
+    }
+  catch (CsscSfileMissingException e)
+    {
+      problem(retval, Val_CannotOpenOrWrongFormat);
+    }
+  catch (CsscContstructorFailedException e)
+    {
+      problem(retval, Val_CorruptFile);
+    }
+  catch (CsscSfileCorruptException ce)
+    {
+      problem(retval, Val_CorruptFile);
+    }
+  catch (CsscExitvalException e)
+    {
+      if (e.exitval > retval)
+	retval = e.exitval;
+    }
+  return retval;
+}
+
+
+/* Checks the files in NAMES using JOBS threads.  The diagnostics for
+   each file are collected and printed in the order in which the files
+   were named, as soon as all the files before it are done, so the
+   output is the same as if we had checked the files one at a time. */
+static int
+validate_in_parallel(const val_request& req,
+		     const std::vector<std::string>& names,
+		     unsigned long jobs)
+{
+  struct outcome
+  {
+    outcome() : done(false), retval(0) {}
+    bool done;
+    int retval;
+    std::string diagnostics;
+  };
+  std::vector<outcome> outcomes(names.size());
+  std::mutex mutex;
+  std::condition_variable finished;
+  size_t next = 0;
+
+  auto worker = [&]()
+    {
+      for (;;)
+	{
+	  size_t i;
+	  {
+	    std::lock_guard<std::mutex> lock(mutex);
+	    if (next >= names.size())
+	      return;
+	    i = next++;
+	  }
+
+	  std::string diagnostics;
+	  int retval;
+	  {
+	    error_context ctx(nullptr, &diagnostics);
+	    sccs_name name;
+	    name = names[i];
+	    retval = validate_file(req, name);
+	  }
+
+	  std::lock_guard<std::mutex> lock(mutex);
+	  outcomes[i].retval = retval;
+	  outcomes[i].diagnostics.swap(diagnostics);
+	  outcomes[i].done = true;
+	  finished.notify_all();
+	}
+    };
+
+  std::vector<std::thread> threads;
+  for (unsigned long t = 0; t < jobs && t < names.size(); ++t)
+    threads.emplace_back(worker);
+
+  int retval = 0;
+  for (auto& o : outcomes)
+    {
+      std::string diagnostics;
+      {
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&o]() { return o.done; });
+	diagnostics.swap(o.diagnostics);
+      }
+      fputs(diagnostics.c_str(), stderr);
+      problem(retval, o.retval);
+    }
+
+  for (auto& t : threads)
+    t.join();
+  return retval;
+}
+
+
 int
 main(int argc, char **argv)
 {
   Cleaner arbitrary_name;
   int retval = 0;
-  bool silent = false;
-  std::string mstring;
-  bool had_m_option = false;
-  std::string ystring;
-  bool had_y_option = false;
-  bool had_r_option = false;
+  val_request req;
+  unsigned long jobs = 1;
   int c;
-  const char *req_sid_str = NULL;
-  sid rid(sid::null_sid());
 
   if (argc > 0)
       set_prg_name(argv[0]);
   else
     set_prg_name("val");
+  start_stats();
 
-  ASSERT(!rid.valid());
+  ASSERT(!req.rid.valid());
 
-  class CSSC_Options opts(argc, argv, "sV!m!r!y!", 0);
+  class CSSC_Options opts(argc, argv, "sV!m!r!y!j!", 0);
   for(c = opts.next();
       c != CSSC_Options::END_OF_ARGUMENTS;
       c = opts.next())
@@ -91,15 +271,15 @@ main(int argc, char **argv)
 	  return retval;
 
 	case 'r':
-	  if (had_r_option)
+	  if (req.had_r_option)
 	    {
 	      errormsg("Duplicate -r option\n");
 	      problem(retval, Val_InvalidOption);
 	    }
-	  had_r_option = true;
-	  req_sid_str = opts.getarg();
-	  rid = sid(req_sid_str);
-	  if (!rid.valid())
+	  req.had_r_option = true;
+	  req.req_sid_str = opts.getarg();
+	  req.rid = sid(req.req_sid_str);
+	  if (!req.rid.valid())
 	    {
 	      errormsg("Invaild SID: '%s'", opts.getarg());
 	      problem(retval, Val_InvalidSID);
@@ -107,27 +287,41 @@ main(int argc, char **argv)
 	  break;
 
 	case 's':
-	  silent = true;
+	  req.silent = true;
 	  break;
 
 	case 'm':
-	  if (had_m_option)
+	  if (req.had_m_option)
 	    {
 	      errormsg("Duplicate -m option\n");
 	      problem(retval, Val_InvalidOption);
 	    }
-	  had_m_option = true;
-	  mstring = std::string(opts.getarg());
+	  req.had_m_option = true;
+	  req.mstring = std::string(opts.getarg());
 	  break;
 
 	case 'y':
-	  if (had_y_option)
+	  if (req.had_y_option)
 	    {
 	      errormsg("Duplicate -y option\n");
 	      problem(retval, Val_InvalidOption);
 	    }
-	  had_y_option = true;
-	  ystring = std::string(opts.getarg());
+	  req.had_y_option = true;
+	  req.ystring = std::string(opts.getarg());
+	  break;
+
+	case 'j':
+	  {
+	    char *end;
+	    errno = 0;
+	    jobs = strtoul(opts.getarg(), &end, 10);
+	    if (errno || *end || jobs < 1 || !isdigit((unsigned char)*opts.getarg()))
+	      {
+		errormsg("Invalid number of jobs: '%s'", opts.getarg());
+		problem(retval, Val_InvalidOption);
+		jobs = 1;
+	      }
+	  }
 	  break;
 
 	case 'V':
@@ -136,7 +330,7 @@ main(int argc, char **argv)
 	}
     }
 
-  if (silent)
+  if (req.silent)
     {
       if (!stdout_to_null().ok())
 	return 1;	// fatal error.
@@ -150,83 +344,18 @@ main(int argc, char **argv)
       return retval;
     }
 
-  while (iter.next())
+  if (jobs > 1)
     {
-      try
-	{
-	  sccs_name &name = iter.get_name();
-	  sccs_file file(name, READ);
-
-	  if (had_r_option)
-	    {
-	      if (rid.valid() && nullptr == file.find_delta(rid))
-		{
-		  if (!silent)
-		    {
-		      errormsg("%s: Requested SID %s not found.",
-			       name.c_str(), req_sid_str);
-		    }
-		  problem(retval, Val_NoSuchSID);
-		}
-	    }
-
-	  if (had_m_option)
-	    {
-	      const std::string &module_flag = file.get_module_name();
-	      if (module_flag != mstring)
-		{
-		  if (!silent)
-		    {
-		      errormsg("%s: mismatch for %%"
-			       "M%%: wanted \"%s\", got \"%s\"\n",
-			       name.c_str(),
-			       mstring.c_str(),
-			       module_flag.c_str());
-		    }
-		  problem(retval, Val_MismatchedM);
-		}
-	    }
-
-	  if (had_y_option)
-	    {
-	      const std::string &type_flag = file.get_module_type_flag();
-	      if (type_flag != ystring)
-		{
-		  if (!silent)
-		    {
-		      errormsg("%s: mismatch for %%"
-			       "Y%%: wanted \"%s\", got \"%s\"\n",
-			       name.c_str(),
-			       mstring.c_str(),
-			       type_flag.c_str());
-		    }
-		  problem(retval, Val_MismatchedY);
-		}
-	    }
-
+      std::vector<std::string> names;
+      while (iter.next())
+	names.push_back(iter.get_name().sfile());
+      problem(retval, validate_in_parallel(req, names, jobs));
+      return retval;
+    }
 
-	  if (!file.validate())
-	    {
-	      problem(retval, Val_CorruptFile);
-	    }
-	}
-      catch (CsscSfileMissingException e)
-	{
-	  problem(retval, Val_CannotOpenOrWrongFormat);
-	}
-      catch (CsscContstructorFailedException e)
-	{
-	  problem(retval, Val_CorruptFile);
-	}
-      catch (CsscSfileCorruptException ce)
-	{
-	  problem(retval, Val_CorruptFile);
-	}
-      catch (CsscExitvalException e)
-	{
-	  if (e.exitval > retval)
-	    retval = e.exitval;
-	}
+  while (iter.next())
+    {
+      problem(retval, validate_file(req, iter.get_name()));
     }
 
   return retval;
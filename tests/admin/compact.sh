@@ -0,0 +1,141 @@
+#! /bin/sh
+
+# compact.sh:  Tests for admin -C, which rewrites the body with as few
+#              control lines as possible.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+s=s.compact
+remove $s $s.body expected got
+
+# Write a history file with three deltas, 1.3 on top of 1.2 on top
+# of 1.1, whose body is made of the arguments.  We write "@" for ^A,
+# and fix the checksum afterward.
+mkbody () {
+    remove $s
+    ( echo '@h00000'
+      echo '@s 00001/00002/00004'
+      echo '@d D 1.3 11/04/30 19:11:00 james 3 2'
+      echo '@c third'
+      echo '@e'
+      echo '@s 00001/00000/00005'
+      echo '@d D 1.2 11/04/30 19:10:00 james 2 1'
+      echo '@c second'
+      echo '@e'
+      echo '@s 00005/00000/00000'
+      echo '@d D 1.1 11/04/30 19:09:44 james 1 0'
+      echo '@c first'
+      echo '@e'
+      echo '@u'
+      echo '@U'
+      echo '@t'
+      echo '@T'
+      for line
+      do
+	echo "$line"
+      done ) | tr '@' '\001' > $s || miscarry "cannot create $s"
+    ${admin} -z $s || miscarry "cannot fix the checksum of $s"
+}
+
+# Check that get gives the same output for $s with the options in
+# each argument, before and after admin -C.
+same () {
+    label=$1
+    shift
+    for opts
+    do
+	${get} -p -s $opts $s >> expected 2>&1
+	echo "rc $?" >> expected
+    done
+    docommand ${label}a "${vg_admin} -C $s" 0 "" ""
+    for opts
+    do
+	${get} -p -s $opts $s >> got 2>&1
+	echo "rc $?" >> got
+    done
+    docommand ${label}b "cmp expected got" 0 "" ""
+    docommand ${label}c "${val} $s" 0 "" ""
+    docommand ${label}d "${admin} -h $s" 0 "" ""
+    remove expected got
+}
+
+# Write the body of $s to $s.body, with "@" for ^A.
+body () {
+    tr '\001' '@' < $s | sed -n '/^@T$/,$p' > $s.body ||
+	miscarry "cannot read the body of $s"
+}
+
+# Adjacent blocks for the same delta, empty blocks, and a deletion
+# which can make no difference, all go.
+mkbody '@I 1' a '@E 1' '@I 1' b '@D 2' '@E 2' '@I 2' '@E 2' \
+    '@D 3' c '@E 3' '@D 3' d '@E 3' '@I 3' '@D 2' e '@E 2' '@E 3' \
+    '@I 2' g '@E 2' f '@E 1'
+same c1 -r1.1 -r1.2 -r1.3 "-r1.3 -x1.2" "-r1.3 -x1.3" "-r1.2 -i1.3" \
+    "-r1.3 -g1.2" "-m -r1.3"
+body
+docommand c2 "cat $s.body" 0 \
+"@T
+@I 1
+a
+b
+@D 3
+c
+d
+@E 3
+@I 3
+e
+@E 3
+@I 2
+g
+@E 2
+f
+@E 1
+" ""
+
+# Doing it again changes nothing.
+cp $s expected || miscarry "cannot copy $s"
+docommand c3 "${vg_admin} -C $s" 0 "" ""
+docommand c4 "cmp expected $s" 0 "" ""
+remove expected
+
+# A deletion block stays open over lines inserted by a later delta,
+# where it makes no difference, rather than being closed and opened
+# again.
+mkbody '@I 1' '@D 2' a '@E 2' '@I 3' e '@E 3' '@D 2' b '@E 2' c \
+    '@I 2' g '@E 2' d f '@E 1'
+same c5 -r1.1 -r1.2 -r1.3 "-r1.3 -x1.2" "-r1.2 -i1.3" "-r1.3 -x1.1"
+body
+docommand c6 "cat $s.body" 0 \
+"@T
+@I 1
+@D 2
+a
+@I 3
+e
+@E 3
+b
+@E 2
+c
+@I 2
+g
+@E 2
+d
+f
+@E 1
+" ""
+
+# An empty body stays as it is.
+mkbody '@I 1' '@E 1'
+docommand c7 "${vg_admin} -C $s" 0 "" ""
+body
+docommand c8 "cat $s.body" 0 "@T\n@I 1\n@E 1\n" ""
+
+# A corrupt body is left alone.
+mkbody '@I 1' a '@D 2' b '@E 1'
+cp $s expected || miscarry "cannot copy $s"
+docommand c9 "${vg_admin} -C $s" 1 "" IGNORE
+docommand c10 "cmp expected $s" 0 "" ""
+
+remove $s $s.body expected got
+success
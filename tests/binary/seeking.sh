@@ -141,6 +141,17 @@ test_bin s3 infile
 # Another long file but binary because it lacks a newline at the end.
 test_bin s4 ctrl-A-end
 
+# The same again, but with inputs bigger than the part admin looks at
+# before it starts writing, so that it has written much of the file
+# as text before it finds that it must encode it.
+remove huge-text-file
+../../testutils/yammer 80000 "this is a text file" > huge-text-file
+remove infile ; cat huge-text-file ctrl-A-file > infile
+test_bin s7 infile
+use_stdin=true
+test_bin i6 infile
+use_stdin=false
+
 use_stdin=true
 
 
@@ -167,10 +178,15 @@ then
 
     remove infile ; cat long-text-file no-newline > infile
     test_bin i5 infile
+
+    remove infile ; cat huge-text-file no-newline > infile
+    test_bin i7 infile
+    use_stdin=false
+    test_bin s8 infile
 else
     echo "Not running tests on CSSC; Some tests have been been omitted"
 fi
 
-remove $files long-text-file infile ctrl-A-file no-newline ctrl-A-end
+remove $files long-text-file huge-text-file infile ctrl-A-file no-newline ctrl-A-end
 remove command.log log  base errmsg "$g"
 success
@@ -0,0 +1,100 @@
+#! /bin/sh
+# http.sh:  Testing for the web interface of the csscd server.
+
+# Import common functions & definitions.
+. ../common/test-common
+. ../common/not-root
+
+if test -x "${csscd}"
+then
+    true
+else
+    echo "${csscd} is not available, skipping these tests." >&2
+    success
+fi
+if ( curl --version ) >/dev/null 2>&1
+then
+    true
+else
+    echo "curl is not available, skipping these tests." >&2
+    success
+fi
+
+g=browsed
+s=SCCS/s.${g}
+remove command.log log log.stdout log.stderr SCCS $g url.txt page.html
+mkdir SCCS 2>/dev/null
+
+server_pid=
+
+stop_server () {
+    if test -n "$server_pid"
+    then
+	kill $server_pid 2>/dev/null
+	wait $server_pid 2>/dev/null
+	server_pid=
+    fi
+}
+trap stop_server 0
+
+printf '%%M%% %%I%%\nfirst\n' > $g
+docommand a1 "${admin} -i$g -yfirst-comment $s" 0 IGNORE IGNORE
+remove $g
+docommand a2 "${get} -e $s" 0 IGNORE IGNORE
+printf '%%M%% %%I%%\nfirst\nsecond\n' > $g
+docommand a3 "${delta} '-yadded <second>' $s" 0 IGNORE IGNORE
+
+# The system chooses the port, and the server tells us which.
+"${csscd}" -H0 -D. > url.txt &
+server_pid=$!
+tries=0
+until test -s url.txt
+do
+    tries=`expr $tries + 1`
+    if test $tries -gt 10
+    then
+	fail "csscd did not start"
+    fi
+    sleep 1
+done
+url=`cat url.txt`
+
+fetch="curl -s"
+
+docommand b1 "${fetch} ${url}$g?r=1.1" 0 "browsed 1.1\nfirst\n" ""
+docommand b2 "${fetch} ${url}$s?r=1.2" 0 "browsed 1.2\nfirst\nsecond\n" ""
+docommand b3 "${fetch} -o /dev/null -w '%{http_code}\n' ${url}$g?r=1.7" 0 \
+    "404\n" ""
+
+# The history of a file, from its g-file name or its s-file.
+docommand c1 "${fetch} ${url}$g > page.html" 0 "" ""
+docommand c2 "grep -c 'href=\"$g?r=1\.[12]\"' page.html" 0 "2\n" ""
+docommand c3 "grep -c 'added &lt;second&gt;' page.html" 0 "1\n" ""
+
+# A directory listing shows the latest delta of each history file,
+# for working files and s-files alike.
+docommand d0 "${get} $s" 0 IGNORE IGNORE
+docommand d1 "${fetch} -o /dev/null -w '%{http_code} %{redirect_url}\n' ${url}SCCS" \
+    0 "301 ${url}SCCS/\n" ""
+docommand d2 "${fetch} ${url} > page.html" 0 "" ""
+docommand d3 "grep -c '<td>1\.2</td>' page.html" 0 "1\n" ""
+docommand d4 "${fetch} ${url}SCCS/ | grep -c '<td>1\.2</td>'" 0 "1\n" ""
+
+# Nothing outside the tree, and only GET and HEAD.
+docommand e1 "${fetch} --path-as-is -o /dev/null -w '%{http_code}\n' ${url}../" \
+    0 "403\n" ""
+docommand e2 "${fetch} -X DELETE -o /dev/null -w '%{http_code}\n' ${url}$g" \
+    0 "405\n" ""
+docommand e3 "${fetch} -I -o /dev/null -w '%{http_code}\n' ${url}$g" \
+    0 "200\n" ""
+
+# A change to the history file is noticed.
+remove $g
+docommand f1 "${get} -e $s" 0 IGNORE IGNORE
+printf '%%M%% %%I%%\nthird\n' > $g
+docommand f2 "${delta} -ythird $s" 0 IGNORE IGNORE
+docommand f3 "${fetch} ${url}$g?r=1.3" 0 "browsed 1.3\nthird\n" ""
+
+stop_server
+remove SCCS $g url.txt page.html
+success
@@ -0,0 +1,64 @@
+#! /bin/sh
+# multicall.sh:  Testing for the tools built into the driver program
+#                "sccs" by configure --enable-multicall.
+
+# Import common functions & definitions.
+. ../common/test-common
+. ../common/not-root
+
+# We want to prevent setlocale(LC_ALL, "") failing:
+unset LANG
+
+# We assume that all the files we want to work on are in the
+# current directory.
+unset PROJECTDIR
+unset CSSC_SERVER
+
+if ${sccsprog} --version 2>&1 | grep "^Built-in subcommands:" >/dev/null
+then
+    true
+else
+    echo "${sccsprog} has no built-in subcommands, skipping these tests." >&2
+    success
+fi
+
+g=multi
+s=SCCS/s.${g}
+remove command.log log log.stdout log.stderr SCCS $g ,$g
+mkdir SCCS 2>/dev/null
+
+# Without --prefix, the built-in tools are used, so the commands
+# work even though no separate programs can be found.
+builtin="env PATH=/nonexistent ${sccsprog}"
+
+printf '%%M%% %%I%%\nfirst\n' > $g
+docommand a1 "${builtin} create $g" 0 IGNORE IGNORE
+docommand a2 "test -f $s" 0 "" ""
+docommand a3 "${builtin} prs -d:I:_:F: $s" 0 "1.1_s.multi\n" ""
+docommand a4 "${builtin} edit $g" 0 "1.1\nnew delta 1.2\n2 lines\n" ""
+echo second >> $g
+docommand a5 "${builtin} delget -yadded $g" 0 \
+    "1.2\n1 inserted\n0 deleted\n2 unchanged\n1.2\n3 lines\n" ""
+docommand a6 "cat $g" 0 "multi 1.2\nfirst\nsecond\n" ""
+docommand a7 "${builtin} get -p -r1.9 $s" 1 "" IGNORE
+docommand a8 "${builtin} val $s" 0 "" ""
+
+# The output is the same as that of the separate programs.
+for cmd in "get -p -m" "prs" "prt -e" "sact" "what"
+do
+    docommand b1 "${sccs} $cmd $s >expected.out 2>&1" IGNORE "" ""
+    docommand b2 "${builtin} $cmd $s >got.out 2>&1" IGNORE "" ""
+    docommand b3 "cmp expected.out got.out" 0 "" ""
+done
+remove expected.out got.out
+
+# A usage message comes from the right tool.
+docommand c1 "${builtin} get -Z $s 2>usage.out" 1 "" ""
+docommand c2 "grep '^usage: get ' usage.out" 0 IGNORE ""
+remove usage.out
+
+# With --prefix, the separate programs are used instead.
+docommand d1 "${sccsprog} --prefix=/nonexistent/ get -p $s" 69 "" IGNORE
+
+remove SCCS $g ,$g
+success
@@ -0,0 +1,127 @@
+#! /bin/sh
+# server.sh:  Testing for the csscd server and its use by the
+#             driver program "sccs".
+
+# Import common functions & definitions.
+. ../common/test-common
+. ../common/not-root
+
+# We want to prevent setlocale(LC_ALL, "") failing:
+unset LANG
+
+# We assume that all the files we want to work on are in the
+# current directory.
+unset PROJECTDIR
+unset CSSC_SERVER
+
+if test -x "${csscd}"
+then
+    true
+else
+    echo "${csscd} is not available, skipping these tests." >&2
+    success
+fi
+
+g=served
+s=SCCS/s.${g}
+remove command.log log log.stdout log.stderr SCCS $g
+mkdir SCCS 2>/dev/null
+
+# Socket names are limited in length, so we don't put it in the
+# current directory.
+sock=${TMPDIR:-/tmp}/cssc-server-test.$$
+server_pid=
+
+stop_server () {
+    if test -n "$server_pid"
+    then
+	kill $server_pid 2>/dev/null
+	wait $server_pid 2>/dev/null
+	server_pid=
+    fi
+    rm -f "$sock"
+}
+trap stop_server 0
+
+printf '%%M%% %%I%%\nfirst\n' > $g
+docommand a1 "${sccs} enter $g" 0 IGNORE IGNORE
+remove ,$g
+
+"${csscd}" -s"$sock" &
+server_pid=$!
+tries=0
+until test -S "$sock"
+do
+    tries=`expr $tries + 1`
+    if test $tries -gt 10
+    then
+	fail "csscd did not start"
+    fi
+    sleep 1
+done
+
+CSSC_SERVER="$sock"
+export CSSC_SERVER
+
+# The driver is given a program prefix which doesn't exist, so these
+# commands only succeed if the server runs them.
+served="${sccsprog} --prefix=/nonexistent/"
+
+docommand b1 "${served} get -p $s" 0 "served 1.1\nfirst\n" "1.1\n2 lines\n"
+docommand b2 "${served} get -p -s -k $s" 0 "%M% %I%\nfirst\n" ""
+docommand b3 "${served} prs -d:I:_:F: $s" 0 "1.1_s.served\n" ""
+docommand b4 "${served} prt -y $s" 0 IGNORE ""
+docommand b5 "${served} get -p -r1.5 $s" 1 "" IGNORE
+docommand b6 "${served} prs -d:I: SCCS/s.nonexistent" 1 "" \
+    "prs: Cannot open SCCS file SCCS/s.nonexistent for reading : No such file or directory\n\n"
+
+# The output is the same as that of the programs themselves.
+for cmd in "get -p -m" "prs" "prt -e"
+do
+    docommand c1 "${sccs} $cmd $s >expected.out 2>&1" 0 "" ""
+    docommand c2 "${served} $cmd $s >got.out 2>&1" 0 "" ""
+    docommand c3 "cmp expected.out got.out" 0 "" ""
+done
+remove expected.out got.out
+
+# A change to the history file is noticed.
+docommand d1 "${sccs} edit $s" 0 IGNORE IGNORE
+echo second >> $g
+docommand d2 "${sccs} delta -yadded $s" 0 IGNORE IGNORE
+docommand d3 "${served} prs -d:I: $s" 0 "1.2\n" ""
+docommand d4 "${served} get -p -s $s" 0 "served 1.2\nfirst\nsecond\n" ""
+
+# Commands which would change files are left to the real programs
+# (which can't be found here, hence EX_UNAVAILABLE).
+docommand e1 "${served} get $s" 69 "" IGNORE
+docommand e2 "test -f $g" 1 "" ""
+docommand e3 "${sccs} get $s" 0 IGNORE IGNORE
+docommand e4 "test -f $g" 0 "" ""
+
+# Without a server, the driver runs the programs itself.
+stop_server
+docommand f1 "${sccs} prs -d:I: $s" 0 "1.2\n" ""
+
+# So it does when the server hangs up without replying, as it would on
+# a client which it doesn't trust.
+hangup=../../testutils/hangup
+if test -x $hangup
+then
+    $hangup "$sock" &
+    server_pid=$!
+    tries=0
+    until test -S "$sock"
+    do
+	tries=`expr $tries + 1`
+	if test $tries -gt 10
+	then
+	    fail "hangup did not start"
+	fi
+	sleep 1
+    done
+    docommand f2 "${sccs} prs -d:I: $s" 0 "1.2\n" ""
+    stop_server
+fi
+
+remove SCCS $g
+success
@@ -0,0 +1,66 @@
+#! /bin/sh
+# basic.sh:  Tests for the basic operation of "comb".
+
+# Import common functions & definitions.
+. ../common/test-common
+
+g=testfile.txt
+s=s.$g
+p=p.$g
+remove command.log $g $s $p $g.got $g.1.2 $g.1.4 $g.1.2.1.1 s.orig
+
+# Make a delta of $g from the output of an awk program.
+change () {
+    sid="$1"
+    prog="$2"
+    remove $g
+    ${get} -e -r$sid $s >/dev/null 2>&1 || miscarry "cannot get -e -r$sid"
+    awk "$prog" < $g > $g.new || miscarry "cannot edit $g"
+    mv $g.new $g || miscarry "cannot edit $g"
+    ${delta} -ychange $s >/dev/null 2>&1 || miscarry "cannot make delta"
+}
+
+# 1.1 has ten lines; the trunk goes to 1.4 and 1.2 has a branch.
+awk 'BEGIN { for (i = 1; i <= 10; i++) print "line " i }' > $g ||
+    miscarry "cannot create $g"
+docommand b1 "${admin} -i$g $s" 0 "" IGNORE
+remove $g
+change 1.1 '{ print } NR == 3 { print "added in 1.2" }'
+change 1.2 'NR != 5 { print }'
+change 1.2 '$0 == "line 8" { print "changed on the branch"; next } { print }'
+change 1.3 'NR != 1 { print } END { print "added in 1.4" }'
+
+${get} -p -r1.2 $s > $g.1.2 2>/dev/null || miscarry "cannot get 1.2"
+${get} -p -r1.4 $s > $g.1.4 2>/dev/null || miscarry "cannot get 1.4"
+${get} -p -r1.2.1.1 $s > $g.1.2.1.1 2>/dev/null || miscarry "cannot get 1.2.1.1"
+cp $s s.orig || miscarry "cannot copy $s"
+
+# With no options, comb keeps the tip of each branch and the delta
+# where they divide.
+docommand b2 "${vg_comb} $s" 0 "" ""
+docommand b3 "${prs} -e -d':I: :DS: :DP: :Li:/:Ld:/:Lu:' $s" 0 \
+"1.4 3 1 00001/00002/00009
+1.2.1.1 2 1 00001/00001/00010
+1.2 1 0 00011/00000/00000
+" ""
+docommand b4 "${val} $s" 0 "" ""
+docommand b5 "${admin} -h $s" 0 "" ""
+
+docommand b6 "${get} -p -r1.4 $s > $g.got" 0 "" IGNORE
+docommand b7 "cmp $g.1.4 $g.got" 0 "" ""
+docommand b8 "${get} -p -r1.2.1.1 $s > $g.got" 0 "" IGNORE
+docommand b9 "cmp $g.1.2.1.1 $g.got" 0 "" ""
+docommand b10 "${get} -p -r1.2 $s > $g.got" 0 "" IGNORE
+docommand b11 "cmp $g.1.2 $g.got" 0 "" ""
+docommand b12 "${get} -p -r1.3 $s" 1 "" IGNORE
+
+# The combed file is smaller, and we can go on making deltas to it.
+docommand b13 "test \`wc -c < $s\` -lt \`wc -c < s.orig\`" 0 "" ""
+docommand b14 "${get} -e $s" 0 "1.4\nnew delta 1.5\n10 lines\n" IGNORE
+echo "added in 1.5" >> $g
+docommand b15 "${delta} -yNoComment $s" 0 \
+	"1.5\n1 inserted\n0 deleted\n10 unchanged\n" IGNORE
+docommand b16 "${val} $s" 0 "" ""
+
+remove command.log $g $s $p $g.got $g.1.2 $g.1.4 $g.1.2.1.1 s.orig
+success
@@ -0,0 +1,64 @@
+#! /bin/sh
+# options.sh:  Tests for the options of "comb".
+
+# Import common functions & definitions.
+. ../common/test-common
+
+g=testfile.txt
+s=s.$g
+p=p.$g
+remove command.log $g $s $p $g.got $g.1.3 $g.1.5 s.orig
+
+# Five deltas on the trunk, each adding a line.
+echo "line 1" > $g
+docommand o1 "${admin} -i$g $s" 0 "" IGNORE
+remove $g
+for i in 2 3 4 5
+do
+    ${get} -e $s >/dev/null 2>&1 || miscarry "cannot get -e"
+    echo "line $i" >> $g
+    ${delta} -ychange $s >/dev/null 2>&1 || miscarry "cannot make delta"
+done
+${get} -p -r1.3 $s > $g.1.3 2>/dev/null || miscarry "cannot get 1.3"
+${get} -p -r1.5 $s > $g.1.5 2>/dev/null || miscarry "cannot get 1.5"
+cp $s s.orig || miscarry "cannot copy $s"
+
+# -s reports the sizes and leaves the file alone.
+docommand o2 "${vg_comb} -s $s" 0 IGNORE ""
+docommand o3 "cmp $s s.orig" 0 "" ""
+
+# -p keeps the given delta and those after it.
+docommand o4 "${vg_comb} -p1.3 $s" 0 "" ""
+docommand o5 "${prs} -e -d':I: :Li:/:Ld:/:Lu:' $s" 0 \
+"1.5 00001/00000/00004
+1.4 00001/00000/00003
+1.3 00003/00000/00000
+" ""
+docommand o6 "${get} -p -r1.3 $s > $g.got" 0 "" IGNORE
+docommand o7 "cmp $g.1.3 $g.got" 0 "" ""
+docommand o8 "${val} $s" 0 "" ""
+
+# -c keeps just the deltas in the list.
+rm -f $s; cp s.orig $s || miscarry "cannot copy s.orig"
+docommand o9 "${vg_comb} -c1.1,1.3,1.5 $s" 0 "" ""
+docommand o10 "${prs} -e -d':I: :Li:/:Ld:/:Lu:' $s" 0 \
+"1.5 00002/00000/00003
+1.3 00002/00000/00001
+1.1 00001/00000/00000
+" ""
+docommand o11 "${get} -p -r1.5 $s > $g.got" 0 "" IGNORE
+docommand o12 "cmp $g.1.5 $g.got" 0 "" ""
+docommand o13 "${admin} -h $s" 0 "" ""
+
+# A file being edited is left alone.
+docommand o14 "${get} -e $s" 0 IGNORE IGNORE
+docommand o15 "${vg_comb} $s" 1 "" IGNORE
+docommand o16 "${unget} $s" 0 IGNORE IGNORE
+
+# Bad options.
+docommand o17 "${vg_comb} -p1.9 $s" 1 "" IGNORE
+docommand o18 "${vg_comb} -pfoo $s" 2 "" IGNORE
+docommand o19 "${vg_comb} -c1.9 $s" 1 "" IGNORE
+
+remove command.log $g $s $p $g.got $g.1.3 $g.1.5 s.orig
+success
@@ -0,0 +1,71 @@
+#! /bin/sh
+# T-option.sh:  Testing for the -T option of "delta" (a CSSC extension),
+#               which replaces the g-file with the new version as
+#               "get -t" would.
+
+# Import common functions & definitions.
+. ../common/test-common
+. ../common/real-thing
+
+if $TESTING_CSSC
+then
+    true
+else
+    echo "Skipping these tests, the -T option of delta is a CSSC extension." >&2
+    success
+fi
+
+g=foo
+s=s.$g
+b=bin
+sb=s.$b
+
+remove $s $g p.$g z.$g x.$g $sb $b p.$b z.$b x.$b expected
+
+# Create an SCCS file, and a binary one.
+printf '%%M%% %%I%%\nfirst\n' > $g
+docommand T1 "${admin} -i$g $s" 0 "" ""
+remove $g
+printf 'binary\000file\n' > $b
+docommand T2 "${admin} -b -i$b $sb" 0 "" IGNORE
+remove $b
+
+# Make a delta with -T; the g-file is read-only, and has the
+# keywords expanded.
+docommand T3 "${get} -e $s" 0 "1.1\nnew delta 1.2\n2 lines\n" ""
+echo second >> $g
+docommand T4 "${vg_delta} -T -yadded $s" 0 \
+    "1.2\n1 inserted\n0 deleted\n2 unchanged\n1.2\n3 lines\n" ""
+docommand T5 "cat $g" 0 "foo 1.2\nfirst\nsecond\n" ""
+docommand T6 "test -w $g" 1 "" ""
+docommand T7 "test -f p.$g" 1 "" ""
+
+# The result is the same as that of get.
+docommand T8 "${get} -p $s >expected" 0 "" IGNORE
+docommand T9 "cmp expected $g" 0 "" ""
+
+# With several files, the output of get comes after that of delta.
+docommand T10 "${get} -e $s $sb" 0 IGNORE IGNORE
+echo third >> $g
+printf 'more\000data\n' >> $b
+docommand T11 "${vg_delta} -T -ymore $s $sb" 0 \
+"1.3\n1 inserted\n0 deleted\n3 unchanged\n1.2\n1 inserted\n1 deleted\n1 unchanged\n\n$s:\n1.3\n4 lines\n\n$sb:\n1.2\n2 lines\n" IGNORE
+docommand T12 "${get} -p $sb >expected" 0 "" IGNORE
+docommand T13 "cmp expected $b" 0 "" ""
+docommand T14 "test -w $b" 1 "" ""
+
+# If get -t would retrieve some other delta, that is what we get.
+docommand T15 "${admin} -fd1.1 $s" 0 "" ""
+docommand T16 "${get} -e -r1.3 $s" 0 IGNORE IGNORE
+echo fourth >> $g
+docommand T17 "${vg_delta} -T -s -yfourth $s" 0 "" ""
+docommand T18 "cat $g" 0 "foo 1.1\nfirst\n" ""
+
+# If the delta fails, the g-file is left alone.
+remove $g
+echo changed > $g
+docommand T19 "${vg_delta} -T -ynothing $s" 1 "" IGNORE
+docommand T20 "cat $g" 0 "changed\n" ""
+
+remove $s $g p.$g z.$g x.$g $sb $b p.$b z.$b x.$b expected
+success
@@ -0,0 +1,79 @@
+#! /bin/sh
+# big-seqno.sh:  Serial numbers beyond the SCCS limit of 65535.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+g=big
+s=s.$g
+p=p.$g
+remove command.log $g $s $p $g.got
+
+# Write a history file whose newest delta already has serial number
+# 65535, each delta after the first changing nothing.  SID components
+# cannot go beyond 9999, so there are 9000 deltas in each release (the
+# last is 8.2535).  We write "@" for ^A and fix the checksum afterward.
+last=65535
+awk -v last=$last 'BEGIN {
+    print "@h00000"
+    for (i = last; i >= 1; i--) {
+        if (i > 1)
+            print "@s 00000/00000/00001"
+        else
+            print "@s 00001/00000/00000"
+        printf("@d D %d.%d 11/04/30 19:10:00 james %d %d\n",
+               1 + int((i - 1) / 9000), 1 + (i - 1) % 9000, i, i - 1)
+        print "@e"
+    }
+    print "@u"
+    print "@U"
+    print "@t"
+    print "@T"
+    print "@I 1"
+    print "the only line"
+    print "@E 1"
+}' | tr '@' '\001' > $s || miscarry "cannot create $s"
+${admin} -z $s || miscarry "cannot fix the checksum of $s"
+
+docommand e1 "${val} $s" 0 "" ""
+docommand e2 "${prs} -d:DS: $s" 0 "65535\n" ""
+
+# Without CSSC_EXTENDED_SEQNO, delta refuses to go past the limit, and
+# leaves the file alone.
+CSSC_EXTENDED_SEQNO=disabled
+export CSSC_EXTENDED_SEQNO
+docommand e3 "${get} -e $s" 0 "8.2535\nnew delta 8.2536\n1 lines\n" IGNORE
+echo "another line" >> $g
+docommand e4 "${vg_delta} -yx $s" 1 "" IGNORE
+docommand e5 "${prs} -d:DS: $s" 0 "65535\n" ""
+docommand e6 "test -f $p" 0 "" ""
+
+# With it, the new delta gets serial number 65536 and everything still
+# reads the file.
+CSSC_EXTENDED_SEQNO=enabled
+docommand e7 "${vg_delta} -yx $s" 0 \
+    "8.2536\n1 inserted\n0 deleted\n1 unchanged\n" IGNORE
+docommand e8 "${prs} -d':DS: :DP:' $s" 0 "65536 65535\n" ""
+docommand e9 "${val} $s" 0 "" ""
+docommand e9a "${prt} -y $s | sed -n 2p | cut -f4" 0 "65536 65535\n" ""
+docommand e10 "${get} -p $s" 0 "the only line\nanother line\n" IGNORE
+docommand e11 "${get} -p -r8.2535 $s" 0 "the only line\n" IGNORE
+docommand e12 "${get} -p -a65536 $s" 0 "the only line\nanother line\n" IGNORE
+docommand e13 "${vg_rmdel} -r8.2536 $s" 0 "" ""
+docommand e14 "${val} $s" 0 "" ""
+docommand e15 "${get} -p $s" 0 "the only line\n" IGNORE
+
+unset CSSC_EXTENDED_SEQNO
+
+# A serial number far beyond the number of deltas means the file is
+# corrupt; we must not try to make room for that many deltas.
+remove $s
+printf '%s\n' "@h00000" "@s 00001/00000/00000" \
+    "@d D 1.1 11/04/30 19:10:00 james 4000000000 0" "@e" \
+    "@u" "@U" "@t" "@T" "@I 4000000000" "the only line" "@E 4000000000" |
+    tr '@' '\001' > $s || miscarry "cannot create $s"
+docommand e16 "${get} -p $s" 1 "" IGNORE
+docommand e17 "${prs} -d:DS: $s" 1 "" IGNORE
+
+remove command.log $g $s $p $g.got
+success
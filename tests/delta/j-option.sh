@@ -0,0 +1,76 @@
+#! /bin/sh
+# j-option.sh:  Testing for the -j option of "delta" (a CSSC extension),
+#               which makes the deltas for several files at once.
+
+# Import common functions & definitions.
+. ../common/test-common
+. ../common/real-thing
+
+if $TESTING_CSSC
+then
+    true
+else
+    echo "Skipping these tests, the -j option of delta is a CSSC extension." >&2
+    success
+fi
+
+files="a b c d e f g h"
+cleanup () {
+    for f in $files
+    do
+	remove $f s.$f p.$f z.$f x.$f
+    done
+    remove command.log expected
+}
+cleanup
+
+for f in $files
+do
+    printf '%%M%%\nfirst\n' > $f
+    docommand j1-$f "${admin} -i$f s.$f" 0 "" ""
+    remove $f
+done
+docommand j2 "${get} -e s.a s.b s.c s.d s.e s.f s.g s.h" 0 IGNORE ""
+for f in $files
+do
+    echo "second $f" >> $f
+done
+
+# One of the files has no edit outstanding.
+remove p.c
+
+# The output is the same as it would be for one file at a time, in
+# the order the files were named; only the failure for s.c is
+# reported on stderr.
+docommand j3 "${vg_delta} -j4 -yadded s.a s.b s.c s.d s.e s.f s.g s.h" 1 \
+"1.2\n1 inserted\n0 deleted\n2 unchanged\n1.2\n1 inserted\n0 deleted\n2 unchanged\n1.2\n1 inserted\n0 deleted\n2 unchanged\n1.2\n1 inserted\n0 deleted\n2 unchanged\n1.2\n1 inserted\n0 deleted\n2 unchanged\n1.2\n1 inserted\n0 deleted\n2 unchanged\n1.2\n1 inserted\n0 deleted\n2 unchanged\n" \
+IGNORE
+for f in $files
+do
+    if test $f = c
+    then
+	docommand j4-$f "test -f $f" 0 "" ""
+    else
+	docommand j4-$f "${get} -p s.$f" 0 "$f\nfirst\nsecond $f\n" IGNORE
+	docommand j5-$f "test -f p.$f" 1 "" ""
+	docommand j6-$f "test -f z.$f" 1 "" ""
+	docommand j7-$f "test -f $f" 1 "" ""
+    fi
+done
+docommand j8 "${val} s.a s.b s.c s.d s.e s.f s.g s.h" 0 "" ""
+
+# -T works with -j too, and the output of get still comes last.
+docommand j9 "${get} -e s.a s.b" 0 IGNORE ""
+echo third >> a
+echo third >> b
+docommand j10 "${vg_delta} -j2 -T -ymore s.a s.b" 0 \
+"1.3\n1 inserted\n0 deleted\n3 unchanged\n1.3\n1 inserted\n0 deleted\n3 unchanged\n\ns.a:\n1.3\n4 lines\n\ns.b:\n1.3\n4 lines\n" \
+""
+docommand j11 "cat a" 0 "a\nfirst\nsecond a\nthird\n" ""
+
+# A bad number of jobs is rejected.
+docommand j12 "${delta} -j0 -yx s.a" 1 "" IGNORE
+docommand j13 "${delta} -jx -yx s.a" 1 "" IGNORE
+
+cleanup
+success
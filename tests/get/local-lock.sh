@@ -0,0 +1,41 @@
+#! /bin/sh
+# local-lock.sh:  Taking the lock on a history file in a directory
+#                 which has scratch files left over from locking
+#                 other history files.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+g=lock.txt
+s=s.$g
+p=p.$g
+z=z.$g
+scratch="nfslck0 nfslck1 nfslck2 nfslck3 nfslck4 nfslck5 nfslck6 nfslck7"
+remove command.log $g $s $p $z
+rmdir $scratch 2>/dev/null
+
+echo "hello" > $g
+docommand l1 "${admin} -i$g $s" 0 "" IGNORE
+remove $g
+
+# On a local file system we do not use the scratch files at all, and
+# otherwise we skip over them (after waiting a little).
+for f in $scratch
+do
+    mkdir $f || miscarry "cannot create $f"
+done
+docommand l2 "${get} -e $s" 0 "1.1\nnew delta 1.2\n1 lines\n" IGNORE
+docommand l3 "test -f $z" 1 "" ""
+echo "world" >> $g
+docommand l4 "${delta} -yNoComment $s" 0 \
+	"1.2\n1 inserted\n0 deleted\n1 unchanged\n" IGNORE
+docommand l5 "test -f $z" 1 "" ""
+docommand l6 "${get} -p $s" 0 "hello\nworld\n" IGNORE
+for f in $scratch
+do
+    docommand l7-$f "test -d $f" 0 "" ""
+done
+
+rmdir $scratch
+remove command.log $g $s $p $z
+success
@@ -0,0 +1,54 @@
+#! /bin/sh
+# lock-timeout.sh:  Giving up on a lock which is held for too long,
+#                   and reporting what waiting for a lock cost.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+g=timeout.txt
+s=s.$g
+p=p.$g
+z=z.$g
+remove command.log $g $s $p $z stats.out
+
+echo "hello" > $g
+docommand t1 "${admin} -i$g $s" 0 "" IGNORE
+remove $g
+
+# Someone else holds the lock, so we give up once the timeout passes
+# rather than waiting for ever.
+echo "12345" > $z || miscarry "cannot create $z"
+docommand t2 "CSSC_LOCK_TIMEOUT=1 ${get} -e $s" 1 "" IGNORE
+docommand t3 "test -f $p" 1 "" ""
+docommand t4 "cat $z" 0 "12345\n" ""
+docommand t5 "CSSC_LOCK_TIMEOUT=0 CSSC_LOCK_STATS=enabled ${get} -e $s 2>stats.out" \
+	1 "" ""
+docommand t6 "grep 'lock not acquired after' stats.out >/dev/null" 0 "" ""
+remove $z
+
+# Once the lock is free we take it as usual.
+docommand t7 "CSSC_LOCK_TIMEOUT=1 CSSC_LOCK_STATS=enabled ${get} -e $s 2>stats.out" \
+	0 "1.1\nnew delta 1.2\n1 lines\n" ""
+docommand t8 "grep 'lock acquired after 0 retries' stats.out >/dev/null" 0 "" ""
+docommand t9 "test -f $z" 1 "" ""
+
+# Bad values are rejected.
+docommand t10 "CSSC_LOCK_TIMEOUT=soon ${delta} -yNoComment $s" 1 "" IGNORE
+docommand t11 "CSSC_LOCK_STATS=yes ${delta} -yNoComment $s" 1 "" IGNORE
+docommand t12 "test -f $p" 0 "" ""
+docommand t13 "test -f $z" 1 "" ""
+
+# A timeout too long to add to the clock is as good as forever, so we
+# wait for the lock instead of giving up at once.
+docommand t14 "${unget} -n $s" 0 "1.2\n" IGNORE
+remove $g
+echo "12345" > $z || miscarry "cannot create $z"
+( sleep 2; rm -f $z ) &
+docommand t15 "CSSC_LOCK_TIMEOUT=9223372036854775807 ${get} -e $s" \
+	0 "1.1\nnew delta 1.2\n1 lines\n" IGNORE
+wait
+docommand t16 "test -f $p" 0 "" ""
+docommand t17 "test -f $z" 1 "" ""
+
+remove command.log $g $s $p $z stats.out
+success
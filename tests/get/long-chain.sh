@@ -0,0 +1,48 @@
+#! /bin/sh
+# long-chain.sh:  get on a file with a long chain of deltas.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+g=chain
+s=s.$g
+remove command.log $g $s
+
+# Write a history file with 200 deltas on the trunk, where delta N
+# adds the line "line N".  We write "@" for ^A and fix the checksum
+# afterward.
+awk 'BEGIN {
+    print "@h00000"
+    for (i = 200; i >= 1; i--) {
+        printf("@s 00001/00000/%05d\n", i - 1)
+        printf("@d D 1.%d %s 12:00:00 james %d %d\n", i,
+               i < 100 ? "11/04/30" : "11/05/01", i, i - 1)
+        print "@e"
+    }
+    print "@u"
+    print "@U"
+    print "@t"
+    print "@T"
+    for (i = 200; i >= 1; i--) {
+        printf("@I %d\nline %d\n@E %d\n", i, i, i)
+    }
+}' | tr '@' '\001' > $s || miscarry "cannot create $s"
+${admin} -z $s || miscarry "cannot fix the checksum of $s"
+
+expect () {
+    awk -v n=$1 'BEGIN { for (i = n; i >= 1; i--) print "line " i }'
+}
+
+# The chain of each delta has a bit in the same word as the next 63;
+# try the ones at the ends of those words.
+docommand c1 "${vg_get} -p -r1.63 $s" 0 "`expect 63`\n" IGNORE
+docommand c2 "${vg_get} -p -r1.64 $s" 0 "`expect 64`\n" IGNORE
+docommand c3 "${vg_get} -p -r1.127 $s" 0 "`expect 127`\n" IGNORE
+docommand c4 "${vg_get} -p -r1.128 $s" 0 "`expect 128`\n" IGNORE
+docommand c5 "${vg_get} -p $s" 0 "`expect 200`\n" IGNORE
+
+# A cutoff date excludes everything from delta 100 on.
+docommand c6 "${vg_get} -p -c110430235959 $s" 0 "`expect 99`\n" IGNORE
+
+remove command.log $g $s
+success
@@ -0,0 +1,40 @@
+#! /bin/sh
+# stats.sh:  Reporting timings and counts with CSSC_STATS.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+g=stats.txt
+s=s.$g
+remove command.log $g $s stats.out stats.json
+
+printf 'one\ntwo\nthree\n' > $g
+docommand s1 "${admin} -i$g $s" 0 "" IGNORE
+remove $g
+
+# The report does not change the output, and goes to stderr.
+docommand s2 "CSSC_STATS=enabled ${get} -p $s 2>stats.out" \
+	0 "one\ntwo\nthree\n" ""
+docommand s3 "grep '\"lines_emitted\": 3' stats.out >/dev/null" 0 "" ""
+docommand s4 "grep '\"body\": {\"wall\": ' stats.out >/dev/null" 0 "" ""
+docommand s5 "grep '\"program\": ' stats.out >/dev/null" 0 "" ""
+
+# Each byte of the file is counted once, although it is read twice.
+size=`wc -c < $s | tr -d ' '`
+docommand s5a "grep '\"bytes_read\": $size,' stats.out >/dev/null" 0 "" ""
+
+# With CSSC_STATS_FILE, each report is added to that file instead.
+docommand s6 "CSSC_STATS=enabled CSSC_STATS_FILE=stats.json ${get} -p $s" \
+	0 "one\ntwo\nthree\n" IGNORE
+docommand s7 "CSSC_STATS=enabled CSSC_STATS_FILE=stats.json ${prs} -d:I: $s" \
+	0 "1.1\n" ""
+docommand s8 "wc -l < stats.json | tr -d ' '" 0 "2\n" ""
+
+# Nothing is reported unless it is enabled, and bad values are rejected.
+docommand s9 "CSSC_STATS=disabled ${get} -p $s 2>stats.out" \
+	0 "one\ntwo\nthree\n" ""
+docommand s10 "grep '\"program\": ' stats.out" 1 "" ""
+docommand s11 "CSSC_STATS=yes ${get} -p $s" 1 "" IGNORE
+
+remove command.log $g $s stats.out stats.json
+success
@@ -0,0 +1,35 @@
+#! /bin/sh
+# listing.sh:  Tests for prs -L, one line for each history file.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+d=listing
+remove command.log $d
+mkdir $d || miscarry "cannot create $d"
+
+docommand l1 "${admin} -n -yfirst $d/s.one" 0 "" IGNORE
+docommand l2 "${admin} -n '-ythe second
+has two lines' $d/s.two" 0 "" IGNORE
+echo "not a history file" > $d/notes || miscarry "cannot create $d/notes"
+
+# One line for each history file in the directory, and none for
+# other files (in the order the directory lists them).  Newlines in
+# the comments become spaces.
+docommand l3 "${prs} -L -d':F: :I: :C:' $d | sort" 0 \
+"s.one 1.1 first\ns.two 1.1 the second has two lines\n" ""
+docommand l4 "${vg_prs} -L -d':F:' $d/s.two $d/s.one" 0 \
+"s.two\ns.one\n" ""
+
+# The default format gives the name, SID, date and user, separated
+# by tabs.
+docommand l5 "${prs} -L $d/s.one | awk -F'	' '{print \$1, \$2, NF}'" 0 \
+"s.one 1.1 4\n" ""
+
+# The checksum is not checked, since the body is not read.
+sed -e '1s/^.h[0-9]*/&1/' < $d/s.one > $d/s.bad || miscarry "cannot create $d/s.bad"
+docommand l6 "${vg_prs} -L -d':F: :I:' $d/s.bad" 0 "s.bad 1.1\n" ""
+docommand l7 "${vg_prs} -d':F: :I:' $d/s.bad" 0 "s.bad 1.1\n" IGNORE
+
+remove command.log $d
+success
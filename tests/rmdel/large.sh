@@ -0,0 +1,33 @@
+#! /bin/sh
+# large.sh:  rmdel on a body bigger than the buffer rmdel copies it in.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+g=large.txt
+s=s.$g
+p=p.$g
+remove command.log $g $s $p $g.1 $g.2 $g.got
+
+# A file of a couple of megabytes, so that the control lines of the
+# removed delta are spread over several buffers.
+awk 'BEGIN { for (i = 1; i <= 200000; i++) printf("line %d of the file\n", i) }' \
+    > $g.1 || miscarry "cannot create $g.1"
+awk 'NR % 777 != 0 { print } NR % 1000 == 0 { print "inserted after line " NR }' \
+    < $g.1 > $g.2 || miscarry "cannot create $g.2"
+
+cp $g.1 $g || miscarry "cannot copy $g.1"
+docommand r1 "${admin} -i$g $s" 0 "" IGNORE
+remove $g
+docommand r2 "${get} -e $s" 0 IGNORE IGNORE
+cp $g.2 $g || miscarry "cannot copy $g.2"
+docommand r3 "${delta} -yx $s" 0 IGNORE IGNORE
+
+docommand r4 "${vg_rmdel} -r1.2 $s" 0 "" ""
+docommand r5 "${admin} -h $s" 0 "" ""
+docommand r6 "${val} $s" 0 "" ""
+docommand r7 "${get} -p $s > $g.got" 0 "" IGNORE
+docommand r8 "cmp $g.1 $g.got" 0 "" ""
+
+remove command.log $g $s $p $g.1 $g.2 $g.got
+success
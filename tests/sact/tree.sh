@@ -0,0 +1,48 @@
+#! /bin/sh
+# tree.sh:  Tests for sact -R, which reports the locks in a whole tree.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+d=tree
+remove command.log $d errors
+mkdir $d $d/a $d/a/b $d/c $d/s.old $d/p.tmp || miscarry "cannot create $d"
+
+for f in $d/one $d/a/two $d/a/b/three $d/a/b/four $d/c/five \
+    $d/s.old/seven $d/p.tmp/eight
+do
+    sub=`dirname $f`
+    base=`basename $f`
+    docommand "mk-$base" "${admin} -n $sub/s.$base" 0 "" IGNORE
+done
+
+# Nothing is being edited yet.
+docommand t1 "${vg_sact} -R $d" 0 "" ""
+
+docommand t2 "(cd $d/a && ${get} -e b/s.three)" 0 IGNORE IGNORE
+docommand t3 "(cd $d && ${get} -e s.one)" 0 IGNORE IGNORE
+docommand t4 "(cd $d/a && ${get} -e s.two)" 0 IGNORE IGNORE
+
+# A p-file without an s-file is not a lock on anything.
+echo junk > $d/c/p.six || miscarry "cannot create $d/c/p.six"
+
+# Directories whose names look like those of s-files or p-files are
+# searched like any other.
+docommand t4a "(cd $d/s.old && ${get} -e s.seven)" 0 IGNORE IGNORE
+docommand t4b "(cd $d/p.tmp && ${get} -e s.eight)" 0 IGNORE IGNORE
+
+# Only the names of the locked files are checked here, since the rest
+# of the output depends on the time and the user.
+docommand t5 "${sact} -R $d | grep ':\$'" 0 \
+"$d/a/b/s.three:\n$d/a/s.two:\n$d/p.tmp/s.eight:\n$d/s.old/s.seven:\n$d/s.one:\n" ""
+docommand t6 "${sact} -R -j3 $d/a $d/c | grep ':\$'" 0 \
+"$d/a/b/s.three:\n$d/a/s.two:\n" ""
+docommand t7 "(cd $d/a && ${sact} -R) | grep -c '^1.1 1.2 '" 0 "2\n" ""
+
+docommand t8 "${vg_sact} -R -j0 $d" 1 "" IGNORE
+docommand t9 "${vg_sact} -R $d/nonexistent 2>errors" 1 "" ""
+docommand t10 "grep -c nonexistent errors" 0 "1\n" ""
+remove errors
+
+remove command.log $d errors
+success
@@ -0,0 +1,94 @@
+#! /bin/sh
+
+# body.sh:  Tests for the checks val makes on the body of an SCCS file.
+
+# Import common functions & definitions.
+. ../common/test-common
+
+s=s.body
+s2=s.body2
+remove $s $s2
+
+# Write a history file with two deltas whose body is made of the
+# arguments.  We write "@" for ^A, and fix the checksum afterward.
+mkbody () {
+    remove $s
+    ( echo '@h00000'
+      echo '@s 00002/00001/00002'
+      echo '@d D 1.2 11/04/30 19:10:00 james 2 1'
+      echo '@c second'
+      echo '@e'
+      echo '@s 00003/00000/00000'
+      echo '@d D 1.1 11/04/30 19:09:44 james 1 0'
+      echo '@c first'
+      echo '@e'
+      echo '@u'
+      echo '@U'
+      echo '@t'
+      echo '@T'
+      for line
+      do
+	echo "$line"
+      done ) | tr '@' '\001' > $s || miscarry "cannot create $s"
+    ${admin} -z $s || miscarry "cannot fix the checksum of $s"
+}
+
+# A correct body.
+mkbody '@I 1' a '@D 2' b '@E 2' '@I 2' x '@E 2' c '@E 1' '@I 2' d '@E 2'
+docommand b1 "${vg_val} $s" 0 "" ""
+
+# An empty body is fine when no lines were inserted, but here it isn't.
+mkbody
+docommand b2 "${vg_val} $s" 32 "" IGNORE
+
+# Missing ^AE.
+mkbody '@I 1' a '@D 2' b '@I 2' x '@E 2' c '@E 1' '@I 2' d '@E 2'
+docommand b3 "${vg_val} $s" 32 "" IGNORE
+
+# Block still open at the end of the file.
+mkbody '@I 1' a '@D 2' b '@E 2' '@I 2' x '@E 2' c '@E 1' '@I 2' d
+docommand b4 "${vg_val} $s" 32 "" IGNORE
+
+# ^AE for a block which is not open.
+mkbody '@I 1' a '@D 2' b '@E 2' '@E 2' '@I 2' x '@E 2' c '@E 1' '@I 2' d '@E 2'
+docommand b5 "${vg_val} $s" 32 "" IGNORE
+
+# Serial number which does not belong to any delta.
+mkbody '@I 1' a '@D 2' b '@E 2' '@I 3' x '@E 3' c '@E 1' '@I 2' d '@E 2'
+docommand b6 "${vg_val} $s" 32 "" IGNORE
+
+# Insertion blocks which overlap rather than nest.
+mkbody '@I 1' a '@D 2' b '@E 2' '@I 2' x '@E 1' c '@E 2' '@I 2' d '@E 2'
+docommand b7 "${vg_val} $s" 32 "" IGNORE
+
+# An earlier delta's insertion inside a later one's.
+mkbody '@I 2' a '@I 1' a '@D 2' b '@E 2' c '@E 1' '@E 2'
+docommand b8 "${vg_val} $s" 32 "" IGNORE
+
+# Text which is not inside any insertion.
+mkbody '@I 1' a '@D 2' b '@E 2' '@I 2' x '@E 2' c '@E 1' '@I 2' d '@E 2' e
+docommand b9 "${vg_val} $s" 32 "" IGNORE
+
+# A control line which does not belong in the body.
+mkbody '@I 1' a '@D 2' b '@E 2' '@I 2' x '@E 2' c '@X 1' '@E 1' '@I 2' d '@E 2'
+docommand b10 "${vg_val} $s" 32 "" IGNORE
+
+# Line counts which disagree with the delta table.
+mkbody '@I 1' a '@D 2' b '@E 2' '@I 2' x y '@E 2' c '@E 1' '@I 2' d '@E 2'
+docommand b11 "${vg_val} $s" 32 "" IGNORE
+
+# With -j, files are checked in parallel but the diagnostics still come
+# out in the order in which the files were named.
+cp $s $s2 || miscarry "cannot copy $s"
+docommand b12 "${vg_val} -j3 $s ../val/s.comment-nospace $s2 $s 2>&1 |
+	sed -e 's/^[^:]*: //'" 0 \
+"$s: SID 1.2: delta table says 2 lines were inserted, but the body has 3
+$s2: SID 1.2: delta table says 2 lines were inserted, but the body has 3
+$s: SID 1.2: delta table says 2 lines were inserted, but the body has 3
+" ""
+docommand b13 "${vg_val} -j3 $s ../val/s.comment-nospace $s2" 32 "" IGNORE
+docommand b14 "${vg_val} -j2 ../val/s.comment-nospace" 0 "" ""
+docommand b15 "${vg_val} -j0 ../val/s.comment-nospace" 64 "" IGNORE
+
+remove $s $s2
+success
@@ -0,0 +1,109 @@
+/* hangup.c: Part of GNU CSSC.
+ *
+ * Copyright (C) 2026 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* This program is not installed as part of CSSC.  It's just used by
+ * the test suite.  It listens on the Unix-domain socket named by its
+ * argument, accepts one connection and hangs up on it without
+ * replying, as a server which will not talk to the client does.  The
+ * "sccs" driver should then run the command itself.
+ */
+#include <config.h>
+
+#include <errno.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "gettext.h"
+#include "progname.h"
+
+int
+main(int argc, char *argv[])
+{
+  struct sockaddr_un addr;
+  const char *prog;
+  char buf[512];
+  int sock, fd;
+  ssize_t n;
+
+  set_program_name (argv[0]);
+  if (NULL == setlocale(LC_ALL, ""))
+    {
+      /* If we can't set the locale as the user wishes,
+       * emit an error message and continue.   The error
+       * message will of course be in the "C" locale.
+       */
+      perror("Error setting locale");
+    }
+  bindtextdomain (PACKAGE, LOCALEDIR);
+  textdomain (PACKAGE);
+
+  prog = program_name ? program_name : "hangup";
+  if (argc != 2)
+    {
+      fprintf(stderr, "usage: %s socket\n", prog);
+      return 2;
+    }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(argv[1]) >= sizeof(addr.sun_path))
+    {
+      fprintf(stderr, "%s: socket name %s is too long\n", prog, argv[1]);
+      return 2;
+    }
+  strcpy(addr.sun_path, argv[1]);
+
+  sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0
+      || bind(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0
+      || listen(sock, 1) != 0)
+    {
+      fprintf(stderr, "%s: %s: %s\n", prog, argv[1], strerror(errno));
+      return 1;
+    }
+
+  do
+    fd = accept(sock, NULL, NULL);
+  while (fd < 0 && errno == EINTR);
+  if (fd < 0)
+    {
+      fprintf(stderr, "%s: accept: %s\n", prog, strerror(errno));
+      unlink(argv[1]);
+      return 1;
+    }
+
+  /* The client sees the end of the reply at once, but can still send
+   * its whole request without being killed by SIGPIPE.
+   */
+  shutdown(fd, SHUT_WR);
+  while ((n = read(fd, buf, sizeof(buf))) != 0)
+    {
+      if (n < 0 && errno != EINTR)
+        break;
+    }
+  close(fd);
+  close(sock);
+  unlink(argv[1]);
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * test_ancestry.cc: Part of GNU CSSC.
+ *
+ * Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Unit tests for ancestry.h.
+ *
+ */
+#include <set>
+#include <string>
+#include <vector>
+#include "ancestry.h"
+#include "delta-table.h"
+#include "delta.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+  void add(cssc_delta_table& t, seq_no seq, seq_no prev)
+  {
+    const std::vector<std::string> none;
+    t.add(delta('D', sid("1.1"), sccs_date(), "user", seq, prev, none, none));
+  }
+
+  // Predecessor of seq in a table where every seventh delta starts a
+  // branch from a delta some way back.
+  seq_no pred(seq_no seq)
+  {
+    if (seq == 1)
+      return 0;
+    if (seq % 7 == 0)
+      return seq > 100 ? seq - 100 : 1;
+    return seq - 1;
+  }
+
+  std::set<seq_no> walk(const cssc_delta_table& t, seq_no seq)
+  {
+    std::set<seq_no> result;
+    for (seq_no s = seq; s; s = t.delta_at_seq(s).prev_seq())
+      result.insert(s);
+    return result;
+  }
+
+  std::set<seq_no> members(const seq_set& set, seq_no highest)
+  {
+    std::set<seq_no> result;
+    for (seq_no s = 0; s <= highest; ++s)
+      {
+	if (ancestry_index::member(set, s))
+	  result.insert(s);
+      }
+    return result;
+  }
+}
+
+TEST(Ancestry, Empty)
+{
+  cssc_delta_table t;
+  ancestry_index index(t);
+  EXPECT_EQ(0, index.highest_seqno());
+  EXPECT_FALSE(index.chain_ok(0));
+  EXPECT_FALSE(index.chain_ok(1));
+  EXPECT_FALSE(index.has_seq_lists());
+}
+
+TEST(Ancestry, MatchesWalk)
+{
+  const seq_no highest = 700;
+  cssc_delta_table t;
+  for (seq_no s = highest; s > 0; --s)
+    add(t, s, pred(s));
+
+  // Ask in several orders, since the saved bitsets depend on the
+  // questions asked so far.
+  ancestry_index down(t), up(t), skip(t);
+  for (seq_no s = highest; s > 0; --s)
+    {
+      ASSERT_TRUE(down.chain_ok(s));
+      EXPECT_EQ(walk(t, s), members(down.ancestors(s), highest)) << s;
+    }
+  for (seq_no s = 1; s <= highest; ++s)
+    EXPECT_EQ(walk(t, s), members(up.ancestors(s), highest)) << s;
+  for (seq_no s = 3; s <= highest; s += 97)
+    EXPECT_EQ(walk(t, s), members(skip.ancestors(s), highest)) << s;
+  EXPECT_FALSE(down.has_seq_lists());
+}
+
+TEST(Ancestry, BrokenChains)
+{
+  cssc_delta_table t;
+  add(t, 1, 0);
+  add(t, 2, 1);
+  add(t, 3, 3);			// its own predecessor
+  add(t, 4, 3);			// descends from a broken delta
+  add(t, 6, 5);			// 5 is missing
+  add(t, 7, 2);
+  ancestry_index index(t);
+  EXPECT_TRUE(index.chain_ok(1));
+  EXPECT_TRUE(index.chain_ok(2));
+  EXPECT_FALSE(index.chain_ok(3));
+  EXPECT_FALSE(index.chain_ok(4));
+  EXPECT_FALSE(index.chain_ok(5));
+  EXPECT_FALSE(index.chain_ok(6));
+  EXPECT_TRUE(index.chain_ok(7));
+  EXPECT_FALSE(index.chain_ok(8));
+  EXPECT_EQ(std::set<seq_no>({1, 2, 7}), members(index.ancestors(7), 7));
+}
+
+TEST(Ancestry, SeqLists)
+{
+  cssc_delta_table t;
+  const std::vector<std::string> none;
+  add(t, 1, 0);
+  add(t, 2, 1);
+  t.add(delta('D', sid("1.3"), sccs_date(), "user", 3, 2,
+	      std::set<seq_no>(), std::set<seq_no>({2}), none, none));
+  ancestry_index index(t);
+  EXPECT_TRUE(index.has_seq_lists());
+}
@@ -0,0 +1,135 @@
+/*
+ * test_comb_plan.cc: Part of GNU CSSC.
+ *
+ * Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Unit tests for comb-plan.h.
+ *
+ */
+#include <string>
+#include <vector>
+#include "comb-plan.h"
+#include "delta-table.h"
+#include "delta.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+  void add(cssc_delta_table& t, seq_no seq, seq_no prev, char type = 'D')
+  {
+    const std::vector<std::string> none;
+    t.add(delta(type, sid("1.1"), sccs_date(), "user", seq, prev, none, none));
+  }
+
+  std::vector<bool> wanting(seq_no highest, std::vector<seq_no> seqs)
+  {
+    std::vector<bool> result(highest + 1u, false);
+    for (seq_no s : seqs)
+      result[s] = true;
+    return result;
+  }
+
+  // 1 - 2 - 3 - 5 - 7
+  //      \
+  //       4 - 6
+  //        \
+  //         8
+  void tree(cssc_delta_table& t)
+  {
+    add(t, 8, 4);
+    add(t, 7, 5);
+    add(t, 6, 4);
+    add(t, 5, 3);
+    add(t, 4, 2);
+    add(t, 3, 2);
+    add(t, 2, 1);
+    add(t, 1, 0);
+  }
+}
+
+TEST(CombPlan, KeepAll)
+{
+  cssc_delta_table t;
+  tree(t);
+  comb_plan plan(t, wanting(8, {1, 2, 3, 4, 5, 6, 7, 8}));
+  ASSERT_EQ(8u, plan.kept());
+  for (seq_no s = 1; s <= 8; ++s)
+    {
+      EXPECT_EQ(s, plan.new_seq(s));
+      EXPECT_EQ(s, plan.old_seq(s));
+      EXPECT_EQ(s, plan.top(s));
+      EXPECT_EQ(t.delta_at_seq(s).prev_seq(), plan.new_prev(s));
+    }
+}
+
+TEST(CombPlan, BranchPoints)
+{
+  cssc_delta_table t;
+  tree(t);
+  // Keeping the leaves also keeps 2 and 4, where they divide.
+  comb_plan plan(t, wanting(8, {6, 7, 8}));
+  ASSERT_EQ(5u, plan.kept());
+  EXPECT_EQ(1u, plan.new_seq(2));
+  EXPECT_EQ(2u, plan.new_seq(4));
+  EXPECT_EQ(3u, plan.new_seq(6));
+  EXPECT_EQ(4u, plan.new_seq(7));
+  EXPECT_EQ(5u, plan.new_seq(8));
+  EXPECT_EQ(0u, plan.new_seq(1));
+  EXPECT_EQ(0u, plan.new_seq(3));
+  EXPECT_EQ(0u, plan.new_seq(5));
+
+  EXPECT_EQ(0u, plan.new_prev(1));
+  EXPECT_EQ(1u, plan.new_prev(2));
+  EXPECT_EQ(2u, plan.new_prev(3));
+  EXPECT_EQ(1u, plan.new_prev(4));
+  EXPECT_EQ(2u, plan.new_prev(5));
+
+  EXPECT_EQ(1u, plan.top(1));
+  EXPECT_EQ(4u, plan.top(3));
+  EXPECT_EQ(4u, plan.top(5));
+  EXPECT_EQ(2u, plan.top(4));
+}
+
+TEST(CombPlan, Descends)
+{
+  cssc_delta_table t;
+  tree(t);
+  comb_plan plan(t, wanting(8, {}));
+  EXPECT_EQ(0u, plan.kept());
+  EXPECT_TRUE(plan.descends(7, 1));
+  EXPECT_TRUE(plan.descends(7, 3));
+  EXPECT_TRUE(plan.descends(8, 4));
+  EXPECT_TRUE(plan.descends(4, 4));
+  EXPECT_FALSE(plan.descends(6, 3));
+  EXPECT_FALSE(plan.descends(3, 7));
+  EXPECT_FALSE(plan.descends(8, 6));
+  for (seq_no s = 1; s <= 8; ++s)
+    EXPECT_EQ(0u, plan.top(s));
+}
+
+TEST(CombPlan, Removed)
+{
+  cssc_delta_table t;
+  add(t, 3, 2, 'R');
+  add(t, 2, 1);
+  add(t, 1, 0);
+  comb_plan plan(t, wanting(3, {1, 3}));
+  ASSERT_EQ(1u, plan.kept());
+  EXPECT_EQ(1u, plan.new_seq(1));
+  EXPECT_EQ(0u, plan.new_seq(3));
+  EXPECT_EQ(0u, plan.top(2));
+  EXPECT_EQ(0u, plan.top(3));
+}
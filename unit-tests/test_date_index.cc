@@ -0,0 +1,94 @@
+/*
+ * test_date_index.cc: Part of GNU CSSC.
+ *
+ * Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Unit tests for date-index.h.
+ *
+ */
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+#include "date-index.h"
+#include "delta-table.h"
+#include "delta.h"
+#include "sccsdate.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+  // A date which moves back and forth as seq increases (clocks are
+  // not always right), with several deltas sharing each date.
+  sccs_date date_of(seq_no seq)
+  {
+    const int n = (seq * 37) % 101 / 3;
+    char buf[32];
+    snprintf(buf, sizeof(buf), "98/%02d/%02d %02d:00:00",
+	     1 + n % 12, 1 + n % 28, n % 24);
+    return sccs_date(buf);
+  }
+
+  std::set<seq_no> members(const seq_set& set, seq_no highest)
+  {
+    std::set<seq_no> result;
+    for (seq_no s = 0; s <= highest; ++s)
+      {
+	if (ancestry_index::member(set, s))
+	  result.insert(s);
+      }
+    return result;
+  }
+}
+
+TEST(DateIndex, Empty)
+{
+  cssc_delta_table t;
+  date_index index(t);
+  const sccs_date d("98/01/01 00:00:00");
+  EXPECT_EQ(0, index.highest_seqno());
+  EXPECT_EQ(std::set<seq_no>(), members(index.later_than(d), 0));
+  EXPECT_EQ(std::set<seq_no>(), members(index.earlier_than(d), 0));
+}
+
+TEST(DateIndex, MatchesCompare)
+{
+  const seq_no highest = 300;
+  const std::vector<std::string> none;
+  cssc_delta_table t;
+  for (seq_no s = highest; s > 0; --s)
+    {
+      t.add(delta(s % 10 ? 'D' : 'R', sid("1.1"), date_of(s), "user",
+		  s, s - 1, none, none));
+    }
+
+  date_index index(t);
+  EXPECT_EQ(highest, index.highest_seqno());
+  for (seq_no c = 1; c <= highest; c += 7)
+    {
+      const sccs_date cutoff = date_of(c);
+      std::set<seq_no> later, earlier;
+      for (seq_no s = 1; s <= highest; ++s)
+	{
+	  if (date_of(s) > cutoff)
+	    later.insert(s);
+	  if (date_of(s) < cutoff)
+	    earlier.insert(s);
+	}
+      EXPECT_EQ(later, members(index.later_than(cutoff), highest)) << c;
+      EXPECT_EQ(earlier, members(index.earlier_than(cutoff), highest)) << c;
+    }
+}
@@ -0,0 +1,220 @@
+/*
+ * test_libcssc.cc: Part of GNU CSSC.
+ *
+ * Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Unit tests for libcssc.h.
+ *
+ */
+#include "libcssc.h"
+#include "file.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+using cssc::history_file;
+
+namespace
+{
+  // Writes a history file containing BODY as its only delta.
+  void
+  write_history_file(const std::string& name, const std::string& body_line)
+  {
+    const std::string rest =
+      "\001s 00001/00000/00000\n"
+      "\001d D 1.1 24/01/02 03:04:05 fred 1 0\n"
+      "\001c initial\n"
+      "\001e\n"
+      "\001u\n"
+      "\001U\n"
+      "\001t\n"
+      "\001T\n"
+      "\001I 1\n" + body_line + "\n"
+      "\001E 1\n";
+    int sum = 0;
+    for (char c : rest)
+      sum += c;
+    FILE *f = fopen(name.c_str(), "w");
+    ASSERT_NE(f, nullptr);
+    fprintf(f, "\001h%05d\n%s", sum & 0xFFFF, rest.c_str());
+    fclose(f);
+  }
+
+  class LibcsscTest : public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      char tmpl[] = "/tmp/test_libcssc.XXXXXX";
+      ASSERT_NE(mkdtemp(tmpl), nullptr);
+      dir_ = tmpl;
+      sfile_ = dir_ + "/s.foo";
+    }
+
+    void TearDown() override
+    {
+      for (const char *prefix : { "s.", "p.", "z.", "x.", "d.", "" })
+	unlink((dir_ + "/" + prefix + "foo").c_str());
+      rmdir(dir_.c_str());
+    }
+
+    std::string dir_;
+    std::string sfile_;
+  };
+}
+
+TEST_F(LibcsscTest, OpenMissing)
+{
+  auto opened = history_file::open(sfile_);
+  EXPECT_FALSE(opened.ok());
+}
+
+TEST_F(LibcsscTest, DeltaTable)
+{
+  write_history_file(sfile_, "hello");
+  auto opened = history_file::open(sfile_);
+  ASSERT_TRUE(opened.ok()) << opened.fail().to_string();
+  const auto& deltas = (*opened)->deltas();
+  ASSERT_EQ(deltas.size(), 1u);
+  EXPECT_EQ(deltas[0].sid, "1.1");
+  EXPECT_EQ(deltas[0].user, "fred");
+  EXPECT_EQ(deltas[0].date, "24/01/02 03:04:05");
+  EXPECT_EQ(deltas[0].inserted, 1u);
+  ASSERT_EQ(deltas[0].comments.size(), 1u);
+  EXPECT_EQ(deltas[0].comments[0], "initial");
+}
+
+TEST_F(LibcsscTest, GetToBuffer)
+{
+  write_history_file(sfile_, "hello %I%");
+  auto opened = history_file::open(sfile_);
+  ASSERT_TRUE(opened.ok()) << opened.fail().to_string();
+
+  std::string body;
+  cssc::get_request req;
+  auto got = (*opened)->get(req, &body);
+  ASSERT_TRUE(got.ok()) << got.fail().to_string();
+  EXPECT_EQ(body, "hello 1.1\n");
+  EXPECT_EQ((*got).sid, "1.1");
+  EXPECT_EQ((*got).lines, 1u);
+
+  body.clear();
+  req.expand_keywords = false;
+  got = (*opened)->get(req, &body);
+  ASSERT_TRUE(got.ok());
+  EXPECT_EQ(body, "hello %I%\n");
+}
+
+TEST_F(LibcsscTest, GetToCallback)
+{
+  write_history_file(sfile_, "hello");
+  auto opened = history_file::open(sfile_);
+  ASSERT_TRUE(opened.ok());
+
+  std::string body;
+  auto got = (*opened)->get(cssc::get_request(),
+			    [&body](const char *data, size_t len)
+			    {
+			      body.append(data, len);
+			      return cssc::Failure::Ok();
+			    });
+  ASSERT_TRUE(got.ok());
+  EXPECT_EQ(body, "hello\n");
+
+  // A failure from the sink is passed back to the caller.
+  got = (*opened)->get(cssc::get_request(),
+		       [](const char *, size_t)
+		       {
+			 return cssc::make_failure(cssc::errorcode::UnexpectedEOF);
+		       });
+  EXPECT_FALSE(got.ok());
+}
+
+TEST_F(LibcsscTest, GetUnknownSid)
+{
+  write_history_file(sfile_, "hello");
+  auto opened = history_file::open(sfile_);
+  ASSERT_TRUE(opened.ok());
+  cssc::get_request req;
+  req.sid = "1.7";
+  std::string body;
+  EXPECT_FALSE((*opened)->get(req, &body).ok());
+}
+
+TEST_F(LibcsscTest, CorruptFileIsAFailure)
+{
+  FILE *f = fopen(sfile_.c_str(), "w");
+  ASSERT_NE(f, nullptr);
+  fputs("\001h00000\n\001s garbage\n", f);
+  fclose(f);
+  auto opened = history_file::open(sfile_);
+  ASSERT_FALSE(opened.ok());
+  EXPECT_FALSE(opened.fail().detail().empty());
+}
+
+TEST_F(LibcsscTest, AddDeltaNeedsUpdateMode)
+{
+  write_history_file(sfile_, "hello");
+  auto opened = history_file::open(sfile_);
+  ASSERT_TRUE(opened.ok());
+  EXPECT_FALSE((*opened)->add_delta(cssc::delta_request()).ok());
+}
+
+TEST_F(LibcsscTest, AddDelta)
+{
+  write_history_file(sfile_, "hello");
+  {
+    FILE *p = fopen((dir_ + "/p.foo").c_str(), "w");
+    ASSERT_NE(p, nullptr);
+    fprintf(p, "1.1 1.2 %s 24/01/03 00:00:00\n", get_user_name());
+    fclose(p);
+    FILE *g = fopen((dir_ + "/foo").c_str(), "w");
+    ASSERT_NE(g, nullptr);
+    fputs("hello\nworld\n", g);
+    fclose(g);
+  }
+  auto opened = history_file::open(sfile_, history_file::open_mode::update);
+  ASSERT_TRUE(opened.ok()) << opened.fail().to_string();
+  // The lock must not be given up, even for a moment, while the file
+  // is read again after the update; if it were, z.foo would be a new
+  // file rather than another link to this one.
+  const std::string zfile = dir_ + "/z.foo", held = dir_ + "/z.held";
+  ASSERT_EQ(0, link(zfile.c_str(), held.c_str()));
+  cssc::delta_request req;
+  req.gfile = dir_ + "/foo";
+  req.comments.push_back("second");
+  auto added = (*opened)->add_delta(req);
+  ASSERT_TRUE(added.ok()) << added.fail().to_string();
+  EXPECT_EQ((*added).sid, "1.2");
+  EXPECT_EQ((*added).inserted, 1u);
+  EXPECT_EQ((*added).unchanged, 1u);
+  EXPECT_EQ((*opened)->deltas().size(), 2u);
+  struct stat st;
+  ASSERT_EQ(0, stat(zfile.c_str(), &st));
+  EXPECT_EQ(2u, st.st_nlink);
+  unlink(held.c_str());
+
+  std::string body;
+  auto got = (*opened)->get(cssc::get_request(), &body);
+  ASSERT_TRUE(got.ok());
+  EXPECT_EQ(body, "hello\nworld\n");
+  EXPECT_EQ((*got).sid, "1.2");
+}
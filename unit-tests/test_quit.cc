@@ -0,0 +1,110 @@
+/*
+ * test_quit.cc: Part of GNU CSSC.
+ *
+ * Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Unit tests for quit.h and cleanup.h.
+ *
+ */
+#include "quit.h"
+#include "except.h"
+#include "location.h"
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+TEST(ErrorContextTest, Capture)
+{
+  std::string messages;
+  {
+    error_context ctx("tool", &messages);
+    errormsg("%s %d", "hello", 42);
+    warning("careful");
+  }
+  EXPECT_EQ(messages, "tool: hello 42\ntool: warning: careful\n");
+}
+
+TEST(ErrorContextTest, Nesting)
+{
+  std::string outer, inner;
+  error_context a("outer", &outer);
+  {
+    error_context b("inner", &inner);
+    errormsg("one");
+  }
+  errormsg("two");
+  EXPECT_EQ(inner, "inner: one\n");
+  EXPECT_EQ(outer, "outer: two\n");
+}
+
+TEST(ErrorContextTest, PerThread)
+{
+  std::string mine, theirs;
+  error_context ctx("main", &mine);
+  std::thread t([&theirs]()
+		{
+		  error_context other("worker", &theirs);
+		  errormsg("from worker");
+		});
+  t.join();
+  errormsg("from main");
+  EXPECT_EQ(mine, "main: from main\n");
+  EXPECT_EQ(theirs, "worker: from worker\n");
+}
+
+TEST(ErrorContextTest, CorruptIsPerFile)
+{
+  std::string messages;
+  error_context ctx("val", &messages);
+  sccs_file_location loc("s.foo", 3);
+  EXPECT_THROW(corrupt(loc, "bad %s", "thing"), CsscSfileCorruptException);
+  EXPECT_NE(messages.find("s.foo"), std::string::npos);
+  EXPECT_NE(messages.find("bad thing"), std::string::npos);
+}
+
+namespace
+{
+  class counting_cleanup : public cleanup
+  {
+  public:
+    explicit counting_cleanup(int *counter) : counter_(counter) {}
+    ~counting_cleanup() {}
+    void do_cleanup() override { ++*counter_; }
+  private:
+    int *counter_;
+  };
+}
+
+TEST(CleanupTest, ThreadCleanupsAreLocal)
+{
+  int mine = 0, theirs = 0;
+  counting_cleanup c(&mine);
+  std::thread t([&theirs]()
+		{
+		  counting_cleanup other(&theirs);
+		  cleanup::run_thread_cleanups();
+		});
+  t.join();
+  EXPECT_EQ(theirs, 1);
+  EXPECT_EQ(mine, 0);
+  cleanup::run_thread_cleanups();
+  EXPECT_EQ(mine, 1);
+  // Once run, a cleanup is not run again.
+  cleanup::run_thread_cleanups();
+  EXPECT_EQ(mine, 1);
+}
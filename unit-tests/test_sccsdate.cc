@@ -24,6 +24,9 @@
 #include "sccsdate.h"
 #include "quit.h"
 
+#include <cstdio>
+#include <ctime>
+
 #include <gtest/gtest.h>
 
 TEST(SccsdateTest, NullConstructor)
@@ -50,6 +53,56 @@ TEST(SccsdateTest, StringDateTimeConstructor)
   EXPECT_EQ("99/05/19 01:42:08", d12.as_string());
 }
 
+TEST(SccsdateTest, BadDateTime)
+{
+  EXPECT_FALSE(sccs_date("99/05/1", "01:42:08").valid());
+  EXPECT_FALSE(sccs_date("99/05/19x", "01:42:08").valid());
+  EXPECT_FALSE(sccs_date("99-05-19", "01:42:08").valid());
+  EXPECT_FALSE(sccs_date("99/05/19", "01:42").valid());
+  EXPECT_FALSE(sccs_date("99/05/19", "01:4a:08").valid());
+  EXPECT_FALSE(sccs_date("99/13/19", "01:42:08").valid());
+  EXPECT_FALSE(sccs_date("99/02/29", "01:42:08").valid());
+  EXPECT_FALSE(sccs_date("", "").valid());
+  EXPECT_TRUE(sccs_date("00/02/29", "23:59:59").valid());
+}
+
+TEST(SccsdateTest, Print)
+{
+  const sccs_date d("07/02/09", "13:05:01");
+  FILE *f = tmpfile();
+  ASSERT_TRUE(f != nullptr);
+  EXPECT_TRUE(d.print(f).ok());
+  for (const char *p = "DHTyodhms"; *p; ++p)
+    {
+      EXPECT_TRUE(fputc(' ', f) != EOF);
+      EXPECT_TRUE(d.printf(f, *p).ok());
+    }
+  rewind(f);
+  char buf[80];
+  ASSERT_TRUE(fgets(buf, sizeof(buf), f) != nullptr);
+  fclose(f);
+  EXPECT_STREQ("07/02/09 13:05:01 07/02/09 02/09/07 13:05:01"
+	       " 07 02 09 13 05 01", buf);
+}
+
+TEST(SccsdateTest, PrintInvalid)
+{
+  const sccs_date d;
+  EXPECT_EQ("-1/-1/-1 -1:-1:-1", d.as_string());
+  FILE *f = tmpfile();
+  ASSERT_TRUE(f != nullptr);
+  EXPECT_TRUE(d.print(f).ok());
+  EXPECT_TRUE(fputc(' ', f) != EOF);
+  EXPECT_TRUE(d.printf(f, 'H').ok());
+  EXPECT_TRUE(fputc(' ', f) != EOF);
+  EXPECT_TRUE(d.printf(f, 's').ok());
+  rewind(f);
+  char buf[80];
+  ASSERT_TRUE(fgets(buf, sizeof(buf), f) != nullptr);
+  fclose(f);
+  EXPECT_STREQ("-1/-1/-1 -1:-1:-1 -1/-1/-1 -1", buf);
+}
+
 TEST(SccsdateTest, FourDigitYear)
 {
   // This test generates a warning on stderr.
@@ -86,8 +139,22 @@ TEST(SccsdateTest, ColonYear)
 
 TEST(SccsdateTest, Now)
 {
-  // Make sure the now method at least returns.
-  sccs_date::now();
+  // now() works out the local time itself, so compare it with what
+  // localtime() says (trying again if the clock ticks meanwhile).
+  for (int tries = 0; tries < 5; ++tries)
+    {
+      const time_t before = time(nullptr);
+      const sccs_date d = sccs_date::now();
+      if (time(nullptr) != before)
+	continue;
+      const struct tm *ptm = localtime(&before);
+      ASSERT_TRUE(ptm != nullptr);
+      const sccs_date expected(ptm->tm_year + 1900, ptm->tm_mon + 1,
+			       ptm->tm_mday, ptm->tm_hour, ptm->tm_min,
+			       ptm->tm_sec);
+      EXPECT_EQ(expected.as_string(), d.as_string());
+      return;
+    }
 }
 
 TEST(SccsdateTest, Greater)
@@ -157,6 +224,33 @@ TEST(SccsdateTest, Equality)
   EXPECT_TRUE(sccs_date(datestr) <= sccs_date(datestr));
 }
 
+TEST(SccsdateTest, Packed)
+{
+  const char *dates[] =
+    {
+      "70/01/01 00:00:00", "98/01/01 00:00:00", "98/01/01 00:00:59",
+      "98/01/01 00:59:00", "98/01/01 23:00:00", "98/01/31 00:00:00",
+      "98/02/01 00:00:00", "98/12/31 23:59:59", "99/01/01 00:00:00",
+      "00/02/29 00:00:00", "00/03/01 00:00:00", "00/12/31 00:00:00",
+      "2037/01/01 00:00:00",
+    };
+  const size_t n = sizeof(dates) / sizeof(dates[0]);
+
+  // The packed form orders dates the same way the comparisons do.
+  for (size_t i = 0; i < n; ++i)
+    {
+      const sccs_date a(dates[i]);
+      ASSERT_TRUE(a.valid()) << dates[i];
+      for (size_t j = 0; j < n; ++j)
+	{
+	  const sccs_date b(dates[j]);
+	  EXPECT_EQ(a < b, a.packed() < b.packed()) << dates[i] << " " << dates[j];
+	  EXPECT_EQ(a > b, a.packed() > b.packed()) << dates[i] << " " << dates[j];
+	}
+    }
+  EXPECT_EQ(-1, sccs_date().packed());
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   set_prg_name("test_sccsdate");
@@ -0,0 +1,152 @@
+/*
+ * test_sfile_cache.cc: Part of GNU CSSC.
+ *
+ * Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Unit tests for sfile-cache.h.
+ *
+ */
+#include "sfile-cache.h"
+#include "sccsfile.h"
+#include "except.h"
+#include "quit.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+  // Writes a history file whose only delta has the given SID.  The
+  // new file replaces any old one, as it would if it had been
+  // updated by delta.
+  void
+  write_history_file(const std::string& name, const std::string& id)
+  {
+    const std::string rest =
+      "\001s 00001/00000/00000\n"
+      "\001d D " + id + " 24/01/02 03:04:05 fred 1 0\n"
+      "\001e\n"
+      "\001u\n"
+      "\001U\n"
+      "\001t\n"
+      "\001T\n"
+      "\001I 1\n"
+      "hello\n"
+      "\001E 1\n";
+    int sum = 0;
+    for (char c : rest)
+      sum += c;
+    const std::string tmp = name + ".new";
+    FILE *f = fopen(tmp.c_str(), "w");
+    ASSERT_NE(f, nullptr);
+    fprintf(f, "\001h%05d\n%s", sum & 0xFFFF, rest.c_str());
+    fclose(f);
+    ASSERT_EQ(0, rename(tmp.c_str(), name.c_str()));
+  }
+
+  std::string
+  top_sid(sfile_cache::handle h)
+  {
+    sid found;
+    sid requested(sid::null_sid());
+    EXPECT_TRUE(h->file->find_requested_sid(requested, found));
+    return found.as_string();
+  }
+
+  class SfileCacheTest : public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      char tmpl[] = "/tmp/test_sfile_cache.XXXXXX";
+      ASSERT_NE(mkdtemp(tmpl), nullptr);
+      dir_ = tmpl;
+    }
+
+    void TearDown() override
+    {
+      for (const char *name : { "s.a", "s.b", "s.c" })
+	unlink((dir_ + "/" + name).c_str());
+      rmdir(dir_.c_str());
+    }
+
+    std::string path(const char *name) const
+    {
+      return dir_ + "/" + name;
+    }
+
+    std::string dir_;
+  };
+}
+
+TEST_F(SfileCacheTest, Hit)
+{
+  write_history_file(path("s.a"), "1.1");
+  sfile_cache cache(4);
+  sfile_cache::handle first = cache.lookup(path("s.a"));
+  sfile_cache::handle second = cache.lookup(path("s.a"));
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(top_sid(second), "1.1");
+  EXPECT_EQ(cache.stats().hits, 1u);
+  EXPECT_EQ(cache.stats().misses, 1u);
+  EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST_F(SfileCacheTest, ReplacedFileIsReread)
+{
+  write_history_file(path("s.a"), "1.1");
+  sfile_cache cache(4);
+  sfile_cache::handle first = cache.lookup(path("s.a"));
+  write_history_file(path("s.a"), "1.2");
+  sfile_cache::handle second = cache.lookup(path("s.a"));
+  EXPECT_NE(first, second);
+  EXPECT_EQ(top_sid(first), "1.1");
+  EXPECT_EQ(top_sid(second), "1.2");
+  EXPECT_EQ(cache.stats().misses, 2u);
+  EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST_F(SfileCacheTest, LeastRecentlyUsedIsEvicted)
+{
+  write_history_file(path("s.a"), "1.1");
+  write_history_file(path("s.b"), "1.1");
+  write_history_file(path("s.c"), "1.1");
+  sfile_cache cache(2);
+  sfile_cache::handle a = cache.lookup(path("s.a"));
+  cache.lookup(path("s.b"));
+  cache.lookup(path("s.a"));	// now b is the oldest
+  cache.lookup(path("s.c"));
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(cache.stats().evictions, 1u);
+  EXPECT_EQ(cache.lookup(path("s.a")), a);
+  const unsigned long misses = cache.stats().misses;
+  cache.lookup(path("s.b"));
+  EXPECT_EQ(cache.stats().misses, misses + 1);
+}
+
+TEST_F(SfileCacheTest, MissingFileIsNotCached)
+{
+  std::string diagnostics;
+  error_context ctx(nullptr, &diagnostics);
+  sfile_cache cache(4);
+  EXPECT_THROW(cache.lookup(path("s.a")), CsscExitvalException);
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_FALSE(diagnostics.empty());
+}
@@ -0,0 +1,85 @@
+/*
+ * test_sync_group.cc: Part of GNU CSSC.
+ *
+ * Copyright (C) 2024 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Unit tests for sync-group.h.
+ *
+ */
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "sync-group.h"
+#include <gtest/gtest.h>
+
+TEST(SyncGroup, One)
+{
+  sync_group group;
+  FILE *f = tmpfile();
+  ASSERT_TRUE(f != nullptr);
+  fputs("data\n", f);
+  fflush(f);
+  EXPECT_TRUE(group.sync(fileno(f)).ok());
+  EXPECT_EQ(1uL, group.batches());
+  fclose(f);
+}
+
+TEST(SyncGroup, BadDescriptor)
+{
+  sync_group group;
+  EXPECT_FALSE(group.sync(-1).ok());
+  // The failure is not remembered for the next file.
+  FILE *f = tmpfile();
+  ASSERT_TRUE(f != nullptr);
+  EXPECT_TRUE(group.sync(fileno(f)).ok());
+  fclose(f);
+}
+
+TEST(SyncGroup, ManyThreads)
+{
+  const int nthreads = 16, per_thread = 20;
+  sync_group group;
+  std::vector<std::thread> threads;
+  std::vector<int> failures(nthreads, 0);
+  for (int t = 0; t < nthreads; ++t)
+    {
+      threads.emplace_back([&group, &failures, t]()
+        {
+	  for (int i = 0; i < per_thread; ++i)
+	    {
+	      FILE *f = tmpfile();
+	      if (f == nullptr)
+		{
+		  ++failures[t];
+		  continue;
+		}
+	      fprintf(f, "%d %d\n", t, i);
+	      fflush(f);
+	      if (!group.sync(fileno(f)).ok())
+		++failures[t];
+	      fclose(f);
+	    }
+	});
+    }
+  for (auto& t : threads)
+    t.join();
+  for (int t = 0; t < nthreads; ++t)
+    EXPECT_EQ(0, failures[t]) << t;
+  // Every file was covered by some sync, and never by more than one
+  // batch per call.
+  EXPECT_GE(static_cast<unsigned long>(nthreads * per_thread), group.batches());
+  EXPECT_LE(1uL, group.batches());
+}